@@ -6,10 +6,11 @@
 #include <fcntl.h>
 
 mg::Acceptor::Acceptor(int domain, int type, EventLoop *loop, const InternetAddress &listenAddress, bool reusePort)
-    : _loop(loop), _socket(0), _channel(loop, createNonBlockScoket(domain, type)),
+    : _loop(loop), _socket(0), _channel(loop, createNonBlockScoket(domain, type)), _listen(false),
       _vacantFd(::open("/dev/null", O_RDWR | O_CLOEXEC))
 {
     _socket.setReuseAddress(true);
+    _socket.setReusePort(reusePort);
     _socket.bind(listenAddress);
     _channel.setReadCallback(std::bind(&Acceptor::handleReadEvent, this));
     LOG_DEBUG("EventLoop[{}] Acceptor Socket fd is {}", this->_loop->getLoopName(), this->_socket.fd());
@@ -39,6 +40,11 @@ void mg::Acceptor::setNewConnectionCallBack(const NewConnectionCallBack callback
     this->_callback = std::move(callback);
 }
 
+mg::EventLoop *mg::Acceptor::getLoop() const
+{
+    return this->_loop;
+}
+
 int mg::Acceptor::createNonBlockScoket(int domain, int type)
 {
     this->_socket.setSocketType(domain, type);
@@ -49,20 +55,25 @@ int mg::Acceptor::createNonBlockScoket(int domain, int type)
 
 void mg::Acceptor::handleReadEvent()
 {
-    InternetAddress address;
-    int acceptFd = this->_socket.accept(&address);
-    if (acceptFd >= 0)
+    // 每次事件尽量取完全连接队列，最多_maxAcceptPerEvent个，避免连接风暴时其他事件得不到处理
+    for (int i = 0; i < _maxAcceptPerEvent; i++)
     {
-        if (_callback)
-            _callback(acceptFd, address);
-        else
+        InternetAddress address;
+        int acceptFd = this->_socket.accept(&address);
+        if (acceptFd >= 0)
         {
-            LOG_ERROR("EventLoop[{}] _callback not set", this->_loop->getLoopName());
-            ::close(acceptFd);
+            if (_callback)
+                _callback(acceptFd, address);
+            else
+            {
+                LOG_ERROR("EventLoop[{}] _callback not set", this->_loop->getLoopName());
+                ::close(acceptFd);
+            }
+            continue;
         }
-    }
-    else
-    {
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
         LOG_ERROR("EventLoop[{}] accept failed", this->_loop->getLoopName());
         if (errno == EMFILE)
         {
@@ -72,5 +83,6 @@ void mg::Acceptor::handleReadEvent()
             ::close(this->_vacantFd);
             this->_vacantFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
         }
+        return;
     }
 }
@@ -16,6 +16,9 @@ namespace mg
     public:
         using NewConnectionCallBack = std::function<void(int, const InternetAddress &)>;
 
+        /**
+         * @param reusePort 是否设置SO_REUSEPORT，多个Acceptor可以监听同一个端口，由内核分配新连接
+         */
         Acceptor(int domain, int type, EventLoop *loop, const InternetAddress &listenAddress, bool reusePort);
 
         ~Acceptor();
@@ -26,6 +29,11 @@ namespace mg
 
         void setNewConnectionCallBack(const NewConnectionCallBack callback);
 
+        /**
+         * @brief 返回所属的eventloop
+         */
+        EventLoop *getLoop() const;
+
     private:
         /**
          * @brief 仅用作创建非阻塞套接口
@@ -47,6 +55,8 @@ namespace mg
         bool _listen;                    // 是否处于监听中
         NewConnectionCallBack _callback; // 新连接到来时的回调函数
         int _vacantFd;                   // 占用一个文件描述符，放置进程fd分配完毕后当新连接到来时无法accept
+
+        static const int _maxAcceptPerEvent = 64; // 每次读事件最多接受的连接数
     };
 };
 
@@ -0,0 +1,106 @@
+#include "buffer-pool.h"
+
+#include <stdlib.h>
+#include <new>
+
+const uint32_t mg::BufferPool::_minClassSize;
+const int mg::BufferPool::_classes;
+const uint32_t mg::BufferPool::_maxClassSize;
+const size_t mg::BufferPool::_maxCachedBytes;
+
+namespace
+{
+    // 线程退出时内存池已经析构，之后归还的内存直接释放
+    thread_local bool t_poolDestroyed = false;
+}
+
+mg::BufferPool::BufferPool()
+{
+    for (int i = 0; i < _classes; i++)
+    {
+        this->_freeLists[i] = nullptr;
+        this->_cached[i] = 0;
+    }
+}
+
+mg::BufferPool::~BufferPool()
+{
+    for (int i = 0; i < _classes; i++)
+    {
+        Block *block = this->_freeLists[i];
+        while (block)
+        {
+            Block *next = block->next;
+            ::free(block);
+            block = next;
+        }
+    }
+    t_poolDestroyed = true;
+}
+
+mg::BufferPool &mg::BufferPool::local()
+{
+    static thread_local BufferPool pool;
+    return pool;
+}
+
+u_char *mg::BufferPool::allocate(uint32_t &size)
+{
+    int index = sizeClass(size);
+    if (index < 0)
+    {
+        // 大内存按4KB对齐，避免反复扩容时大小相差太小
+        size = (size + 4095) & ~4095u;
+        void *data = ::malloc(size);
+        if (!data)
+            throw std::bad_alloc();
+        return static_cast<u_char *>(data);
+    }
+
+    size = _minClassSize << index;
+    if (!t_poolDestroyed)
+    {
+        BufferPool &pool = local();
+        Block *block = pool._freeLists[index];
+        if (block)
+        {
+            pool._freeLists[index] = block->next;
+            pool._cached[index] -= size;
+            return reinterpret_cast<u_char *>(block);
+        }
+    }
+    void *data = ::malloc(size);
+    if (!data)
+        throw std::bad_alloc();
+    return static_cast<u_char *>(data);
+}
+
+void mg::BufferPool::deallocate(u_char *data, uint32_t size)
+{
+    if (!data)
+        return;
+    int index = sizeClass(size);
+    if (index >= 0 && !t_poolDestroyed)
+    {
+        BufferPool &pool = local();
+        if (pool._cached[index] + size <= _maxCachedBytes)
+        {
+            Block *block = reinterpret_cast<Block *>(data);
+            block->next = pool._freeLists[index];
+            pool._freeLists[index] = block;
+            pool._cached[index] += size;
+            return;
+        }
+    }
+    ::free(data);
+}
+
+int mg::BufferPool::sizeClass(uint32_t size)
+{
+    if (size <= _minClassSize)
+        return 0;
+    if (size > _maxClassSize)
+        return -1;
+    // 向上取整到2的幂
+    return (32 - __builtin_clz(size - 1)) - __builtin_ctz(_minClassSize);
+}
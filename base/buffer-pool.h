@@ -0,0 +1,63 @@
+#ifndef __MG_BUFFER_POOL_H__
+#define __MG_BUFFER_POOL_H__
+
+#include "noncopyable.h"
+
+#include <stddef.h>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace mg
+{
+    /**
+     * @brief Buffer使用的线程局部内存池，每个eventloop线程一个
+     *        内存按照2的幂分为_classes个大小等级，归还的内存挂在对应等级的空闲链表上复用，
+     *        超过_maxClassSize的内存直接向系统申请和释放
+     *        内存可以在任意线程归还，归还到当前线程的内存池
+     */
+    class BufferPool : noncopyable
+    {
+    public:
+        /**
+         * @brief 当前线程的内存池
+         */
+        static BufferPool &local();
+
+        /**
+         * @brief 申请至少size字节的内存
+         * @param size 需要的大小，返回时修改为实际分配的大小
+         */
+        static u_char *allocate(uint32_t &size);
+
+        /**
+         * @brief 归还allocate申请的内存
+         * @param size allocate返回的实际大小
+         */
+        static void deallocate(u_char *data, uint32_t size);
+
+        ~BufferPool();
+
+        static const uint32_t _minClassSize = 1024;                            // 最小的大小等级
+        static const int _classes = 7;                                         // 大小等级数量
+        static const uint32_t _maxClassSize = _minClassSize << (_classes - 1); // 最大的大小等级
+        static const size_t _maxCachedBytes = 1024 * 1024;                     // 每个大小等级最多缓存的字节数
+
+    private:
+        BufferPool();
+
+        struct Block
+        {
+            Block *next;
+        };
+
+        /**
+         * @brief size对应的大小等级，超过_maxClassSize时返回-1
+         */
+        static int sizeClass(uint32_t size);
+
+        Block *_freeLists[_classes]; // 各个大小等级的空闲链表
+        size_t _cached[_classes];    // 各个大小等级缓存的字节数
+    };
+};
+
+#endif //__MG_BUFFER_POOL_H__
@@ -1,4 +1,5 @@
 #include "buffer.h"
+#include "buffer-pool.h"
 
 #include <string.h>
 #include <sys/uio.h>
@@ -6,14 +7,26 @@
 #include <unistd.h>
 #include <memory>
 
+const int mg::Buffer::_headSize;
+const int mg::Buffer::_extraSize;
+u_char mg::Buffer::_emptyStorage[mg::Buffer::_headSize];
+
+namespace
+{
+    // 预留的读空间加上头部不超过内存池最大的一级，持续大量读取时不会每次都走malloc
+    const uint32_t kMaxReadHint = mg::BufferPool::_maxClassSize - mg::Buffer::_headSize;
+}
+
 mg::Buffer::Buffer(int initialSize)
-    : _buffer(_headSize + initialSize),
-      _readIndex(_headSize), _writeIndex(_headSize)
+    : _buffer(_emptyStorage), _capacity(_headSize),
+      _readIndex(_headSize), _writeIndex(_headSize), _readHint(initialSize)
 {
     ;
 }
 
 mg::Buffer::Buffer(Buffer &&other)
+    : _buffer(_emptyStorage), _capacity(_headSize),
+      _readIndex(_headSize), _writeIndex(_headSize), _readHint(0)
 {
     this->operator=(std::move(other));
 }
@@ -22,16 +35,32 @@ mg::Buffer &mg::Buffer::operator=(Buffer &&other)
 {
     if (this == &other)
         return *this;
+    this->release();
+    this->_buffer = other._buffer;
+    this->_capacity = other._capacity;
     this->_readIndex = other._readIndex;
     this->_writeIndex = other._writeIndex;
-    this->_buffer = std::move(other._buffer);
+    this->_readHint = other._readHint;
+    // 被移走的Buffer回到没有申请内存的状态，之后仍然可以正常写入
+    other._buffer = _emptyStorage;
+    other._capacity = _headSize;
     other.retrieveAll();
     return *this;
 }
 
+mg::Buffer::~Buffer()
+{
+    this->release();
+}
+
 int mg::Buffer::writeableBytes()
 {
-    return this->_buffer.size() - this->_writeIndex;
+    return this->_capacity - this->_writeIndex;
+}
+
+int mg::Buffer::capacity() const
+{
+    return this->_buffer == _emptyStorage ? 0 : this->_capacity;
 }
 
 int64_t mg::Buffer::peekInt64()
@@ -183,8 +212,11 @@ int mg::Buffer::send(int fd, int &saveError)
 
 int mg::Buffer::receive(int fd, int &saveError)
 {
-    char extraBuffer[65536] = {0};
+    // 溢出区每个线程一份，只有可写空间不够时才会用到，不需要每次清零
+    static thread_local char extraBuffer[_extraSize];
 
+    if (this->writeableBytes() < static_cast<int>(this->_readHint))
+        this->ensureWriteSpace(this->_readHint);
     int writeSize = this->writeableBytes();
 
     struct iovec vec[2];
@@ -193,7 +225,8 @@ int mg::Buffer::receive(int fd, int &saveError)
     vec[1].iov_base = extraBuffer;
     vec[1].iov_len = sizeof(extraBuffer);
 
-    const int vecSize = (writeSize < sizeof(extraBuffer)) ? 2 : 1;
+    // 可写空间已经达到上限时不再读入溢出区，剩下的数据留在内核中下次再读，否则追加溢出的部分又会超出内存池
+    const int vecSize = (writeSize < static_cast<int>(kMaxReadHint)) ? 2 : 1;
     const int len = ::readv(fd, vec, vecSize);
     if (len < 0)
         saveError = errno;
@@ -201,20 +234,32 @@ int mg::Buffer::receive(int fd, int &saveError)
         this->_writeIndex += len;
     else
     {
-        this->_writeIndex = this->_buffer.size();
+        this->_writeIndex = this->_capacity;
         this->append(extraBuffer, len - writeSize);
     }
+    if (len > 0)
+        this->updateReadHint(len);
     return len;
 }
 
+void mg::Buffer::updateReadHint(int len)
+{
+    // 读到更多数据时立即跟上，之后每次只回落差值的1/8，偶尔的小包不会让预留空间马上缩小
+    uint32_t size = std::min(static_cast<uint32_t>(len), kMaxReadHint);
+    if (size >= this->_readHint)
+        this->_readHint = size;
+    else
+        this->_readHint -= (this->_readHint - size) >> 3;
+}
+
 u_char *mg::Buffer::begin()
 {
-    return this->_buffer.data();
+    return this->_buffer;
 }
 
 const u_char *mg::Buffer::begin() const
 {
-    return this->_buffer.data();
+    return this->_buffer;
 }
 
 void mg::Buffer::ensureWriteSpace(int len)
@@ -229,10 +274,13 @@ void mg::Buffer::allocate(int len)
 {
     /*
         实际上等价于 this->writeableBytes() + this->hasReadBytes() - this->_headSize < len
-        扩容后大小变为this->_writeIndex + len，实际上空间大小增加len - this->_writeIndex字节
+        空间不够时从内存池换一块至少能放下包头、可读数据和len字节的内存，按照当前容量成倍增长，避免连续追加时反复换内存
     */
     if (this->writeableBytes() + this->hasReadBytes() < len + this->_headSize)
-        this->_buffer.resize(this->_writeIndex + len);
+    {
+        uint32_t size = this->_headSize + this->readableBytes() + len;
+        this->reallocate(std::max(size, this->capacity() ? this->_capacity << 1 : size));
+    }
     else
     {
         int size = this->readableBytes();
@@ -241,3 +289,35 @@ void mg::Buffer::allocate(int len)
         this->_writeIndex = size + this->_readIndex;
     }
 }
+
+void mg::Buffer::shrink()
+{
+    if (this->_buffer == _emptyStorage)
+        return;
+    int size = this->readableBytes();
+    if (!size)
+        this->release();
+    else if (this->_capacity > BufferPool::_maxClassSize && (this->_headSize + size) * 4 <= this->_capacity)
+        this->reallocate(this->_headSize + size);
+}
+
+void mg::Buffer::reallocate(uint32_t size)
+{
+    u_char *buffer = BufferPool::allocate(size);
+    int readable = this->readableBytes();
+    ::memcpy(buffer + this->_headSize, this->readPeek(), readable);
+    this->release();
+    this->_buffer = buffer;
+    this->_capacity = size;
+    this->_readIndex = this->_headSize;
+    this->_writeIndex = this->_headSize + readable;
+}
+
+void mg::Buffer::release()
+{
+    if (this->_buffer != _emptyStorage)
+        BufferPool::deallocate(this->_buffer, this->_capacity);
+    this->_buffer = _emptyStorage;
+    this->_capacity = this->_headSize;
+    this->retrieveAll();
+}
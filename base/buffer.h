@@ -1,7 +1,6 @@
 #ifndef __MG_BUFFER_H__
 #define __MG_BUFFER_H__
 
-#include <vector>
 #include <string>
 #include <algorithm>
 #include <stddef.h>
@@ -10,15 +9,23 @@
 
 namespace mg
 {
+    /**
+     * @brief 读写缓冲区，内存在第一次写入时才从BufferPool中申请，shrink后归还
+     */
     class Buffer
     {
     public:
+        /**
+         * @param initialSize 第一次接收数据时预留的空间
+         */
         Buffer(int initialSize = _initialSize);
 
         Buffer(Buffer &&other);
 
         Buffer &operator=(Buffer &&other);
 
+        ~Buffer();
+
         /**
          * @brief 获取缓冲区中可读数据的起始地址
          */
@@ -57,7 +64,8 @@ namespace mg
         int send(int fd, int &saveError);
 
         /**
-         * @brief 接收数据
+         * @brief 接收数据，可写空间不足时多出的数据先读到线程局部的溢出区再拷贝进来
+         *        会根据最近几次读到的数据量预留可写空间，使数据通常可以直接读进缓冲区
          * @param fd 要接受的socket文件描述符
          * @param saveError 保存发生错误时的状态
          */
@@ -69,6 +77,17 @@ namespace mg
          */
         void retrieve(int len);
 
+        /**
+         * @brief 回收空闲的内存，没有可读数据时把内存全部归还内存池，
+         *        可读数据远小于容量时换成更小的内存
+         */
+        void shrink();
+
+        /**
+         * @brief 当前占用的内存大小
+         */
+        int capacity() const;
+
         /**
          * @brief 获取可以读数据的大小
          */
@@ -108,6 +127,7 @@ namespace mg
 
         static const int _headSize = 4;       // 每个数据包的包头长度
         static const int _initialSize = 1024; // 缓冲区长度
+        static const int _extraSize = 65536;  // 接收数据时溢出区的长度
 
     private:
         /**
@@ -139,14 +159,33 @@ namespace mg
          */
         void allocate(int len);
 
+        /**
+         * @brief 换成至少size大小的内存，可读数据移动到包头之后
+         */
+        void reallocate(uint32_t size);
+
+        /**
+         * @brief 把内存归还内存池，回到没有申请内存的状态
+         */
+        void release();
+
         /**
          * @brief 取出所有可读数据
          */
         void retrieveAll();
 
-        std::vector<u_char> _buffer; // 缓冲区
-        uint32_t _readIndex;         // 读取Buffer缓冲数据起始处
-        uint32_t _writeIndex;        // 写入Buffer缓冲数据起始处
+        /**
+         * @brief 根据本次读到的数据量更新下次读之前需要预留的空间
+         */
+        void updateReadHint(int len);
+
+        static u_char _emptyStorage[_headSize]; // 没有申请内存时使用的包头空间
+
+        u_char *_buffer;      // 缓冲区，没有申请内存时指向_emptyStorage
+        uint32_t _capacity;   // 缓冲区大小
+        uint32_t _readIndex;  // 读取Buffer缓冲数据起始处
+        uint32_t _writeIndex; // 写入Buffer缓冲数据起始处
+        uint32_t _readHint;   // 最近读到的数据量，快速增长缓慢衰减
     };
 };
 
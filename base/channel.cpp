@@ -13,7 +13,7 @@ namespace mg
 mg::Channel::Channel(EventLoop *loop, int fd) : _loop(loop), _fd(fd),
                                                 _events(0), _activeEvents(0),
                                                 _index(newChannel), _tied(false),
-                                                _handleEvent(false)
+                                                _handleEvent(false), _edgeTriggered(false)
 {
     ;
 }
@@ -61,7 +61,17 @@ int mg::Channel::fd() const
 
 int mg::Channel::events() const
 {
-    return this->_events;
+    return this->_edgeTriggered ? (this->_events | EPOLLET) : this->_events;
+}
+
+void mg::Channel::setEdgeTriggered(bool on)
+{
+    this->_edgeTriggered = on;
+}
+
+bool mg::Channel::isEdgeTriggered() const
+{
+    return this->_edgeTriggered;
 }
 
 void mg::Channel::enableWriting()
@@ -64,6 +64,16 @@ namespace mg
          */
         int events() const;
 
+        /**
+         * @brief 设置是否使用边沿触发(EPOLLET)，需要在注册事件之前设置
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * @brief 是否使用边沿触发
+         */
+        bool isEdgeTriggered() const;
+
         /**
          * @brief 向epoll注册写事件
          */
@@ -165,6 +175,8 @@ namespace mg
         bool _tied;
 
         bool _handleEvent;
+
+        bool _edgeTriggered;
     };
 };
 
@@ -0,0 +1,313 @@
+#ifndef __MG_CONNECTION_CACHE_H__
+#define __MG_CONNECTION_CACHE_H__
+
+#include "noncopyable.h"
+#include "mpmc-queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mg
+{
+    /**
+     * @brief 连接池中空闲连接的容器，取出和归还都不加锁
+     *        每个线程有一个缓存槽位，归还的连接优先放入当前线程的槽位，同一线程下次取连接时直接拿走，
+     *        槽位已满时放入共享的无锁队列，取连接时依次查看自己的槽位、共享队列、其他线程的槽位
+     *        只有没有空闲连接需要等待时才使用互斥锁和条件变量
+     */
+    template <typename T>
+    class ConnectionCache : noncopyable
+    {
+    public:
+        explicit ConnectionCache(size_t capacity)
+            : _queue(capacity), _id(nextId()), _nextSlot(0), _waiters(0)
+        {
+            for (size_t i = 0; i < kSlots; i++)
+            {
+                this->_slots[i].connection.store(nullptr, std::memory_order_relaxed);
+                this->_slots[i].owner.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief 取出一个空闲连接，没有空闲连接时最多等待timeout
+         * @return 超时返回nullptr
+         */
+        T *acquire(std::chrono::milliseconds timeout)
+        {
+            T *connection = this->tryAcquire();
+            if (connection || timeout.count() <= 0)
+                return connection;
+
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            while (true)
+            {
+                // 与release中的栅栏配对，保证要么这里取到归还的连接，要么release看到等待者并唤醒
+                this->_waiters.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                connection = this->tryAcquire();
+                if (connection)
+                {
+                    this->_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    return connection;
+                }
+                std::cv_status status = this->_condition.wait_until(lock, deadline);
+                this->_waiters.fetch_sub(1, std::memory_order_relaxed);
+                if (status == std::cv_status::timeout)
+                    return this->tryAcquire();
+            }
+        }
+
+        /**
+         * @brief 取出一个空闲连接，不等待
+         */
+        T *tryAcquire()
+        {
+            Slot *slot = this->localSlot();
+            if (slot && slot->connection.load(std::memory_order_relaxed))
+            {
+                T *connection = slot->connection.exchange(nullptr, std::memory_order_acquire);
+                if (connection)
+                    return connection;
+            }
+            return this->pop();
+        }
+
+        /**
+         * @brief 归还连接，优先放入当前线程的槽位
+         * @return 容器已满时返回false，由调用者释放连接
+         */
+        bool release(T *connection)
+        {
+            Slot *slot = this->localSlot();
+            T *expected = nullptr;
+            if (!slot || !slot->connection.compare_exchange_strong(expected, connection, std::memory_order_release,
+                                                                   std::memory_order_relaxed))
+            {
+                if (!this->_queue.push(std::move(connection)))
+                    return false;
+            }
+            this->notify();
+            return true;
+        }
+
+        /**
+         * @brief 取出任意一个空闲连接，包括其他线程槽位中缓存的连接，供回收和心跳使用
+         */
+        T *pop()
+        {
+            T *connection = nullptr;
+            if (this->_queue.pop(connection))
+                return connection;
+            size_t used = std::min(this->_nextSlot.load(std::memory_order_relaxed), kSlots);
+            for (size_t i = 0; i < used; i++)
+            {
+                Slot &slot = this->_slots[i];
+                if (slot.connection.load(std::memory_order_relaxed))
+                {
+                    connection = slot.connection.exchange(nullptr, std::memory_order_acquire);
+                    if (connection)
+                        return connection;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief 放入共享队列，供回收和心跳之后放回连接使用
+         * @return 容器已满时返回false，由调用者释放连接
+         */
+        bool push(T *connection)
+        {
+            if (!this->_queue.push(std::move(connection)))
+                return false;
+            this->notify();
+            return true;
+        }
+
+        /**
+         * @brief 空闲连接数，其他线程同时取出和归还时只是一个近似值
+         */
+        size_t idle() const
+        {
+            size_t count = this->_queue.size();
+            size_t used = std::min(this->_nextSlot.load(std::memory_order_relaxed), kSlots);
+            for (size_t i = 0; i < used; i++)
+            {
+                if (this->_slots[i].connection.load(std::memory_order_relaxed))
+                    count++;
+            }
+            return count;
+        }
+
+    private:
+        static const size_t kSlots = 64; // 超出的线程不使用槽位，直接使用共享队列
+
+        struct Slot
+        {
+            std::atomic<T *> connection;
+            std::atomic<uint64_t> owner; // 占用槽位的线程，0表示还没有分配
+            char padding[64 - sizeof(std::atomic<T *>) - sizeof(std::atomic<uint64_t>)]; // 避免不同线程的槽位在同一缓存行
+        };
+
+        static uint64_t nextId()
+        {
+            static std::atomic<uint64_t> id(1);
+            return id.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 当前线程的唯一标识，从1开始
+         */
+        static uint64_t threadId()
+        {
+            static std::atomic<uint64_t> next(1);
+            static thread_local uint64_t id = next.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        /**
+         * @brief 当前线程在这个容器中的槽位，第一次使用时分配
+         */
+        Slot *localSlot()
+        {
+            // 每个线程记录最近使用的几个容器对应的槽位，容器的id全局唯一，不会与已经析构的容器混淆
+            struct Entry
+            {
+                uint64_t id;
+                size_t index;
+            };
+            static const size_t kEntries = 8;
+            static thread_local Entry t_entries[kEntries] = {};
+            static thread_local size_t t_next = 0;
+
+            for (size_t i = 0; i < kEntries; i++)
+            {
+                if (t_entries[i].id == this->_id)
+                    return t_entries[i].index < kSlots ? &this->_slots[t_entries[i].index] : nullptr;
+            }
+
+            // 线程轮流使用超过kEntries个容器时表项会被挤出，再次使用时找回之前分配的槽位，每个线程在一个容器中只占用一个槽位
+            uint64_t thread = threadId();
+            size_t index = kSlots;
+            size_t used = std::min(this->_nextSlot.load(std::memory_order_relaxed), kSlots);
+            for (size_t i = 0; i < used; i++)
+            {
+                if (this->_slots[i].owner.load(std::memory_order_relaxed) == thread)
+                {
+                    index = i;
+                    break;
+                }
+            }
+            if (index == kSlots && used < kSlots)
+            {
+                index = this->_nextSlot.fetch_add(1, std::memory_order_relaxed);
+                if (index < kSlots)
+                    this->_slots[index].owner.store(thread, std::memory_order_relaxed);
+                else
+                    index = kSlots;
+            }
+            Entry &entry = t_entries[t_next++ % kEntries];
+            entry.id = this->_id;
+            entry.index = index;
+            return index < kSlots ? &this->_slots[index] : nullptr;
+        }
+
+        void notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->_waiters.load(std::memory_order_relaxed))
+            {
+                std::lock_guard<std::mutex> guard(this->_mutex);
+                this->_condition.notify_one();
+            }
+        }
+
+        MpmcQueue<T *> _queue;           // 共享的空闲连接
+        Slot _slots[kSlots];             // 每个线程缓存的空闲连接
+        const uint64_t _id;              // 容器的唯一标识
+        std::atomic<size_t> _nextSlot;   // 下一个分配给线程的槽位
+        std::atomic<int> _waiters;       // 等待空闲连接的线程数
+        std::mutex _mutex;               // 只在等待时使用
+        std::condition_variable _condition;
+    };
+
+    template <typename T>
+    const size_t ConnectionCache<T>::kSlots;
+
+    /**
+     * @brief 从连接池取出的连接，析构时自动归还，只能移动不能复制，不需要额外分配内存
+     *        Pool需要提供release(T *)
+     */
+    template <typename Pool, typename T>
+    class PoolHandle
+    {
+    public:
+        PoolHandle() : _pool(nullptr), _connection(nullptr) {}
+
+        PoolHandle(std::nullptr_t) : PoolHandle() {}
+
+        PoolHandle(Pool *pool, T *connection) : _pool(pool), _connection(connection) {}
+
+        PoolHandle(PoolHandle &&other) : _pool(other._pool), _connection(other._connection)
+        {
+            other._pool = nullptr;
+            other._connection = nullptr;
+        }
+
+        PoolHandle &operator=(PoolHandle &&other)
+        {
+            if (this != &other)
+            {
+                this->reset();
+                std::swap(this->_pool, other._pool);
+                std::swap(this->_connection, other._connection);
+            }
+            return *this;
+        }
+
+        PoolHandle(const PoolHandle &) = delete;
+        PoolHandle &operator=(const PoolHandle &) = delete;
+
+        ~PoolHandle()
+        {
+            this->reset();
+        }
+
+        /**
+         * @brief 提前归还连接
+         */
+        void reset()
+        {
+            if (this->_connection)
+                this->_pool->release(this->_connection);
+            this->_pool = nullptr;
+            this->_connection = nullptr;
+        }
+
+        inline T *get() const { return this->_connection; }
+
+        inline T *operator->() const { return this->_connection; }
+
+        inline T &operator*() const { return *this->_connection; }
+
+        inline explicit operator bool() const { return this->_connection != nullptr; }
+
+        inline bool operator==(std::nullptr_t) const { return this->_connection == nullptr; }
+
+        inline bool operator!=(std::nullptr_t) const { return this->_connection != nullptr; }
+
+    private:
+        Pool *_pool;
+        T *_connection;
+    };
+};
+
+#endif //__MG_CONNECTION_CACHE_H__
@@ -0,0 +1,125 @@
+#include "cpu-affinity.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+namespace mg
+{
+    namespace cpuAffinity
+    {
+        // 读取/sys下只有一行内容的文件
+        static bool readLine(const char *path, char *buf, size_t size)
+        {
+            FILE *file = ::fopen(path, "r");
+            if (!file)
+                return false;
+            bool ok = ::fgets(buf, size, file) != nullptr;
+            ::fclose(file);
+            return ok;
+        }
+
+        int cpuCount()
+        {
+            long count = ::sysconf(_SC_NPROCESSORS_ONLN);
+            return count > 0 ? static_cast<int>(count) : 1;
+        }
+
+        int nodeCount()
+        {
+            int count = 0;
+            char path[64] = {0};
+            while (true)
+            {
+                ::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", count);
+                if (::access(path, F_OK) != 0)
+                    break;
+                count++;
+            }
+            return count ? count : 1;
+        }
+
+        std::vector<int> nodeCpus(int node)
+        {
+            std::vector<int> cpus;
+            char path[64] = {0};
+            char buf[1024] = {0};
+            ::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            if (node < 0 || !readLine(path, buf, sizeof(buf)))
+            {
+                // 没有NUMA信息时把所有CPU看作节点0
+                if (node == 0)
+                {
+                    for (int i = 0; i < cpuCount(); i++)
+                        cpus.push_back(i);
+                }
+                return cpus;
+            }
+
+            // cpulist的格式为 0-3,8-11
+            char *save = nullptr;
+            for (char *range = ::strtok_r(buf, ",\n", &save); range; range = ::strtok_r(nullptr, ",\n", &save))
+            {
+                int first = 0, last = 0;
+                int count = ::sscanf(range, "%d-%d", &first, &last);
+                if (count <= 0)
+                    continue;
+                if (count == 1)
+                    last = first;
+                for (int cpu = first; cpu <= last; cpu++)
+                    cpus.push_back(cpu);
+            }
+            return cpus;
+        }
+
+        int interfaceNode(const std::string &interface)
+        {
+            char path[128] = {0};
+            char buf[32] = {0};
+            ::snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", interface.c_str());
+            if (!readLine(path, buf, sizeof(buf)))
+                return -1;
+            return ::atoi(buf);
+        }
+
+        bool bindCurrentThread(const std::vector<int> &cpus)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : cpus)
+            {
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &set);
+            }
+            if (!CPU_COUNT(&set))
+                return false;
+            int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+            if (ret != 0)
+            {
+                LOG_WARN("pthread_setaffinity_np failed: {}", ::strerror(ret));
+                return false;
+            }
+            return true;
+        }
+
+        bool preferNode(int node)
+        {
+            const int bits = sizeof(unsigned long) * 8;
+            if (node < 0 || node >= bits)
+                return false;
+            unsigned long mask = 1UL << node;
+            // maxnode按照内核的约定比掩码的位数多1
+            if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, bits + 1) != 0)
+            {
+                LOG_WARN("set_mempolicy node {} failed: {}", node, ::strerror(errno));
+                return false;
+            }
+            return true;
+        }
+    };
+};
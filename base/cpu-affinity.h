@@ -0,0 +1,49 @@
+#ifndef __MG_CPU_AFFINITY_H__
+#define __MG_CPU_AFFINITY_H__
+
+#include <string>
+#include <vector>
+
+namespace mg
+{
+    /**
+     * @brief 线程CPU亲和性和NUMA节点相关的工具函数，NUMA信息从/sys读取，不依赖libnuma
+     */
+    namespace cpuAffinity
+    {
+        /**
+         * @brief 系统在线的CPU数量
+         */
+        int cpuCount();
+
+        /**
+         * @brief NUMA节点数量，没有NUMA信息时返回1
+         */
+        int nodeCount();
+
+        /**
+         * @brief NUMA节点包含的CPU编号
+         * @return 节点不存在时返回空
+         */
+        std::vector<int> nodeCpus(int node);
+
+        /**
+         * @brief 网卡所在的NUMA节点
+         * @param interface 网卡名称，例如eth0
+         * @return 无法确定时返回-1
+         */
+        int interfaceNode(const std::string &interface);
+
+        /**
+         * @brief 把当前线程绑定到cpus中的CPU上
+         */
+        bool bindCurrentThread(const std::vector<int> &cpus);
+
+        /**
+         * @brief 当前线程之后申请的内存优先从node节点分配，节点内存不足时再使用其他节点
+         */
+        bool preferNode(int node);
+    };
+};
+
+#endif //__MG_CPU_AFFINITY_H__
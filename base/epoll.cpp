@@ -13,6 +13,7 @@ Epoll::Epoll(EventLoop *loop) : Poller(loop)
     else
         LOG_DEBUG("EventLoop[{}] epoll is {}", loop->getLoopName(), this->_epoll_fd);
     _events.resize(_events_initial_size);
+    _channels.resize(_channels_initial_size, nullptr);
 }
 
 Epoll::~Epoll()
@@ -22,7 +23,7 @@ Epoll::~Epoll()
 
 TimeStamp Epoll::poll(std::vector<Channel *> &channelList, int timeout)
 {
-    LOG_TRACE("{} has {} channels", this->_epoll_fd, this->_channels.size());
+    LOG_TRACE("{} has {} channels", this->_epoll_fd, this->_channelNums);
     int nums = ::epoll_wait(this->_epoll_fd, _events.data(), static_cast<int>(_events.size()), timeout);
     if (nums >= 0)
     {
@@ -43,9 +44,8 @@ void mg::Epoll::updateChannel(Channel *channel)
     const int index = channel->index();
     if (index == newChannel || index == deletedChannel)
     {
-        int fd = channel->fd();
         if (index == newChannel)
-            this->_channels[fd] = channel;
+            this->addChannel(channel);
         channel->setIndex(addedChannel);
         this->update(EPOLL_CTL_ADD, channel);
         LOG_TRACE("{} EPOLL_CTL_ADD channel {}", this->_epoll_fd, channel->fd());
@@ -71,7 +71,7 @@ void mg::Epoll::removeChannel(Channel *channel)
     if (!channel)
         return;
     LOG_TRACE("{} remove channel {}", this->_epoll_fd, channel->fd());
-    this->_channels.erase(channel->fd());
+    this->eraseChannel(channel);
     if (channel->index() == addedChannel)
         this->update(EPOLL_CTL_DEL, channel);
     channel->setIndex(deletedChannel);
@@ -58,6 +58,8 @@ namespace mg
         std::vector<struct epoll_event> _events;
         // epoll管理的事件初始化大小
         const int _events_initial_size = 128;
+        // channel表初始化大小
+        const int _channels_initial_size = 1024;
     };
 }
 
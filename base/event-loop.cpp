@@ -12,7 +12,9 @@ mg::EventLoop::EventLoop(const std::string &name) : _name(name), _epoller(this),
                                                     _quit(false), _callingPendingFunctions(false),
                                                     _wakeupFd(createEventFd()),
                                                     _wakeupChannel(new Channel(this, _wakeupFd)),
-                                                    _threadId(currentThread::tid()), _timeQueue(new TimerQueue(this))
+                                                    _threadId(currentThread::tid()), _wakeupPending(false),
+                                                    _timeQueue(new TimerQueue(this)),
+                                                    _connectionCount(0), _pendingBytes(0)
 {
     if (t_loopInThisThread)
         LOG_ERROR("EventLoop[{}] existed, repeated create", _name);
@@ -77,41 +79,39 @@ bool mg::EventLoop::hasChannel(Channel *channel) const
     return this->_epoller.hasChannel(channel);
 }
 
-void mg::EventLoop::run(std::function<void()> callBack)
+void mg::EventLoop::run(Task callBack)
 {
     if (this->isInOwnerThread())
         callBack();
     else
-        push(callBack);
+        push(std::move(callBack));
 }
 
-void mg::EventLoop::push(std::function<void()> callBack)
+void mg::EventLoop::push(Task callBack)
 {
-    {
-        std::unique_lock<std::mutex> lock(this->_mutex);
-        this->_functions.emplace_back(callBack);
-    }
+    this->_functions.push(std::move(callBack));
     /*
      *  这里是 _callingPendingFunctions是个小优化，当插入回调时，线程正在执行回调。此时，
      *  队列中的回调不会被遍历到，于是会发生阻塞。
+     *  _wakeupPending合并唤醒，eventloop取回调之前只有第一个生产者需要写_wakeupFd
      */
-    if (!this->isInOwnerThread() || _callingPendingFunctions)
+    if ((!this->isInOwnerThread() || _callingPendingFunctions) && !this->_wakeupPending.exchange(true))
         this->wakeup();
 }
 
-mg::TimerId mg::EventLoop::runAt(TimeStamp time, std::function<void()> callback)
+mg::TimerId mg::EventLoop::runAt(TimeStamp time, Task callback)
 {
     return _timeQueue->addTimer(std::move(callback), time, 0.0);
 }
 
-mg::TimerId mg::EventLoop::runAfter(double delay, std::function<void()> callback)
+mg::TimerId mg::EventLoop::runAfter(double delay, Task callback)
 {
-    return this->runAt(addTime(TimeStamp::now(), delay), callback);
+    return this->runAt(addTime(TimeStamp::now(), delay), std::move(callback));
 }
 
-mg::TimerId mg::EventLoop::runEvery(double interval, std::function<void()> callback)
+mg::TimerId mg::EventLoop::runEvery(double interval, Task callback)
 {
-    return _timeQueue->addTimer(callback, addTime(TimeStamp::now(), interval), interval);
+    return _timeQueue->addTimer(std::move(callback), addTime(TimeStamp::now(), interval), interval);
 }
 
 void mg::EventLoop::cancel(TimerId timerId)
@@ -119,6 +119,11 @@ void mg::EventLoop::cancel(TimerId timerId)
     _timeQueue->cancel(timerId);
 }
 
+bool mg::EventLoop::setTimerBackend(TimerQueue::Backend backend)
+{
+    return _timeQueue->setBackend(backend);
+}
+
 int mg::EventLoop::createEventFd()
 {
     int ret = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -141,16 +146,10 @@ void mg::EventLoop::handleReadCallBack()
 
 void mg::EventLoop::doPendingFunctions()
 {
-    std::vector<std::function<void()>> memo;
     this->_callingPendingFunctions = true;
-    {
-        std::unique_lock<std::mutex> lock(this->_mutex);
-        this->_functions.swap(memo);
-    }
-    for (auto &x : memo)
-    {
-        x();
-        std::function<void()>().swap(x);
-    }
+    // 先清除唤醒标记再取回调，之后插入的回调会重新唤醒eventloop
+    this->_wakeupPending = false;
+    this->_functions.consume([](Task &x)
+                             { x(); });
     this->_callingPendingFunctions = false;
 }
@@ -6,12 +6,13 @@
 #include "time-stamp.h"
 #include "timer-queue.h"
 #include "current-thread.h"
+#include "mpsc-queue.h"
+#include "task.h"
 
 #include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
-#include <mutex>
 
 namespace mg
 {
@@ -58,7 +59,7 @@ namespace mg
         /**
          * @brief eventloop要执行的函数
          */
-        void run(std::function<void()> callBack);
+        void run(Task callBack);
 
         /**
          * @brief 判断执行函数时是否在eventloop所属的线程中执行
@@ -69,26 +70,26 @@ namespace mg
         /**
          * @brief 非eventloop所属的线程调用此方法，将待执行回调加入eventloop中以待eventloop所在线程执行
          */
-        void push(std::function<void()> callBack);
+        void push(Task callBack);
 
         /**
          * @brief 给定时间执行某个回调函数
          * @param time 给定时间
          * @param callback 待执行回调
          */
-        TimerId runAt(TimeStamp time, std::function<void()> callback);
+        TimerId runAt(TimeStamp time, Task callback);
 
         /**
          * @brief 给定延迟time秒后执行回调
          * @param time 延迟秒数
          */
-        TimerId runAfter(double delay, std::function<void()> callback);
+        TimerId runAfter(double delay, Task callback);
 
         /**
          * @brief 每delay延迟执行一次
          * @param interval 循环执行时间
          */
-        TimerId runEvery(double interval, std::function<void()> callback);
+        TimerId runEvery(double interval, Task callback);
 
         /**
          * @brief 取消定时器任务
@@ -96,11 +97,44 @@ namespace mg
          */
         void cancel(TimerId timerId);
 
+        /**
+         * @brief 选择定时器的实现，需要在所属线程中、添加定时器之前调用，
+         *        例如在EventLoopThread的初始化回调中调用
+         * @return 已经添加过定时器时返回false
+         */
+        bool setTimerBackend(TimerQueue::Backend backend);
+
         /**
          * @brief 得到当前事件循环的名称
          */
         inline const std::string &getLoopName() const { return this->_name; }
 
+        /**
+         * @brief 当前管理的连接数，任意线程都可以读取，用于选择负载最低的loop
+         */
+        inline size_t connectionCount() const { return this->_connectionCount.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief 所有连接写队列中等待发送的字节数，任意线程都可以读取
+         */
+        inline size_t pendingBytes() const { return this->_pendingBytes.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief 更新连接数，选定loop的线程和所属线程都会修改
+         */
+        inline void addConnectionCount(long delta)
+        {
+            this->_connectionCount.fetch_add(static_cast<size_t>(delta), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 更新待发送字节数，只在所属线程中调用，只有一个写者不需要原子的读改写
+         */
+        inline void addPendingBytes(long delta)
+        {
+            this->_pendingBytes.store(this->_pendingBytes.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
     private:
         // 申请_wakeupFd实例
         int createEventFd();
@@ -135,12 +169,16 @@ namespace mg
         std::shared_ptr<Channel> _wakeupChannel;
         // 当前线程所属的pid
         const pid_t _threadId;
-        // 用于同步线程安全操作（添加或者取出）
-        std::mutex _mutex;
         // 存储跨线程操作的回调集合
-        std::vector<std::function<void()>> _functions;
+        MpscQueue<Task> _functions;
+        // 是否已经有生产者唤醒了eventloop，消费者取回调之前清除，用于合并多次唤醒
+        std::atomic_bool _wakeupPending;
         // 定时器队列
         std::shared_ptr<TimerQueue> _timeQueue;
+        // 当前管理的连接数，包括已经分配到这个loop还没有建立的连接
+        std::atomic<size_t> _connectionCount;
+        // 所有连接写队列中等待发送的字节数
+        std::atomic<size_t> _pendingBytes;
     };
 };
 
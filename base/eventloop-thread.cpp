@@ -20,6 +20,16 @@ mg::EventLoopThread::~EventLoopThread()
     }
 }
 
+void mg::EventLoopThread::setCpuAffinity(std::vector<int> cpus)
+{
+    this->_thread.setCpuAffinity(std::move(cpus));
+}
+
+void mg::EventLoopThread::setNumaNode(int node)
+{
+    this->_thread.setNumaNode(node);
+}
+
 mg::EventLoop *mg::EventLoopThread::startLoop()
 {
     this->_thread.start();
@@ -20,6 +20,13 @@ namespace mg
 
         ~EventLoopThread();
 
+        /**
+         * @brief 设置线程绑定的CPU和优先申请内存的NUMA节点，需要在startLoop之前调用
+         *        eventloop、Buffer内存池等线程局部的对象都在线程启动之后创建，内存来自所在的节点
+         */
+        void setCpuAffinity(std::vector<int> cpus);
+        void setNumaNode(int node);
+
         EventLoop *startLoop();
 
         void run();
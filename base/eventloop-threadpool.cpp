@@ -1,8 +1,11 @@
 #include "eventloop-threadpool.h"
+#include "event-loop.h"
+#include "cpu-affinity.h"
+#include "log.h"
 
 mg::EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &name)
     : _baseloop(baseLoop), _name(name), _started(false),
-      _threadNums(0)
+      _threadNums(0), _policy(ROUND_ROBIN), _next(0), _numaNode(-1)
 {
     ;
 }
@@ -19,6 +22,35 @@ void mg::EventLoopThreadPool::setThreadNums(int nums)
     this->_threadNums = nums;
 }
 
+void mg::EventLoopThreadPool::setCpuAffinity(std::vector<int> cpus)
+{
+    this->_cpus = std::move(cpus);
+}
+
+bool mg::EventLoopThreadPool::setNumaNode(int node)
+{
+    std::vector<int> cpus = cpuAffinity::nodeCpus(node);
+    if (cpus.empty())
+    {
+        LOG_ERROR("{} numa node {} has no cpu", this->_name, node);
+        return false;
+    }
+    this->_nodeCpus = std::move(cpus);
+    this->_numaNode = node;
+    return true;
+}
+
+bool mg::EventLoopThreadPool::setInterfaceNode(const std::string &interface)
+{
+    int node = cpuAffinity::interfaceNode(interface);
+    if (node < 0)
+    {
+        LOG_WARN("{} unknown numa node of {}", this->_name, interface);
+        return false;
+    }
+    return this->setNumaNode(node);
+}
+
 void mg::EventLoopThreadPool::start(ThreadInitialCallback callBack)
 {
     this->_started = true;
@@ -33,35 +65,74 @@ void mg::EventLoopThreadPool::start(ThreadInitialCallback callBack)
         char buf[128] = {0};
         snprintf(buf, sizeof(buf) - 1, "%s-%d", this->_name.c_str(), i);
         EventLoopThread *temp = new EventLoopThread(buf, callBack);
+        if (!this->_cpus.empty())
+            temp->setCpuAffinity({this->_cpus[i % this->_cpus.size()]});
+        else if (!this->_nodeCpus.empty())
+            temp->setCpuAffinity(this->_nodeCpus);
+        temp->setNumaNode(this->_numaNode);
         this->_threads.push_back(std::unique_ptr<EventLoopThread>(temp));
         this->_loops.push_back(temp->startLoop());
     }
 }
 
-mg::EventLoop *mg::EventLoopThreadPool::getNextLoop()
+void mg::EventLoopThreadPool::setSelectPolicy(SelectPolicy policy)
 {
-    EventLoop *loop = this->_baseloop;
-    if (!this->_loops.empty())
+    this->_policy = policy;
+}
+
+void mg::EventLoopThreadPool::setLoopSelector(LoopSelector selector)
+{
+    this->_selector = std::move(selector);
+}
+
+mg::EventLoop *mg::EventLoopThreadPool::getNextLoop(size_t hash)
+{
+    if (this->_loops.empty())
+        return this->_baseloop;
+    if (this->_selector)
     {
-#if 0
-        //std::atomic_int _next;
-        int next = _next.fetch_add(1) % this->_loops.size();
-        loop = this->_loops[next];
-#endif
+        EventLoop *loop = this->_selector(this->_loops, hash);
+        return loop ? loop : this->_baseloop;
+    }
 
-#if 1
-        pair current, next;
-        do
-        {
-            current = _next.load(std::memory_order_acquire);
-            next.first = (current.first + 1) % this->_loops.size();
-            next.second = current.second + 1;
-            loop = this->_loops[next.first];
-        } while (!_next.compare_exchange_weak(current, next, std::memory_order_acquire));
+    switch (this->_policy)
+    {
+    case LEAST_CONNECTIONS:
+        return this->getLeastLoaded([](EventLoop *loop)
+                                    { return loop->connectionCount(); });
+    case LEAST_PENDING_BYTES:
+        return this->getLeastLoaded([](EventLoop *loop)
+                                    { return loop->pendingBytes(); });
+    case ADDRESS_HASH:
+        return this->_loops[hash % this->_loops.size()];
+    default:
+        return this->_loops[this->_next.fetch_add(1, std::memory_order_relaxed) % this->_loops.size()];
+    }
+}
 
-#endif
+template <typename Load>
+mg::EventLoop *mg::EventLoopThreadPool::getLeastLoaded(Load load)
+{
+    size_t size = this->_loops.size();
+    size_t start = this->_next.fetch_add(1, std::memory_order_relaxed) % size;
+    EventLoop *result = this->_loops[start];
+    size_t minLoad = load(result);
+    size_t minConnections = result->connectionCount();
+    for (size_t i = 1; i < size && (minLoad || minConnections); i++)
+    {
+        EventLoop *loop = this->_loops[(start + i) % size];
+        size_t current = load(loop);
+        if (current > minLoad)
+            continue;
+        size_t connections = loop->connectionCount();
+        if (current < minLoad || connections < minConnections)
+        {
+            result = loop;
+            minLoad = current;
+            minConnections = connections;
+        }
     }
-    return loop;
+    return result;
 }
 
 std::vector<mg::EventLoop *> mg::EventLoopThreadPool::getAllEventLoops()
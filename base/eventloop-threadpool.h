@@ -3,6 +3,7 @@
 
 #include "eventloop-thread.h"
 
+#include <atomic>
 #include <functional>
 #include <vector>
 
@@ -14,6 +15,23 @@ namespace mg
     public:
         using ThreadInitialCallback = std::function<void(EventLoop *)>;
 
+        /**
+         * @brief 为新连接选择eventloop的策略
+         */
+        enum SelectPolicy
+        {
+            ROUND_ROBIN = 0,         // 轮询
+            LEAST_CONNECTIONS = 1,   // 连接数最少
+            LEAST_PENDING_BYTES = 2, // 写队列中等待发送的字节数最少
+            ADDRESS_HASH = 3,        // 按照对端IP的哈希值固定分配，同一个客户端总是落在同一个loop
+        };
+
+        /**
+         * @brief 自定义的选择函数，hash为对端IP的哈希值，返回loops中的一个实例
+         *        会在接受连接的线程中调用，不能阻塞
+         */
+        using LoopSelector = std::function<EventLoop *(const std::vector<EventLoop *> &loops, size_t hash)>;
+
         EventLoopThreadPool(EventLoop *baseLoop, const std::string &name);
 
         ~EventLoopThreadPool();
@@ -23,16 +41,46 @@ namespace mg
          */
         void setThreadNums(int nums);
 
+        /**
+         * @brief 第i个loop线程绑定到cpus[i % cpus.size()]上，需要在start之前调用
+         *        开启SO_REUSEPORT并且网卡有多个接收队列时，按顺序传入处理各队列中断的CPU，
+         *        每个loop就运行在它服务的队列旁边
+         */
+        void setCpuAffinity(std::vector<int> cpus);
+
+        /**
+         * @brief loop线程限制在node节点的CPU上运行，并优先从该节点申请内存，需要在start之前调用
+         *        可以和setCpuAffinity同时使用
+         */
+        bool setNumaNode(int node);
+
+        /**
+         * @brief loop线程放在网卡所在的NUMA节点上
+         * @return 无法确定网卡所在的节点时返回false
+         */
+        bool setInterfaceNode(const std::string &interface);
+
         /**
          * @brief 启动线程池
          */
         void start(ThreadInitialCallback callBack = ThreadInitialCallback());
 
         /**
-         * @brief 以轮询方式得到下一个eventloop实例
+         * @brief 设置选择eventloop的策略，需要在start之前调用，默认为轮询
+         */
+        void setSelectPolicy(SelectPolicy policy);
+
+        /**
+         * @brief 使用自定义的选择函数，优先于setSelectPolicy，需要在start之前调用
+         */
+        void setLoopSelector(LoopSelector selector);
+
+        /**
+         * @brief 按照选择策略得到下一个eventloop实例，只读取各个loop的原子计数，不加锁
+         * @param hash 对端IP的哈希值，只有ADDRESS_HASH和自定义的选择函数使用
          * @return 返回指向实例的指针
          */
-        EventLoop *getNextLoop();
+        EventLoop *getNextLoop(size_t hash = 0);
 
         /**
          * @brief 得到包含所有实例的指针
@@ -49,13 +97,19 @@ namespace mg
         int _threadNums;                                        // 线程数
         std::vector<std::unique_ptr<EventLoopThread>> _threads; // 线程集合
         std::vector<EventLoop *> _loops;                        // 事件循环集合
+        SelectPolicy _policy;                                   // 选择eventloop的策略
+        LoopSelector _selector;                                 // 自定义的选择函数
+        std::atomic<size_t> _next;                              // 下一个轮询到的事件循环下标
+        std::vector<int> _cpus;                                 // 各个loop线程依次绑定的CPU
+        std::vector<int> _nodeCpus;                             // NUMA节点的CPU
+        int _numaNode;                                          // loop线程所在的NUMA节点，-1表示不设置
 
-        struct pair
-        {
-            int first = 0;
-            int second = 0;
-        };
-        std::atomic<pair> _next; // 下一个轮询到的时间循环下标
+        /**
+         * @brief 从轮询位置开始找load最小的loop，load相同时选连接数少的，都相同时依次轮换，避免总是选中第一个
+         *        新连接在选定loop之后立即计入连接数，一次accept的一批连接不会都分到同一个loop
+         */
+        template <typename Load>
+        EventLoop *getLeastLoaded(Load load);
     };
 };
 
@@ -2,6 +2,7 @@
 #define __MG_FUNCTION_CALLBACK_H__
 
 #include "time-stamp.h"
+#include "string-view.h"
 
 #include <functional>
 #include <memory>
@@ -29,6 +30,7 @@ namespace mg
     using HttpConnectionCallback = BaseHandler<const HttpConnectionPointer &>;
     using MessageDataCallback = BaseHandler<const TcpConnectionPointer &, Buffer *, TimeStamp>;
     using HttpMessageCallback = BaseHandler<const HttpConnectionPointer &, http::HttpRequest *, TimeStamp>;
+    using HttpBodyCallback = BaseHandler<const HttpConnectionPointer &, http::HttpRequest *, StringView, bool>;
     using WriteCompleteCallback = BaseHandler<const TcpConnectionPointer &>;
     using HttpCompleteCallback = BaseHandler<const HttpConnectionPointer &>;
     using ConnectionClosedCallback = BaseHandler<const TcpConnectionPointer &>;
@@ -2,10 +2,16 @@
 #include "event-loop.h"
 #include "log.h"
 
+#include <algorithm>
+#include <string.h>
+
 mg::http::HttpConnection::HttpConnection(EventLoop *loop, const std::string &name, int sockfd,
                                          const InternetAddress &localAddress, const InternetAddress &peerAddress)
-    : TcpConnection(loop, name, sockfd, localAddress, peerAddress)
+    : TcpConnection(loop, name, sockfd, localAddress, peerAddress),
+      _firstSequence(0), _nextSequence(0), _maxPipelineRequests(16), _processing(false), _stalled(false), _closing(false),
+      _streamThreshold(64 * 1024), _streamHighWaterMark(1024 * 1024), _readingBody(false), _bodyRemaining(0)
 {
+    ::memset(&this->_chunkedDecoder, 0, sizeof(this->_chunkedDecoder));
     ;
 }
 
@@ -24,6 +30,9 @@ void mg::http::HttpConnection::connectionEstablished()
     this->setConnectionState(CONNECTED);
     this->_channel->tie(shared_from_this());
     this->_channel->enableReading();
+    if (this->_idleList)
+        this->_idleList->add(this);
+    this->addLoopLoad();
 
     if (this->_httpConnectionCallback)
         this->_httpConnectionCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()));
@@ -33,13 +42,17 @@ void mg::http::HttpConnection::connectionDestoryed()
 {
     LOG_TRACE("{} destroyed", this->_name);
     assert(_loop->isInOwnerThread());
-    if (this->_state == CONNECTED)
+    if (this->_state == CONNECTED || this->_state == DISCONNECTING)
     {
         this->setConnectionState(DISCONNECTED);
         this->_channel->disableAllEvents();
+        this->clearPending();
         if (this->_httpConnectionCallback)
             this->_httpConnectionCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()));
     }
+    if (this->_idleList)
+        this->_idleList->remove(this);
+    this->removeLoopLoad();
     this->_channel->remove();
 }
 
@@ -53,16 +66,416 @@ void mg::http::HttpConnection::setWriteCompleteCallback(HttpCompleteCallback cal
     this->_httpWriteCompleteCallback = std::move(callback);
 }
 
-void mg::http::HttpConnection::send(mg::http::HttpResponse &response)
+void mg::http::HttpConnection::setBodyCallback(HttpBodyCallback callback)
+{
+    this->_httpBodyCallback = std::move(callback);
+}
+
+void mg::http::HttpConnection::setStreamThreshold(size_t threshold)
+{
+    this->_streamThreshold = threshold;
+}
+
+void mg::http::HttpConnection::setStreamHighWaterMark(size_t bytes)
+{
+    this->_streamHighWaterMark = bytes;
+}
+
+void mg::http::HttpConnection::setMaxPipelineRequests(size_t count)
+{
+    this->_maxPipelineRequests = count ? count : 1;
+}
+
+void mg::http::HttpConnection::send(const mg::http::HttpResponse &response)
+{
+    if (this->_state != CONNECTED)
+        return;
+    // 其他线程中执行时最早的未应答请求可能已经不是要回应的那个，应答会错位，只能用带序号的send
+    if (!this->_loop->isInOwnerThread())
+    {
+        LOG_ERROR("[{}] send without sequence outside the loop thread, response dropped", this->_name);
+        return;
+    }
+    uint64_t sequence = 0;
+    if (this->oldestUnanswered(sequence))
+        this->respondInOwnerLoop(sequence, response, nullptr);
+    else
+        LOG_WARN("[{}] no request to respond", this->_name);
+}
+
+void mg::http::HttpConnection::send(mg::http::HttpResponse &&response)
+{
+    if (this->_state != CONNECTED)
+        return;
+    // 其他线程中执行时最早的未应答请求可能已经不是要回应的那个，应答会错位，只能用带序号的send
+    if (!this->_loop->isInOwnerThread())
+    {
+        LOG_ERROR("[{}] send without sequence outside the loop thread, response dropped", this->_name);
+        return;
+    }
+    uint64_t sequence = 0;
+    if (this->oldestUnanswered(sequence))
+        this->respondInOwnerLoop(sequence, response, &response.body);
+    else
+        LOG_WARN("[{}] no request to respond", this->_name);
+}
+
+void mg::http::HttpConnection::send(uint64_t sequence, const mg::http::HttpResponse &response)
+{
+    if (this->_state != CONNECTED)
+        return;
+    if (this->_loop->isInOwnerThread())
+    {
+        this->respondInOwnerLoop(sequence, response, nullptr);
+        return;
+    }
+    std::shared_ptr<HttpResponse> copy = std::make_shared<HttpResponse>(response);
+    HttpConnectionPointer self = std::static_pointer_cast<HttpConnection>(shared_from_this());
+    this->_loop->run([self, sequence, copy]()
+                     { self->respondInOwnerLoop(sequence, *copy, &copy->body); });
+}
+
+void mg::http::HttpConnection::send(uint64_t sequence, mg::http::HttpResponse &&response)
+{
+    if (this->_state != CONNECTED)
+        return;
+    if (this->_loop->isInOwnerThread())
+    {
+        this->respondInOwnerLoop(sequence, response, &response.body);
+        return;
+    }
+    std::shared_ptr<HttpResponse> moved = std::make_shared<HttpResponse>(std::move(response));
+    HttpConnectionPointer self = std::static_pointer_cast<HttpConnection>(shared_from_this());
+    this->_loop->run([self, sequence, moved]()
+                     { self->respondInOwnerLoop(sequence, *moved, &moved->body); });
+}
+
+void mg::http::HttpConnection::respondInOwnerLoop(uint64_t sequence, const mg::http::HttpResponse &response, std::string *body)
+{
+    if (this->_state != CONNECTED)
+        return;
+    PendingResponse *pending = this->pendingSlot(sequence);
+    if (!pending || pending->ready)
+    {
+        LOG_WARN("[{}] request {} already responded", this->_name, sequence);
+        return;
+    }
+
+    PendingResponse &slot = *pending;
+    StringView connection = response.getHeader("Connection");
+    bool close = slot.close || connection.equalsIgnoreCase("close");
+    const char *extra = close ? "close" : slot.connection;
+
+    if (sequence != this->_firstSequence)
+    {
+        // 前面还有没完成的应答，先保存起来
+        slot.ready = true;
+        slot.close = close;
+        response.serializeHead(slot.head, extra);
+        if (response.file)
+        {
+            slot.file = response.file;
+            slot.fileOffset = response.fileOffset;
+            slot.fileLength = response.fileLength;
+        }
+        else if (response.sharedBody)
+            slot.sharedBody = response.sharedBody;
+        else if (body)
+            slot.body = std::move(*body);
+        else
+            slot.body = response.body;
+        return;
+    }
+
+    this->_head.clear();
+    response.serializeHead(this->_head, extra);
+    if (response.file)
+        this->sendInOwnerLoop(this->_head.data(), this->_head.size(), response.file, response.fileOffset, response.fileLength);
+    else if (response.sharedBody)
+        this->sendInOwnerLoop(this->_head.data(), this->_head.size(), response.sharedBody);
+    else if (body)
+        this->sendInOwnerLoop(this->_head.data(), this->_head.size(), std::move(*body));
+    else
+        this->sendInOwnerLoop(this->_head.data(), this->_head.size(), response.body.data(), response.body.size());
+    this->popPending();
+    if (close)
+        this->closeAfterResponse();
+    else
+        this->flushResponses();
+}
+
+mg::http::HttpResponseWriterPointer mg::http::HttpConnection::startResponse(const mg::http::HttpResponse &response)
+{
+    uint64_t sequence = 0;
+    if (!this->oldestUnanswered(sequence))
+    {
+        LOG_WARN("[{}] no request to respond", this->_name);
+        return nullptr;
+    }
+    return this->startResponse(sequence, response);
+}
+
+mg::http::HttpResponseWriterPointer mg::http::HttpConnection::startResponse(uint64_t sequence, const mg::http::HttpResponse &response)
+{
+    assert(this->_loop->isInOwnerThread());
+    if (this->_state != CONNECTED)
+        return nullptr;
+    PendingResponse *pending = this->pendingSlot(sequence);
+    if (!pending || pending->ready)
+    {
+        LOG_WARN("[{}] request {} already responded", this->_name, sequence);
+        return nullptr;
+    }
+
+    PendingResponse &slot = *pending;
+    // HTTP/1.0没有分块编码，只能用关闭连接表示应答结束
+    bool chunked = slot.minorVersion >= 1;
+    bool close = slot.close || !chunked || response.getHeader("Connection").equalsIgnoreCase("close");
+    HttpResponseWriterPointer writer = std::make_shared<HttpResponseWriter>(
+        std::static_pointer_cast<HttpConnection>(shared_from_this()), sequence, chunked);
+    slot.ready = true;
+    slot.close = close;
+    slot.streamEnded = false;
+    slot.writer = writer;
+    slot.head.clear();
+    response.serializeStreamHead(slot.head, close ? "close" : slot.connection, chunked);
+    if (sequence == this->_firstSequence)
+        this->flushResponses();
+    return writer;
+}
+
+bool mg::http::HttpConnection::streamWritable(uint64_t sequence) const
+{
+    size_t highWaterMark = std::min(this->_streamHighWaterMark, static_cast<size_t>(this->_highWaterMark));
+    return this->_state == CONNECTED && sequence == this->_firstSequence && this->_outputQueue.readableBytes() < highWaterMark;
+}
+
+bool mg::http::HttpConnection::writeStream(uint64_t sequence, const char *head, int headLen, const void *data, size_t len)
+{
+    PendingResponse *slot = this->pendingSlot(sequence);
+    if (this->_state != CONNECTED || !slot || !slot->writer)
+        return false;
+    if (sequence == this->_firstSequence)
+        this->sendInOwnerLoop(head, headLen, data, static_cast<int>(len));
+    else
+    {
+        slot->body.append(head, headLen);
+        slot->body.append(static_cast<const char *>(data), len);
+    }
+    return true;
+}
+
+bool mg::http::HttpConnection::writeStream(uint64_t sequence, const char *head, int headLen, std::string &&data)
+{
+    PendingResponse *slot = this->pendingSlot(sequence);
+    if (this->_state != CONNECTED || !slot || !slot->writer)
+        return false;
+    if (sequence == this->_firstSequence)
+        this->sendInOwnerLoop(head, headLen, std::move(data));
+    else
+    {
+        slot->body.append(head, headLen);
+        slot->body.append(data);
+    }
+    return true;
+}
+
+bool mg::http::HttpConnection::writeStream(uint64_t sequence, const char *head, int headLen, const SharedBuffer &data)
+{
+    PendingResponse *slot = this->pendingSlot(sequence);
+    if (this->_state != CONNECTED || !slot || !slot->writer)
+        return false;
+    if (sequence == this->_firstSequence)
+        this->sendInOwnerLoop(head, headLen, data);
+    else
+    {
+        slot->body.append(head, headLen);
+        slot->body.append(*data);
+    }
+    return true;
+}
+
+bool mg::http::HttpConnection::endStream(uint64_t sequence, const char *tail, int tailLen)
+{
+    PendingResponse *slot = this->pendingSlot(sequence);
+    if (this->_state != CONNECTED || !slot || !slot->writer)
+        return false;
+    slot->writer->close();
+    slot->streamEnded = true;
+    if (sequence != this->_firstSequence)
+    {
+        slot->body.append(tail, tailLen);
+        return true;
+    }
+    if (tailLen > 0)
+        this->sendInOwnerLoop(tail, tailLen);
+    bool close = slot->close;
+    this->popPending();
+    if (close)
+        this->closeAfterResponse();
+    else
+        this->flushResponses();
+    return true;
+}
+
+void mg::http::HttpConnection::notifyWritable()
+{
+    if (this->_firstSequence == this->_nextSequence)
+        return;
+    PendingResponse &slot = *this->pendingSlot(this->_firstSequence);
+    HttpResponseWriterPointer writer = slot.writer;
+    if (!writer || writer->_closed || !writer->_writableCallback || writer->_notifyPending)
+        return;
+    // 写出数据时可能同步触发写完成，推迟到本轮事件处理完之后调用，避免生产者递归
+    writer->_notifyPending = true;
+    this->_loop->push([writer]()
+                      {
+                          writer->_notifyPending = false;
+                          if (!writer->writable())
+                              return;
+                          Handler callback = writer->_writableCallback;
+                          if (callback)
+                              callback(); //
+                      });
+}
+
+void mg::http::HttpConnection::flushResponses()
 {
-    this->mg::TcpConnection::send(response.dump());
+    while (this->_firstSequence != this->_nextSequence)
+    {
+        PendingResponse &slot = *this->pendingSlot(this->_firstSequence);
+        if (slot.continueOwed)
+        {
+            // 已经有最终应答时不再需要中间应答
+            slot.continueOwed = false;
+            if (!slot.ready)
+                this->sendContinue();
+        }
+        if (!slot.ready)
+            break;
+        bool close = slot.close;
+        if (slot.file)
+            this->sendInOwnerLoop(slot.head.data(), slot.head.size(), slot.file, slot.fileOffset, slot.fileLength);
+        else if (slot.sharedBody)
+            this->sendInOwnerLoop(slot.head.data(), slot.head.size(), slot.sharedBody);
+        else if (!slot.head.empty() || !slot.body.empty())
+            this->sendInOwnerLoop(slot.head.data(), slot.head.size(), std::move(slot.body));
+        if (slot.writer && !slot.streamEnded)
+        {
+            // 流式应答轮到了，之后的数据直接写出，写完之前后面的应答继续等待
+            slot.head.clear();
+            slot.body.clear();
+            this->notifyWritable();
+            return;
+        }
+        this->popPending();
+        if (close)
+        {
+            this->closeAfterResponse();
+            return;
+        }
+    }
+
+    // 有空闲的槽位之后继续处理缓冲区中剩余的请求，缓冲区过大时暂停的读只能在这里恢复
+    if (this->_stalled && this->_nextSequence - this->_firstSequence < this->_maxPipelineRequests)
+    {
+        this->processRequests();
+        this->resumeReadIfDrained();
+    }
+}
+
+void mg::http::HttpConnection::sendContinue()
+{
+    this->sendInOwnerLoop("HTTP/1.1 100 Continue\r\n\r\n", 25);
+}
+
+bool mg::http::HttpConnection::oldestUnanswered(uint64_t &sequence) const
+{
+    for (uint64_t i = this->_firstSequence; i != this->_nextSequence; i++)
+    {
+        if (!this->_pending[i % this->_pending.size()].ready)
+        {
+            sequence = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+mg::http::HttpConnection::PendingResponse *mg::http::HttpConnection::pendingSlot(uint64_t sequence)
+{
+    if (sequence < this->_firstSequence || sequence >= this->_nextSequence)
+        return nullptr;
+    return &this->_pending[sequence % this->_pending.size()];
+}
+
+void mg::http::HttpConnection::popPending()
+{
+    PendingResponse &slot = this->_pending[this->_firstSequence % this->_pending.size()];
+    slot.head.clear();
+    slot.body.clear();
+    slot.sharedBody.reset();
+    slot.file.reset();
+    if (slot.writer)
+    {
+        slot.writer->close();
+        slot.writer.reset();
+    }
+    this->_firstSequence++;
+}
+
+void mg::http::HttpConnection::clearPending()
+{
+    while (this->_firstSequence != this->_nextSequence)
+        this->popPending();
+}
+
+void mg::http::HttpConnection::closeAfterResponse()
+{
+    this->clearPending();
+    this->_closing = true;
+    // 正在解析时由processRequests在取走当前请求之后丢弃剩余数据
+    if (!this->_processing)
+        this->_readBuffer.retrieve(this->_readBuffer.readableBytes());
+    this->shutdown();
 }
 
 void mg::http::HttpConnection::onRead(TimeStamp time)
 {
-    while (1)
+    this->_lastReadTime = time;
+    // 已经决定关闭连接，后续的数据直接丢弃
+    if (this->_closing)
     {
-        int ret = mg::http::parse(this->_readBuffer, this->_request);
+        this->_readBuffer.retrieve(this->_readBuffer.readableBytes());
+        return;
+    }
+    this->processRequests();
+}
+
+void mg::http::HttpConnection::processRequests()
+{
+    if (this->_processing)
+        return;
+    this->_processing = true;
+    this->_stalled = false;
+    while (!this->_closing && this->_state == CONNECTED)
+    {
+        if (this->_readingBody)
+        {
+            if (!this->readBody())
+                break;
+            continue;
+        }
+
+        if (this->_nextSequence - this->_firstSequence >= this->_maxPipelineRequests)
+        {
+            this->_stalled = true;
+            break;
+        }
+
+        // 没有请求体回调时整个请求都要放在缓冲区中
+        size_t threshold = this->_httpBodyCallback ? this->_streamThreshold : SIZE_MAX;
+        int ret = mg::http::parse(this->_readBuffer, this->_request, threshold);
         if (ret < 0)
         {
             if (ret == -1)
@@ -70,21 +483,160 @@ void mg::http::HttpConnection::onRead(TimeStamp time)
                 LOG_ERROR("[{}] invalid http message", this->name());
                 this->forceClose();
             }
-            return;
+            else if (this->_request.pendingLength > this->_maxReadBufferSize)
+            {
+                LOG_ERROR("[{}] request body too large: {}", this->name(), this->_request.pendingLength);
+                this->beginRequest(false, 1);
+                this->rejectRequest(HttpStatus::PAYLOAD_TOO_LARGE);
+            }
+            break;
         }
 
-        if (this->_httpMessageCallback)
-            this->_httpMessageCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()), &this->_request, time);
-        else
-            LOG_ERROR("[{}] no message callback", this->name());
+        this->beginRequest(this->_request.isKeepAlive(), this->_request.getMinorVersion());
+        if (!this->_request.hasPendingBody())
+        {
+            // 请求中的视图指向读缓冲区，回调返回之后才能取走数据
+            this->dispatchRequest();
+            this->_readBuffer.retrieve(ret);
+            continue;
+        }
+
+        // 请求体分段读取，头部取走之后请求还要继续使用
+        this->_request = this->_request.detach();
+        this->_readBuffer.retrieve(ret);
+        this->_readingBody = true;
+        this->_bodyRemaining = this->_request.getContentLength();
+        ::memset(&this->_chunkedDecoder, 0, sizeof(this->_chunkedDecoder));
+        this->_chunkedDecoder.consume_trailer = 1;
+        // 客户端等待100 Continue之后才发送请求体，前面的应答都已经写出时才能发送中间应答，否则由flushResponses在轮到它时发送
+        if (this->_request.getHeader("Expect").equalsIgnoreCase("100-continue"))
+        {
+            if (this->_request.getSequence() == this->_firstSequence)
+                this->sendContinue();
+            else
+                this->_pending[this->_request.getSequence() % this->_pending.size()].continueOwed = true;
+        }
+        if (this->_httpBodyCallback)
+            this->dispatchRequest();
+    }
+    this->_processing = false;
+    if (this->_closing)
+        this->_readBuffer.retrieve(this->_readBuffer.readableBytes());
+}
+
+void mg::http::HttpConnection::beginRequest(bool keepAlive, int minorVersion)
+{
+    // 槽位数量在第一个请求到达时确定，之后只复用不再分配
+    if (this->_pending.empty())
+        this->_pending.resize(this->_maxPipelineRequests);
+    this->_request.sequence = this->_nextSequence++;
+    PendingResponse &slot = this->_pending[this->_request.sequence % this->_pending.size()];
+    slot.ready = false;
+    slot.close = !keepAlive;
+    slot.minorVersion = minorVersion;
+    slot.streamEnded = false;
+    slot.continueOwed = false;
+    // HTTP/1.0默认关闭连接，保持连接时需要在应答中明确告知
+    if (slot.close)
+        slot.connection = "close";
+    else
+        slot.connection = minorVersion == 0 ? "keep-alive" : nullptr;
+    // 要求关闭连接的请求之后的请求不再处理
+    if (!keepAlive)
+        this->_closing = true;
+}
+
+void mg::http::HttpConnection::dispatchRequest()
+{
+    if (this->_httpMessageCallback)
+        this->_httpMessageCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()), &this->_request, this->_lastReadTime);
+    else
+        LOG_ERROR("[{}] no message callback", this->name());
+}
+
+bool mg::http::HttpConnection::readBody()
+{
+    int readable = this->_readBuffer.readableBytes();
+    if (readable == 0)
+        return false;
+    char *data = reinterpret_cast<char *>(this->_readBuffer.readPeek());
+
+    if (!this->_request.isChunked())
+    {
+        size_t len = std::min(static_cast<size_t>(readable), this->_bodyRemaining);
+        this->_bodyRemaining -= len;
+        bool last = this->_bodyRemaining == 0;
+        this->deliverBody(StringView(data, len), last);
+        this->_readBuffer.retrieve(len);
+        return last;
+    }
+
+    // 原地解码，解码后的数据移到开头，结束时剩余的下一个请求的数据紧跟在解码数据之后
+    size_t size = readable;
+    ssize_t left = ::phr_decode_chunked(&this->_chunkedDecoder, data, &size);
+    if (left == -1)
+    {
+        LOG_ERROR("[{}] invalid chunked body", this->name());
+        this->_readingBody = false;
+        this->forceClose();
+        return false;
+    }
+    bool last = left >= 0;
+    // 下一个请求的数据移回缓冲区末尾，取走前面的部分之后就是完整的可读数据
+    if (last && left > 0)
+        ::memmove(data + readable - left, data + size, left);
+    this->deliverBody(StringView(data, size), last);
+    this->_readBuffer.retrieve(last ? readable - static_cast<int>(left) : readable);
+    return last;
+}
+
+void mg::http::HttpConnection::deliverBody(StringView data, bool last)
+{
+    if (last)
+        this->_readingBody = false;
+    if (this->_httpBodyCallback)
+    {
+        if (!data.empty() || last)
+            this->_httpBodyCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()), &this->_request, data, last);
+        return;
+    }
+
+    this->_chunkedBody.append(data.data(), data.size());
+    if (this->_chunkedBody.size() > this->_maxReadBufferSize)
+    {
+        LOG_ERROR("[{}] chunked body too large", this->name());
+        this->_readingBody = false;
+        std::string().swap(this->_chunkedBody);
+        this->rejectRequest(HttpStatus::PAYLOAD_TOO_LARGE);
+        return;
     }
+    if (last)
+    {
+        this->_request.body = StringView(this->_chunkedBody);
+        this->_request.bodyPending = false;
+        this->dispatchRequest();
+        std::string().swap(this->_chunkedBody);
+    }
+}
+
+void mg::http::HttpConnection::rejectRequest(HttpStatus status)
+{
+    this->_closing = true;
+    HttpResponse response;
+    response.setStatus(status);
+    response.setHeader("Connection", "close");
+    this->respondInOwnerLoop(this->_nextSequence - 1, response, nullptr);
 }
 
 void mg::http::HttpConnection::handleClose()
 {
     this->setConnectionState(DISCONNECTED);
+    this->clearPending();
     this->_channel->disableAllEvents();
     this->clearTimer();
+    if (this->_idleList)
+        this->_idleList->remove(this);
+    this->removeLoopLoad();
     HttpConnectionPointer temp = std::static_pointer_cast<HttpConnection>(shared_from_this());
     if (this->_httpConnectionCallback)
         this->_httpConnectionCallback(temp);
@@ -98,6 +650,7 @@ void mg::http::HttpConnection::handleClose()
 
 void mg::http::HttpConnection::onWriteComplete()
 {
+    this->notifyWritable();
     if (this->_httpWriteCompleteCallback)
         this->_httpWriteCompleteCallback(std::static_pointer_cast<HttpConnection>(shared_from_this()));
     else
@@ -1,10 +1,19 @@
 #include "tcp-connection.h"
 #include "http-parser.h"
+#include "http-response-writer.h"
+
+#include <vector>
 
 namespace mg
 {
     namespace http
     {
+        /**
+         * @brief http连接，支持HTTP/1.1流水线：每个请求按照到达顺序占用一个应答槽位，
+         *        应答可以乱序完成，但是总是按照请求的顺序写出
+         *        请求要求关闭连接时，写出它的应答之后关闭连接，并且不再处理之后的请求
+         *        设置了HttpBodyCallback时，分块编码和较大的请求体在收到头部后分段交付，缓冲区只保存一次读到的数据
+         */
         class HttpConnection : public TcpConnection
         {
         public:
@@ -19,22 +28,205 @@ namespace mg
 
             void setWriteCompleteCallback(HttpCompleteCallback callback);
 
+            /**
+             * @brief 设置之后，分块编码或者Content-Length超过阈值的请求在头部完整时就调用HttpMessageCallback，
+             *        请求体每收到一段调用一次callback，最后一次的last为true，之后才能应答这个请求
+             *        回调中可以调用stopReadInLoop暂停读取，处理完之后调用startReadInLoop继续，已经读到的数据仍然会交付
+             */
+            void setBodyCallback(HttpBodyCallback callback);
+
+            /**
+             * @brief Content-Length超过该值时分段交付请求体，默认64KB
+             */
+            void setStreamThreshold(size_t threshold);
+
+            /**
+             * @brief 写队列超过该长度时流式应答暂停生产，默认1MB
+             *        与setHighWaterMarkCallback设置的高水位取较小的一个，连接的高水位默认64MB，不适合限制流式应答的内存
+             */
+            void setStreamHighWaterMark(size_t bytes);
+
             void connectionEstablished() override;
 
             void connectionDestoryed() override;
 
-            void send(http::HttpResponse &response);
+            /**
+             * @brief 同时等待应答的请求数上限，达到上限之后暂停解析新的请求，默认16，需要在连接建立之前设置
+             */
+            void setMaxPipelineRequests(size_t count);
+
+            /**
+             * @brief 回应最早的一个还没有应答的请求，用于在消息回调中同步应答，只能在所属loop线程中调用
+             *        其他线程中调用时记录错误并丢弃应答，异步应答使用带序号的send
+             *        轮到这个应答并且在所属loop中发送时，头部和数据体一次writev写出，不拷贝数据体；
+             *        文件数据体在头部之后用sendfile写出
+             */
+            void send(const http::HttpResponse &response);
+
+            /**
+             * @brief 数据体没有写完或者需要等待前面的应答时直接移入队列
+             */
+            void send(http::HttpResponse &&response);
+
+            /**
+             * @brief 回应指定序号的请求，可以在任意线程中调用，前面的请求还没有应答时先暂存
+             * @param sequence HttpRequest::getSequence()
+             */
+            void send(uint64_t sequence, const http::HttpResponse &response);
+
+            void send(uint64_t sequence, http::HttpResponse &&response);
+
+            /**
+             * @brief 开始流式回应指定的请求，使用返回的writer逐段写出数据体，只能在所属loop线程中调用
+             *        前面的应答还没有写出时先写入槽位，轮到之后才可写
+             * @return 请求不存在或者已经应答时返回nullptr
+             */
+            HttpResponseWriterPointer startResponse(uint64_t sequence, const http::HttpResponse &response);
+
+            /**
+             * @brief 流式回应最早的一个还没有应答的请求
+             */
+            HttpResponseWriterPointer startResponse(const http::HttpResponse &response);
 
         private:
+            friend class HttpResponseWriter;
+
+            /**
+             * @brief 一个请求的应答槽位，应答先于前面的请求完成时保存在这里
+             */
+            struct PendingResponse
+            {
+                bool ready;             // 应答已经完成
+                bool close;             // 写出应答之后关闭连接
+                const char *connection; // 应答没有设置时追加的Connection头部
+                int minorVersion;       // 请求的HTTP/1.x版本，HTTP/1.0不支持分块编码
+                bool streamEnded;       // 流式应答已经结束
+                bool continueOwed;      // 请求带有Expect: 100-continue，轮到它时还要发送中间应答
+                std::string head;
+                std::string body;       // 流式应答轮到之前写出的数据也暂存在这里
+                SharedBuffer sharedBody;
+                SharedFile file;        // 文件数据体，轮到时用sendfile写出
+                off_t fileOffset;
+                size_t fileLength;
+                HttpResponseWriterPointer writer; // 流式应答
+            };
+
             void onRead(TimeStamp time) override;
 
+            /**
+             * @brief 解析并处理读缓冲区中的请求，直到数据不完整或者等待应答的请求达到上限
+             */
+            void processRequests();
+
+            /**
+             * @brief 在所属loop中回应请求
+             * @param body 不为空时可以从中移走数据体
+             */
+            void respondInOwnerLoop(uint64_t sequence, const http::HttpResponse &response, std::string *body);
+
+            /**
+             * @brief 按顺序写出队列头部已经完成的应答
+             */
+            void flushResponses();
+
+            /**
+             * @brief 发送100 Continue中间应答，需要在前面的应答都已经写出之后调用
+             */
+            void sendContinue();
+
+            /**
+             * @brief 最早的还没有应答的请求序号，没有时返回false
+             */
+            bool oldestUnanswered(uint64_t &sequence) const;
+
+            /**
+             * @brief 序号对应的槽位，序号不在等待应答的范围内时返回nullptr
+             */
+            PendingResponse *pendingSlot(uint64_t sequence);
+
+            /**
+             * @brief 释放队列头部的槽位，保留字符串的容量给之后的请求使用
+             */
+            void popPending();
+
+            /**
+             * @brief 丢弃所有等待应答的请求
+             */
+            void clearPending();
+
+            /**
+             * @brief 需要关闭连接的应答写出之后，丢弃后续的请求并在写队列发送完之后关闭写端
+             */
+            void closeAfterResponse();
+
+            /**
+             * @brief 为新解析的请求分配应答槽位和序号
+             */
+            void beginRequest(bool keepAlive, int minorVersion);
+
+            /**
+             * @brief 读取当前请求缓冲区中的请求体
+             * @return 请求体已经读完，可以继续解析下一个请求
+             */
+            bool readBody();
+
+            /**
+             * @brief 把解码后的一段请求体交给回调，没有设置回调时累积起来，读完之后作为完整的请求交付
+             */
+            void deliverBody(StringView data, bool last);
+
+            /**
+             * @brief 以指定的状态回应当前请求并在之后关闭连接，用于请求体过大等无法继续处理的情况
+             */
+            void rejectRequest(HttpStatus status);
+
+            void dispatchRequest();
+
+            /**
+             * @brief 流式应答已经轮到写出并且写队列低于高水位
+             */
+            bool streamWritable(uint64_t sequence) const;
+
+            /**
+             * @brief 写出流式应答的一段数据，应答还没有轮到时暂存在槽位中
+             */
+            bool writeStream(uint64_t sequence, const char *head, int headLen, const void *data, size_t len);
+            bool writeStream(uint64_t sequence, const char *head, int headLen, std::string &&data);
+            bool writeStream(uint64_t sequence, const char *head, int headLen, const SharedBuffer &data);
+
+            /**
+             * @brief 结束流式应答，写出之后继续写出后面已经完成的应答
+             */
+            bool endStream(uint64_t sequence, const char *tail, int tailLen);
+
+            /**
+             * @brief 队列头部的流式应答可写时，在本轮事件处理完之后通知生产者
+             */
+            void notifyWritable();
+
             void handleClose() override;
 
             void onWriteComplete() override;
 
         private:
             mg::http::HttpRequest _request;
+            std::string _head;                     // 复用的应答头部缓冲区
+            std::vector<PendingResponse> _pending; // 应答槽位组成的环，序号为i的请求使用第i % size()个槽位
+            uint64_t _firstSequence;               // 最早的还没有写出应答的请求序号
+            uint64_t _nextSequence;                // 下一个请求的序号，与_firstSequence之间是等待应答的请求
+            size_t _maxPipelineRequests;           // 同时等待应答的请求数上限
+            bool _processing;                      // 正在解析请求，回调中发送应答时不重入
+            bool _stalled;                         // 因为等待应答的请求达到上限暂停了解析
+            bool _closing;                         // 已经收到要求关闭连接的请求
+            TimeStamp _lastReadTime;
+            size_t _streamThreshold;               // Content-Length超过该值时分段交付请求体
+            size_t _streamHighWaterMark;           // 写队列超过该长度时流式应答暂停生产
+            bool _readingBody;                     // 正在读取当前请求的请求体
+            size_t _bodyRemaining;                 // Content-Length请求体还没有读到的长度
+            phr_chunked_decoder _chunkedDecoder;   // 分块编码的增量解码状态
+            std::string _chunkedBody;              // 没有设置请求体回调时累积的分块请求体
             HttpMessageCallback _httpMessageCallback;
+            HttpBodyCallback _httpBodyCallback;
             HttpConnectionCallback _httpConnectionCallback;
             HttpCompleteCallback _httpWriteCompleteCallback;
         };
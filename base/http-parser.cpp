@@ -1,71 +1,229 @@
 #include "http-parser.h"
 #include <sstream>
 #include <iomanip>
+#include <climits>
+#include <stdio.h>
+#include <string.h>
 
-mg::http::HttpRequest &mg::http::HttpRequest::operator=(HttpRequest &&other)
+void mg::http::HttpRequest::reset()
 {
-    if (this != &other)
-    {
-        this->method = std::move(other.method);
-        this->path = std::move(other.path);
-        this->headers = std::move(other.headers);
-        this->body = std::move(other.body);
-        this->isComplete = other.isComplete;
-        this->lastCheckIndex = other.lastCheckIndex;
-    }
-    return *this;
+    this->method = StringView();
+    this->path = StringView();
+    this->headers.clear();
+    this->body = StringView();
+    this->storage.reset();
+    this->minorVersion = 1;
+    this->keepAlive = true;
+    this->sequence = 0;
+    this->contentLength = 0;
+    this->chunked = false;
+    this->bodyPending = false;
 }
 
-const std::string &mg::http::HttpRequest::getMethod() const
+mg::StringView mg::http::HttpRequest::getMethod() const
 {
     return this->method;
 }
 
-const std::string &mg::http::HttpRequest::getPath() const
+mg::StringView mg::http::HttpRequest::getPath() const
 {
     return this->path;
 }
 
-bool mg::http::HttpRequest::hasHeader(const std::string &key) const
+bool mg::http::HttpRequest::hasHeader(const StringView &key) const
 {
-    return this->headers.count(key);
+    for (auto &header : this->headers)
+    {
+        if (header.first.equalsIgnoreCase(key))
+            return true;
+    }
+    return false;
 }
 
-const std::string &mg::http::HttpRequest::getHeader(const std::string &key) const
+mg::StringView mg::http::HttpRequest::getHeader(const StringView &key) const
 {
-    static const std::string memo;
-    auto it = this->headers.find(key);
-    if (it == this->headers.end())
-        return memo;
-    return it->second;
+    // 请求的头部通常只有十几个，顺序查找比建立哈希表更快
+    for (auto &header : this->headers)
+    {
+        if (header.first.equalsIgnoreCase(key))
+            return header.second;
+    }
+    return StringView();
 }
 
-const std::string &mg::http::HttpRequest::getBody() const
+mg::StringView mg::http::HttpRequest::getBody() const
 {
     return this->body;
 }
 
+mg::http::HttpRequest mg::http::HttpRequest::detach() const
+{
+    size_t total = this->method.size() + this->path.size() + this->body.size();
+    for (auto &header : this->headers)
+        total += header.first.size() + header.second.size();
+
+    HttpRequest request;
+    request.storage.reset(new char[total ? total : 1]);
+    char *position = request.storage.get();
+    auto copy = [&position](const StringView &view)
+    {
+        StringView result(position, view.size());
+        ::memcpy(position, view.data(), view.size());
+        position += view.size();
+        return result;
+    };
+    request.method = copy(this->method);
+    request.path = copy(this->path);
+    request.headers.reserve(this->headers.size());
+    for (auto &header : this->headers)
+    {
+        StringView name = copy(header.first);
+        request.headers.emplace_back(name, copy(header.second));
+    }
+    request.body = copy(this->body);
+    request.minorVersion = this->minorVersion;
+    request.keepAlive = this->keepAlive;
+    request.sequence = this->sequence;
+    request.contentLength = this->contentLength;
+    request.chunked = this->chunked;
+    request.bodyPending = this->bodyPending;
+    request.isComplete = true;
+    return request;
+}
+
 void mg::http::HttpResponse::setStatus(HttpStatus status)
 {
     this->status = status;
 }
 
+void mg::http::HttpResponse::setHeader(const StringView &key, const StringView &value)
+{
+    if (this->hasHeader(key))
+        return;
+    this->fields.append(key.data(), key.size());
+    this->fields.append(": ", 2);
+    this->fields.append(value.data(), value.size());
+    this->fields.append("\r\n", 2);
+}
+
+bool mg::http::HttpResponse::hasHeader(const StringView &key) const
+{
+    StringView value;
+    return this->findHeader(key, value);
+}
+
+mg::StringView mg::http::HttpResponse::getHeader(const StringView &key) const
+{
+    StringView value;
+    this->findHeader(key, value);
+    return value;
+}
+
+bool mg::http::HttpResponse::findHeader(const StringView &key, StringView &value) const
+{
+    // 每一行都是"名称: 值\r\n"，应答的头部很少，直接逐行比较
+    size_t start = 0;
+    while (start < this->fields.size())
+    {
+        size_t colon = this->fields.find(':', start);
+        if (colon == std::string::npos)
+            break;
+        size_t end = this->fields.find("\r\n", colon);
+        if (end == std::string::npos)
+            break;
+        if (StringView(this->fields.data() + start, colon - start).equalsIgnoreCase(key))
+        {
+            value = StringView(this->fields.data() + colon + 2, end - colon - 2);
+            return true;
+        }
+        start = end + 2;
+    }
+    return false;
+}
+
+void mg::http::HttpResponse::setSharedBody(const SharedBuffer &body)
+{
+    this->sharedBody = body;
+    this->body.clear();
+    this->file.reset();
+}
+
+void mg::http::HttpResponse::setFileBody(const SharedFile &file, off_t offset, size_t len)
+{
+    this->file = file;
+    this->fileOffset = offset;
+    this->fileLength = len;
+    this->body.clear();
+    this->sharedBody.reset();
+}
+
+mg::StringView mg::http::HttpResponse::getBody() const
+{
+    if (this->sharedBody)
+        return StringView(*this->sharedBody);
+    return StringView(this->body);
+}
+
+size_t mg::http::HttpResponse::getBodyLength() const
+{
+    return this->file ? this->fileLength : this->getBody().size();
+}
+
+void mg::http::HttpResponse::appendHead(std::string &out, const char *connection) const
+{
+    size_t len = 0;
+    const char *line = statusLine(this->status, len);
+    out.append(line, len);
+    out.append(this->fields);
+    if (connection && !this->hasHeader("Connection"))
+    {
+        out.append("Connection: ", 12);
+        out.append(connection);
+        out.append("\r\n", 2);
+    }
+}
+
+void mg::http::HttpResponse::serializeStreamHead(std::string &out, const char *connection, bool chunked) const
+{
+    this->appendHead(out, connection);
+    if (chunked && !this->hasHeader("Transfer-Encoding"))
+        out.append("Transfer-Encoding: chunked\r\n", 28);
+    out.append("\r\n", 2);
+}
+
+void mg::http::HttpResponse::serializeHead(std::string &out, const char *connection) const
+{
+    this->appendHead(out, connection);
+    int code = static_cast<int>(this->status);
+    bool hasBody = code >= 200 && code != 204 && code != 304;
+    if (hasBody && !this->hasHeader("Content-Length"))
+    {
+        char buf[32];
+        int n = ::snprintf(buf, sizeof(buf), "Content-Length: %zu\r\n", this->getBodyLength());
+        out.append(buf, n);
+    }
+    out.append("\r\n", 2);
+}
+
 std::string mg::http::HttpResponse::dumpHead() const
 {
-    std::stringstream response;
-    response << "HTTP/1.1 " << static_cast<uint16_t>(status) << " " << statusToString(status) << "\r\n";
-    for (const auto &val : headers)
-        response << val.first << ": " << val.second << "\r\n";
-    return response.str();
+    size_t len = 0;
+    const char *line = statusLine(this->status, len);
+    std::string head;
+    head.reserve(len + this->fields.size());
+    head.append(line, len);
+    head.append(this->fields);
+    return head;
 }
 
 std::string mg::http::HttpResponse::dump() const
 {
-    std::stringstream response;
-    response << this->dumpHead() << "Content-Length: "
-             << std::to_string(body.size()) << "\r\n\r\n"
-             << body;
-    return response.str();
+    StringView content = this->getBody();
+    std::string response;
+    response.reserve(this->fields.size() + content.size() + 128);
+    this->serializeHead(response);
+    response.append(content.data(), content.size());
+    return response;
 }
 
 std::vector<std::string> mg::spilt(const std::string &str, const std::string &delimiter)
@@ -88,43 +246,51 @@ std::vector<std::string> mg::spilt(const std::string &str, const std::string &de
     return ret;
 }
 
-bool mg::http::urlDecode(const std::string &str, std::string &result)
+static inline int hexValue(char c)
 {
-    result.clear();
-    result.reserve(str.size());
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
 
-    for (size_t i = 0; i < str.size();)
+int mg::http::urlDecodeInPlace(char *data, size_t len)
+{
+    size_t write = 0;
+    for (size_t i = 0; i < len;)
     {
-        if (str[i] == '%')
+        if (data[i] == '%')
         {
-            if (i + 2 >= str.size())
-                return false;
-
-            char hex1 = str[i + 1];
-            char hex2 = str[i + 2];
-            if (!std::isxdigit(hex1) || !std::isxdigit(hex2))
-                return false;
-
-            int value = 0;
-            std::istringstream iss(str.substr(i + 1, 2));
-            if (!(iss >> std::hex >> value))
-                return false;
-
-            result += static_cast<unsigned char>(value);
+            if (i + 2 >= len)
+                return -1;
+            int high = hexValue(data[i + 1]);
+            int low = hexValue(data[i + 2]);
+            if (high < 0 || low < 0)
+                return -1;
+            data[write++] = static_cast<char>((high << 4) | low);
             i += 3;
         }
-        else if (str[i] == '+')
+        else if (data[i] == '+')
         {
-            result += ' ';
+            data[write++] = ' ';
             i++;
         }
         else
-        {
-            result += str[i];
-            i++;
-        }
+            data[write++] = data[i++];
     }
+    return static_cast<int>(write);
+}
 
+bool mg::http::urlDecode(const std::string &str, std::string &result)
+{
+    result = str;
+    int len = urlDecodeInPlace(&result[0], result.size());
+    if (len < 0)
+        return false;
+    result.resize(len);
     return true;
 }
 
@@ -141,74 +307,153 @@ std::string mg::urlEncode(const std::string &str)
     return os.str();
 }
 
-static std::string tolower(const std::string &str)
+/**
+ * @brief 逗号分隔的头部值中是否有指定的项，不区分大小写
+ */
+static bool hasToken(const mg::StringView &value, const char *token)
+{
+    mg::StringView expected(token);
+    size_t start = 0;
+    while (start < value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+            end = value.size();
+        size_t first = start, last = end;
+        while (first < last && (value[first] == ' ' || value[first] == '\t'))
+            first++;
+        while (last > first && (value[last - 1] == ' ' || value[last - 1] == '\t'))
+            last--;
+        if (value.substr(first, last - first).equalsIgnoreCase(expected))
+            return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief 去掉头部值两端的空白
+ */
+static mg::StringView trimValue(const mg::StringView &value)
 {
-    std::string res = str;
-    std::transform(res.begin(), res.end(), res.begin(), [](unsigned char c)
-                   { return std::tolower(c); });
-    return res;
+    size_t first = 0, last = value.size();
+    while (first < last && (value[first] == ' ' || value[first] == '\t'))
+        first++;
+    while (last > first && (value[last - 1] == ' ' || value[last - 1] == '\t'))
+        last--;
+    return value.substr(first, last - first);
 }
 
-int mg::http::parse(mg::Buffer &buf, mg::http::HttpRequest &request)
+int mg::http::parse(mg::Buffer &buf, mg::http::HttpRequest &request, size_t streamThreshold)
 {
     if (request.isComplete)
     {
         request.isComplete = false;
         request.lastCheckIndex = 0;
+        request.pendingLength = 0;
     }
 
+    char *data = reinterpret_cast<char *>(buf.readPeek());
+    size_t readable = buf.readableBytes();
+    // 上次已经解析过头部，请求体收全之前不需要重新解析
+    if (request.pendingLength > readable)
+        return -2;
+
     const char *method, *path;
     int minor_version;
     struct phr_header headers[256];
     size_t method_len, path_len, num_headers;
     num_headers = sizeof(headers) / sizeof(headers[0]);
-    int ret = ::phr_parse_request(reinterpret_cast<char *>(buf.readPeek()), buf.readableBytes(),
-                                  &method, &method_len, &path, &path_len, &minor_version, headers, &num_headers, request.lastCheckIndex);
+    int ret = ::phr_parse_request(data, readable, &method, &method_len, &path, &path_len,
+                                  &minor_version, headers, &num_headers, request.lastCheckIndex);
     if (ret < 0)
     {
         if (ret == -2)
-            request.lastCheckIndex = buf.readableBytes(); // for fast countermeasure
+            request.lastCheckIndex = readable; // for fast countermeasure
         return ret;
     }
 
-    // get path
-    std::string temp;
-    if (!urlDecode(std::string(path, path_len), temp))
-        return -1;
-    request.path = std::move(temp);
-
-    request.isComplete = true;
-
-    // get request method
-    request.method = std::string(method, method_len);
-
     // get body size
-    int body_size = 0;
-
-    // get all headers
-    for (int i = 0; i < num_headers; i++)
+    size_t body_size = 0;
+    bool has_length = false, chunked = false;
+    for (size_t i = 0; i < num_headers; i++)
     {
-        if (!urlDecode(std::string(headers[i].value, headers[i].value_len), temp))
-            return -1;
-        request.headers[tolower(std::string(headers[i].name, headers[i].name_len))] = std::move(temp);
-
-        if (body_size > 0)
+        StringView name(headers[i].name, headers[i].name_len);
+        if (name.equalsIgnoreCase("transfer-encoding"))
+        {
+            // 只支持单独的chunked：chunked不在最后时无法确定请求体的长度，
+            // 其他编码需要解码之后才能交给回调，都拒绝；重复的头部也拒绝
+            StringView value(headers[i].value, headers[i].value_len);
+            if (chunked || !trimValue(value).equalsIgnoreCase("chunked"))
+                return -1;
+            chunked = true;
             continue;
-
-        auto it = request.headers.find("content-length");
-        if (it != request.headers.end())
+        }
+        if (!name.equalsIgnoreCase("content-length"))
+            continue;
+        if (headers[i].value_len == 0 || has_length)
+            return -1;
+        has_length = true;
+        for (size_t j = 0; j < headers[i].value_len; j++)
         {
-            int count_size = std::count_if(it->second.begin(), it->second.end(), [](char c)
-                                           { return std::isdigit(c); });
-            if (count_size != it->second.size())
+            char c = headers[i].value[j];
+            if (!std::isdigit(static_cast<unsigned char>(c)))
                 return -1;
-
-            body_size = std::stoi(it->second);
+            // 乘法之前检查溢出，否则回绕后的长度会把请求体当作下一个请求解析
+            size_t digit = c - '0';
+            if (body_size > (static_cast<size_t>(SSIZE_MAX) - digit) / 10)
+                return -1;
+            body_size = body_size * 10 + digit;
         }
-        if (buf.readableBytes() < ret + body_size)
+    }
+    // 同时出现时无法确定请求的边界，拒绝请求避免请求走私
+    if (chunked && has_length)
+        return -1;
+
+    bool pending = chunked || body_size > streamThreshold;
+    if (!pending)
+    {
+        if (body_size > static_cast<size_t>(INT_MAX - ret))
+            return -1;
+        if (readable < ret + body_size)
+        {
+            // 头部已经完整，记录请求的总长度，下次数据收全之后从头解析
+            request.lastCheckIndex = 0;
+            request.pendingLength = ret + body_size;
             return -2;
+        }
     }
 
-    request.body = buf.retrieveAsString(ret + body_size).substr(ret);
-    return ret;
+    // 整个请求都在缓冲区中之后才修改数据，避免数据不完整时重复解码
+    request.reset();
+    char *path_data = data + (path - data);
+    if (::memchr(path_data, '%', path_len) || ::memchr(path_data, '+', path_len))
+    {
+        int len = urlDecodeInPlace(path_data, path_len);
+        if (len < 0)
+            return -1;
+        path_len = len;
+    }
+    request.path = StringView(path_data, path_len);
+    request.method = StringView(method, method_len);
+    request.headers.reserve(num_headers);
+    for (size_t i = 0; i < num_headers; i++)
+    {
+        request.headers.emplace_back(StringView(headers[i].name, headers[i].name_len),
+                                     StringView(headers[i].value, headers[i].value_len));
+    }
+    request.minorVersion = minor_version;
+    StringView connection = request.getHeader("Connection");
+    if (minor_version >= 1)
+        request.keepAlive = !hasToken(connection, "close");
+    else
+        request.keepAlive = hasToken(connection, "keep-alive");
+    request.contentLength = body_size;
+    request.chunked = chunked;
+    request.bodyPending = pending;
+    request.isComplete = true;
+    if (pending)
+        return ret;
+    request.body = StringView(data + ret, body_size);
+    return ret + static_cast<int>(body_size);
 }
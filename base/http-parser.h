@@ -6,72 +6,242 @@
 #include "picohttpparser.h"
 #include "http-type.h"
 #include "buffer.h"
+#include "string-view.h"
+#include "output-queue.h"
 
+#include <memory>
+#include <utility>
 #include <vector>
-#include <tuple>
 #include <algorithm>
-#include <unordered_map>
+#include <stdint.h>
 
 namespace mg
 {
     namespace http
     {
+        class HttpConnection;
+
+        /**
+         * @brief 解析得到的http请求，方法、路径、头部和请求体都是指向连接读缓冲区的视图，不复制数据
+         *        视图只在HttpMessageCallback执行期间有效，回调返回后缓冲区中的数据会被取走，
+         *        需要在回调之后继续使用请求时调用detach得到一个拥有数据的副本
+         */
         class HttpRequest
         {
-            friend int parse(mg::Buffer &buf, HttpRequest &request);
+            friend int parse(mg::Buffer &buf, HttpRequest &request, size_t streamThreshold);
+            friend class HttpConnection;
 
         public:
-            HttpRequest() : isComplete(false), lastCheckIndex(0) {}
+            using Header = std::pair<StringView, StringView>;
+
+            HttpRequest()
+                : minorVersion(1), keepAlive(true), sequence(0), contentLength(0), chunked(false), bodyPending(false),
+                  isComplete(false), lastCheckIndex(0), pendingLength(0) {}
+
+            HttpRequest(HttpRequest &&other) = default;
+
+            HttpRequest &operator=(HttpRequest &&other) = default;
+
+            HttpRequest(const HttpRequest &) = delete;
+
+            HttpRequest &operator=(const HttpRequest &) = delete;
+
+            StringView getMethod() const;
+
+            /**
+             * @brief 经过url解码的路径
+             */
+            StringView getPath() const;
+
+            /**
+             * @brief 头部名称不区分大小写
+             */
+            bool hasHeader(const StringView &key) const;
+
+            /**
+             * @brief 头部名称不区分大小写，不存在时返回空视图
+             */
+            StringView getHeader(const StringView &key) const;
+
+            /**
+             * @brief 按照请求中的顺序返回所有头部，名称保持原样
+             */
+            inline const std::vector<Header> &getHeaders() const { return this->headers; }
 
-            HttpRequest &operator=(HttpRequest &&other);
+            StringView getBody() const;
 
-            const std::string &getMethod() const;
+            /**
+             * @brief HTTP/1.x中的x
+             */
+            inline int getMinorVersion() const { return this->minorVersion; }
 
-            const std::string &getPath() const;
+            /**
+             * @brief 是否保持连接：HTTP/1.1默认保持，除非Connection中有close；HTTP/1.0只有Connection中有keep-alive时保持
+             */
+            inline bool isKeepAlive() const { return this->keepAlive; }
 
-            bool hasHeader(const std::string &key) const;
+            /**
+             * @brief 请求在连接中的序号，异步应答时用来指定回应哪一个请求
+             */
+            inline uint64_t getSequence() const { return this->sequence; }
 
-            const std::string &getHeader(const std::string &key) const;
+            /**
+             * @brief 请求体是否使用Transfer-Encoding: chunked
+             */
+            inline bool isChunked() const { return this->chunked; }
 
-            const std::string &getBody() const;
+            /**
+             * @brief Content-Length的值，分块编码时为0
+             */
+            inline size_t getContentLength() const { return this->contentLength; }
+
+            /**
+             * @brief 请求体没有随请求一起交付，getBody()为空，请求体由HttpBodyCallback分段交付
+             */
+            inline bool hasPendingBody() const { return this->bodyPending; }
+
+            /**
+             * @brief 复制出一个拥有数据的请求，所有视图指向副本自己的内存，可以在回调返回之后交给其他线程使用
+             */
+            HttpRequest detach() const;
+
+            /**
+             * @brief 是否是detach得到的请求
+             */
+            inline bool isDetached() const { return this->storage != nullptr; }
 
         private:
-            std::string method;
-            std::string path;
-            std::unordered_map<std::string, std::string> headers;
-            std::string body;
+            /**
+             * @brief 清空上一个请求的视图，保留headers的容量
+             */
+            void reset();
+
+            StringView method;
+            StringView path;
+            std::vector<Header> headers;
+            StringView body;
+            std::unique_ptr<char[]> storage; // detach之后视图指向的内存
+            int minorVersion;
+            bool keepAlive;
+            uint64_t sequence;
+            size_t contentLength;
+            bool chunked;
+            bool bodyPending;
             bool isComplete;
             size_t lastCheckIndex;
+            size_t pendingLength; // 头部已经完整但是请求体还没有收全时整个请求的长度，收全之前不再重复解析头部
         };
 
+        /**
+         * @brief http应答，头部在setHeader时直接格式化为"名称: 值\r\n"追加到一块连续内存中，
+         *        发送时状态行和头部写入连接复用的缓冲区，与数据体作为两个iovec一起writev，数据体不会被拷贝
+         */
         class HttpResponse
         {
+            friend class HttpConnection;
+
         public:
+            HttpResponse() : status(HttpStatus::OK), fileOffset(0), fileLength(0) {}
+
             void setStatus(HttpStatus status);
 
-            template <typename T, typename U>
-            void setHeader(T &&key, U &&value)
-            {
-                this->headers.insert(std::make_pair(std::forward<T>(key), std::forward<U>(value)));
-            }
+            /**
+             * @brief 设置头部，同名的头部已经存在时保持原来的值，名称不区分大小写
+             */
+            void setHeader(const StringView &key, const StringView &value);
+
+            bool hasHeader(const StringView &key) const;
+
+            /**
+             * @brief 名称不区分大小写，不存在时返回空视图
+             */
+            StringView getHeader(const StringView &key) const;
 
             template <typename T>
             void setBody(T &&body)
             {
                 this->body = std::forward<T>(body);
+                this->sharedBody.reset();
+                this->file.reset();
             }
 
+            /**
+             * @brief 使用共享的数据体，例如缓存的文件内容，发送时只增加引用计数
+             */
+            void setSharedBody(const SharedBuffer &body);
+
+            /**
+             * @brief 使用文件的一个区间作为数据体，发送时用sendfile从页缓存直接写出，不读入内存
+             */
+            void setFileBody(const SharedFile &file, off_t offset, size_t len);
+
+            /**
+             * @brief 内存中的数据体，文件数据体时为空
+             */
+            StringView getBody() const;
+
+            /**
+             * @brief 数据体的长度，包括文件数据体
+             */
+            size_t getBodyLength() const;
+
+            /**
+             * @brief 把状态行、头部、Content-Length和空行追加到out中，out可以在多次应答之间复用
+             *        1xx、204和304应答没有数据体，不追加Content-Length
+             * @param connection 应答没有设置Connection时追加的值，为空时不追加
+             */
+            void serializeHead(std::string &out, const char *connection = nullptr) const;
+
+            /**
+             * @brief 流式应答的头部，不带Content-Length，chunked为true时追加Transfer-Encoding: chunked
+             */
+            void serializeStreamHead(std::string &out, const char *connection, bool chunked) const;
+
+            /**
+             * @brief 状态行和已经设置的头部，不包括Content-Length和空行
+             */
             std::string dumpHead() const;
 
+            /**
+             * @brief 完整的应答，文件数据体不包括在内
+             */
             std::string dump() const;
 
         private:
+            /**
+             * @brief 查找头部的值
+             * @return 是否存在
+             */
+            bool findHeader(const StringView &key, StringView &value) const;
+
+            /**
+             * @brief 追加状态行、已经设置的头部和Connection
+             */
+            void appendHead(std::string &out, const char *connection) const;
+
             HttpStatus status;
-            std::unordered_map<std::string, std::string> headers;
-            std::string body;
+            std::string fields;      // 已经格式化的头部
+            std::string body;        // 自己持有的数据体
+            SharedBuffer sharedBody; // 共享的数据体，不为空时代替body
+            SharedFile file;         // 文件数据体，不为空时代替body和sharedBody
+            off_t fileOffset;
+            size_t fileLength;
         };
 
-        int parse(mg::Buffer &buf, HttpRequest &request);
+        /**
+         * @brief 从缓冲区中解析一个完整的请求，不取走数据，请求中的视图指向缓冲区
+         *        分块编码或者Content-Length大于streamThreshold时只解析头部，hasPendingBody()为true，
+         *        请求体留在缓冲区中由调用者继续读取
+         * @return 请求的总长度（只解析头部时为头部长度），处理完请求之后由调用者从缓冲区中取走；
+         *         -1表示请求非法，-2表示数据不完整
+         */
+        int parse(mg::Buffer &buf, HttpRequest &request, size_t streamThreshold = SIZE_MAX);
+
+        /**
+         * @brief 在原地进行url解码，解码后的长度不会超过原长度
+         * @return 解码后的长度，编码非法时返回-1
+         */
+        int urlDecodeInPlace(char *data, size_t len);
 
         bool urlDecode(const std::string &str, std::string &result);
     }
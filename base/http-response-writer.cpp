@@ -0,0 +1,101 @@
+#include "http-response-writer.h"
+#include "http-connection.h"
+
+#include <stdio.h>
+
+mg::http::HttpResponseWriter::HttpResponseWriter(const std::shared_ptr<HttpConnection> &connection, uint64_t sequence, bool chunked)
+    : _connection(connection), _sequence(sequence), _chunked(chunked), _started(false), _closed(false), _notifyPending(false)
+{
+    ;
+}
+
+int mg::http::HttpResponseWriter::chunkHead(char *buf, size_t len)
+{
+    if (!this->_chunked)
+        return 0;
+    int n = ::snprintf(buf, 32, "%s%zx\r\n", this->_started ? "\r\n" : "", len);
+    this->_started = true;
+    return n;
+}
+
+bool mg::http::HttpResponseWriter::write(const void *data, size_t len)
+{
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    if (this->_closed || !connection)
+        return false;
+    if (len == 0)
+        return true;
+    char head[32];
+    int headLen = this->chunkHead(head, len);
+    return connection->writeStream(this->_sequence, head, headLen, data, len);
+}
+
+bool mg::http::HttpResponseWriter::write(const StringView &data)
+{
+    return this->write(data.data(), data.size());
+}
+
+bool mg::http::HttpResponseWriter::write(std::string &&data)
+{
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    if (this->_closed || !connection)
+        return false;
+    if (data.empty())
+        return true;
+    char head[32];
+    int headLen = this->chunkHead(head, data.size());
+    return connection->writeStream(this->_sequence, head, headLen, std::move(data));
+}
+
+bool mg::http::HttpResponseWriter::write(const SharedBuffer &data)
+{
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    if (this->_closed || !connection)
+        return false;
+    if (!data || data->empty())
+        return true;
+    char head[32];
+    int headLen = this->chunkHead(head, data->size());
+    return connection->writeStream(this->_sequence, head, headLen, data);
+}
+
+bool mg::http::HttpResponseWriter::end()
+{
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    if (this->_closed || !connection)
+        return false;
+    const char *tail = "";
+    int tailLen = 0;
+    if (this->_chunked)
+    {
+        tail = this->_started ? "\r\n0\r\n\r\n" : "0\r\n\r\n";
+        tailLen = this->_started ? 7 : 5;
+    }
+    return connection->endStream(this->_sequence, tail, tailLen);
+}
+
+bool mg::http::HttpResponseWriter::writable() const
+{
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    return !this->_closed && connection && connection->streamWritable(this->_sequence);
+}
+
+bool mg::http::HttpResponseWriter::closed() const
+{
+    return this->_closed || this->_connection.expired();
+}
+
+void mg::http::HttpResponseWriter::setWritableCallback(Handler callback)
+{
+    this->_writableCallback = std::move(callback);
+    // 已经可写时也通知一次，生产者只需要在回调中写数据
+    std::shared_ptr<HttpConnection> connection = this->_connection.lock();
+    if (connection && !this->_closed)
+        connection->notifyWritable();
+}
+
+void mg::http::HttpResponseWriter::close()
+{
+    this->_closed = true;
+    this->_writableCallback = nullptr;
+}
@@ -0,0 +1,97 @@
+#ifndef __MG_HTTP_RESPONSE_WRITER_H__
+#define __MG_HTTP_RESPONSE_WRITER_H__
+
+#include "noncopyable.h"
+#include "function-callbacks.h"
+#include "string-view.h"
+#include "output-queue.h"
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+namespace mg
+{
+    namespace http
+    {
+        class HttpConnection;
+
+        /**
+         * @brief 流式应答，头部写出之后数据体按分块编码逐段写出，不需要事先构造完整的数据体
+         *        HTTP/1.0的请求不支持分块编码，数据体原样写出，结束之后关闭连接
+         *        连接的写队列超过流式应答的高水位（HttpServer::setStreamHighWaterMark设置，默认1MB）时writable()返回false，生产者应当暂停，
+         *        写队列发送完之后调用setWritableCallback设置的回调继续生产
+         *        只能在连接所属的loop线程中使用
+         */
+        class HttpResponseWriter : noncopyable
+        {
+            friend class HttpConnection;
+
+        public:
+            HttpResponseWriter(const std::shared_ptr<HttpConnection> &connection, uint64_t sequence, bool chunked);
+
+            /**
+             * @brief 写出一段数据体，长度为0时忽略
+             * @return 连接已经断开或者应答已经结束时返回false
+             */
+            bool write(const void *data, size_t len);
+
+            bool write(const StringView &data);
+
+            /**
+             * @brief 数据没有写完时直接移入写队列
+             */
+            bool write(std::string &&data);
+
+            /**
+             * @brief 数据没有写完时只引用共享数据块
+             */
+            bool write(const SharedBuffer &data);
+
+            /**
+             * @brief 结束应答，分块编码时写出最后的空块
+             */
+            bool end();
+
+            /**
+             * @brief 应答已经轮到写出并且写队列低于高水位
+             */
+            bool writable() const;
+
+            /**
+             * @brief 连接已经断开或者应答已经结束
+             */
+            bool closed() const;
+
+            /**
+             * @brief 设置时已经可写、应答轮到写出或者写队列发送完时，在本轮事件处理完之后调用，
+             *        应答结束或者连接断开之后不再调用
+             */
+            void setWritableCallback(Handler callback);
+
+        private:
+            /**
+             * @brief 分块的头部，前一块数据的结尾\r\n放在这里，使每一块只需要两个iovec
+             * @return 头部长度
+             */
+            int chunkHead(char *buf, size_t len);
+
+            /**
+             * @brief 连接断开或者应答结束，释放回调，回调中通常持有writer自己
+             */
+            void close();
+
+            std::weak_ptr<HttpConnection> _connection;
+            uint64_t _sequence;     // 回应的请求序号
+            bool _chunked;          // 是否使用分块编码
+            bool _started;          // 已经写出过数据块
+            bool _closed;           // 应答已经结束或者连接已经断开
+            bool _notifyPending;    // 已经安排了一次可写通知
+            Handler _writableCallback;
+        };
+
+        using HttpResponseWriterPointer = std::shared_ptr<HttpResponseWriter>;
+    }
+}
+
+#endif // __MG_HTTP_RESPONSE_WRITER_H__
@@ -3,7 +3,8 @@
 
 mg::HttpServer::HttpServer(EventLoop *loop, const InternetAddress &listenAddress,
                            const std::string &name, int domain, int type)
-    : TcpServer(loop, listenAddress, name, domain, type)
+    : TcpServer(loop, listenAddress, name, domain, type), _maxPipelineRequests(16), _streamThreshold(64 * 1024),
+      _streamHighWaterMark(1024 * 1024)
 {
     ;
 }
@@ -28,16 +29,45 @@ void mg::HttpServer::setWriteCompleteCallback(const HttpCompleteCallback &callba
     this->_httpWriteCompleteCallback = std::move(callback);
 }
 
-void mg::HttpServer::handleNewConnection(EventLoop *loop, const std::string &name, int fd,
-                                         const mg::InternetAddress &local,
+void mg::HttpServer::setMaxPipelineRequests(size_t count)
+{
+    this->_maxPipelineRequests = count;
+}
+
+void mg::HttpServer::setBodyCallback(const HttpBodyCallback &callback)
+{
+    this->_httpBodyCallback = callback;
+}
+
+void mg::HttpServer::setStreamThreshold(size_t threshold)
+{
+    this->_streamThreshold = threshold;
+}
+
+void mg::HttpServer::setStreamHighWaterMark(size_t bytes)
+{
+    this->_streamHighWaterMark = bytes;
+}
+
+void mg::HttpServer::handleNewConnection(EventLoop *loop, uint64_t id, const std::string &name, int fd,
                                          const mg::InternetAddress &peer)
 {
-    HttpConnectionPointer connection = std::make_shared<http::HttpConnection>(loop, name, fd, local, peer);
+    HttpConnectionPointer connection = std::make_shared<http::HttpConnection>(loop, name, fd, InternetAddress(), peer);
+    connection->setId(id);
     connection->setConnectionCallback(this->_httpConnectionCallback);
     connection->setMessageCallback(this->_httpMessageCallback);
     connection->setWriteCompleteCallback(this->_httpWriteCompleteCallback);
+    connection->setMaxPipelineRequests(this->_maxPipelineRequests);
+    connection->setBodyCallback(this->_httpBodyCallback);
+    connection->setStreamThreshold(this->_streamThreshold);
+    connection->setStreamHighWaterMark(this->_streamHighWaterMark);
     connection->setCloseCallback(std::bind(&HttpServer::removeConnection, this, std::placeholders::_1));
-    this->_connectionMemo[name] = connection;
+    connection->setIdleTimeoutList(this->getIdleTimeoutList(loop));
+    connection->setEdgeTriggered(this->_edgeTriggered);
+    connection->reserveLoopLoad();
+    // 流水线中的应答逐个写出，开启Nagle时后面的应答要等待对端延迟发送的ACK
+    connection->setTcpNoDelay(true);
+    this->addConnection(connection);
 
     loop->run(std::bind(&http::HttpConnection::connectionEstablished, connection.get()));
 }
\ No newline at end of file
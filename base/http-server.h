@@ -20,8 +20,24 @@ namespace mg
 
         void setWriteCompleteCallback(const HttpCompleteCallback &callback);
 
-        void handleNewConnection(EventLoop *loop, const std::string &name, int fd,
-                                 const mg::InternetAddress &local,
+        /**
+         * @brief 每个连接同时等待应答的请求数上限
+         */
+        void setMaxPipelineRequests(size_t count);
+
+        /**
+         * @brief 分段交付请求体，见HttpConnection::setBodyCallback
+         */
+        void setBodyCallback(const HttpBodyCallback &callback);
+
+        void setStreamThreshold(size_t threshold);
+
+        /**
+         * @brief 流式应答暂停生产的写队列长度，见HttpConnection::setStreamHighWaterMark
+         */
+        void setStreamHighWaterMark(size_t bytes);
+
+        void handleNewConnection(EventLoop *loop, uint64_t id, const std::string &name, int fd,
                                  const mg::InternetAddress &peer) override;
 
     private:
@@ -31,6 +47,10 @@ namespace mg
         HttpMessageCallback _httpMessageCallback;
         HttpConnectionCallback _httpConnectionCallback;
         HttpCompleteCallback _httpWriteCompleteCallback;
+        HttpBodyCallback _httpBodyCallback;
+        size_t _maxPipelineRequests;
+        size_t _streamThreshold;
+        size_t _streamHighWaterMark;
     };
 }
 
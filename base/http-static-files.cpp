@@ -0,0 +1,402 @@
+#include "http-static-files.h"
+#include "http-connection.h"
+#include "time-stamp.h"
+#include "log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+mg::http::HttpStaticFiles::HttpStaticFiles(const std::string &root, const std::string &prefix)
+    : _root(root), _prefix(prefix), _indexFile("index.html"), _maxCachedFileSize(64 * 1024),
+      _cacheSize(32 * 1024 * 1024), _maxCachedFiles(1024), _revalidateInterval(1000 * 1000), _cachedBytes(0)
+{
+    while (this->_root.size() > 1 && this->_root.back() == '/')
+        this->_root.pop_back();
+    if (this->_prefix.empty() || this->_prefix.back() != '/')
+        this->_prefix.push_back('/');
+}
+
+void mg::http::HttpStaticFiles::setMaxCachedFileSize(size_t size)
+{
+    this->_maxCachedFileSize = size;
+}
+
+void mg::http::HttpStaticFiles::setCacheSize(size_t size)
+{
+    this->_cacheSize = size;
+}
+
+void mg::http::HttpStaticFiles::setMaxCachedFiles(size_t count)
+{
+    this->_maxCachedFiles = count;
+}
+
+void mg::http::HttpStaticFiles::setRevalidateInterval(double seconds)
+{
+    this->_revalidateInterval = static_cast<int64_t>(seconds * 1000 * 1000);
+}
+
+void mg::http::HttpStaticFiles::setIndexFile(const std::string &name)
+{
+    this->_indexFile = name;
+}
+
+size_t mg::http::HttpStaticFiles::cachedFiles()
+{
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    return this->_cache.size();
+}
+
+bool mg::http::HttpStaticFiles::handle(const HttpConnectionPointer &link, HttpRequest *request)
+{
+    StringView method = request->getMethod();
+    bool head = method == "HEAD";
+    if (!head && method != "GET")
+        return false;
+
+    StringView path = request->getPath();
+    path = path.substr(0, path.find('?'));
+    if (path.size() < this->_prefix.size() || path.substr(0, this->_prefix.size()) != this->_prefix)
+        return false;
+    StringView relative = path.substr(this->_prefix.size());
+
+    HttpResponse response;
+    // 路径已经url解码，拒绝跳出根目录的".."和截断路径的'\0'
+    bool valid = relative.find('\0') == std::string::npos;
+    for (size_t start = 0; valid && start <= relative.size();)
+    {
+        size_t end = relative.find('/', start);
+        if (end == std::string::npos)
+            end = relative.size();
+        valid = relative.substr(start, end - start) != "..";
+        start = end + 1;
+    }
+    FileEntryPointer entry;
+    std::string filename;
+    if (valid)
+    {
+        filename.reserve(this->_root.size() + relative.size() + this->_indexFile.size() + 1);
+        filename.append(this->_root).append(1, '/').append(relative.data(), relative.size());
+        if (relative.empty() || relative[relative.size() - 1] == '/')
+            filename.append(this->_indexFile);
+        entry = this->lookup(filename);
+    }
+    if (!entry)
+    {
+        response.setStatus(HttpStatus::NOT_FOUND);
+        link->send(request->getSequence(), std::move(response));
+        return true;
+    }
+
+    response.setHeader("ETag", entry->etag);
+    response.setHeader("Last-Modified", entry->lastModified);
+    if (notModified(request, *entry))
+    {
+        response.setStatus(HttpStatus::NOT_MODIFIED);
+        link->send(request->getSequence(), std::move(response));
+        return true;
+    }
+
+    size_t begin = 0;
+    size_t len = entry->size;
+    int range = parseRange(request, *entry, begin, len);
+    if (range < 0)
+    {
+        response.setStatus(HttpStatus::RANGE_NOT_SATISFIABLE);
+        response.setHeader("Content-Range", "bytes */" + std::to_string(entry->size));
+        link->send(request->getSequence(), std::move(response));
+        return true;
+    }
+
+    response.setHeader("Content-Type", entry->contentType);
+    response.setHeader("Accept-Ranges", "bytes");
+    if (range > 0)
+    {
+        char buf[96];
+        int n = ::snprintf(buf, sizeof(buf), "bytes %zu-%zu/%zu", begin, begin + len - 1, entry->size);
+        response.setStatus(HttpStatus::PARTIAL_CONTENT);
+        response.setHeader("Content-Range", StringView(buf, n));
+    }
+    if (head)
+        response.setHeader("Content-Length", std::to_string(len));
+    else if (entry->content && range == 0)
+        response.setSharedBody(entry->content);
+    else if (entry->content)
+        response.setBody(entry->content->substr(begin, len));
+    else
+        response.setFileBody(entry->file, begin, len);
+    link->send(request->getSequence(), std::move(response));
+    return true;
+}
+
+mg::http::HttpStaticFiles::FileEntryPointer mg::http::HttpStaticFiles::lookup(const std::string &path)
+{
+    int64_t now = TimeStamp::now().getMircoSecond();
+    FileEntryPointer cached;
+    {
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        auto it = this->_cache.find(path);
+        if (it != this->_cache.end())
+        {
+            CacheNode &node = it->second;
+            this->_recent.splice(this->_recent.begin(), this->_recent, node.recent);
+            if (now - node.checked < this->_revalidateInterval)
+                return node.entry;
+            cached = node.entry;
+        }
+    }
+
+    if (cached)
+    {
+        // 文件没有变化时只更新检查时间，stat在锁外进行
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_dev == cached->device &&
+            st.st_ino == cached->inode && static_cast<size_t>(st.st_size) == cached->size &&
+            st.st_mtim.tv_sec == cached->modified.tv_sec && st.st_mtim.tv_nsec == cached->modified.tv_nsec)
+        {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            auto it = this->_cache.find(path);
+            if (it != this->_cache.end() && it->second.entry == cached)
+                it->second.checked = now;
+            return cached;
+        }
+    }
+
+    FileEntryPointer entry = this->load(path);
+    if (entry)
+        this->store(path, entry, now);
+    else if (cached)
+        this->erase(path);
+    return entry;
+}
+
+mg::http::HttpStaticFiles::FileEntryPointer mg::http::HttpStaticFiles::load(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    SharedFile file = std::make_shared<FileHandle>(fd);
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return nullptr;
+
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->size = st.st_size;
+    entry->device = st.st_dev;
+    entry->inode = st.st_ino;
+    entry->modified = st.st_mtim;
+    entry->contentType = contentType(path);
+
+    char buf[64];
+    int n = ::snprintf(buf, sizeof(buf), "\"%lx-%zx\"", static_cast<unsigned long>(st.st_mtim.tv_sec), entry->size);
+    entry->etag.assign(buf, n);
+    struct tm tm;
+    ::gmtime_r(&st.st_mtim.tv_sec, &tm);
+    entry->lastModified.assign(buf, ::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm));
+
+    if (entry->size > this->_maxCachedFileSize)
+    {
+        entry->file = std::move(file);
+        return entry;
+    }
+
+    // 小文件读入内存之后关闭描述符
+    std::shared_ptr<std::string> content = std::make_shared<std::string>(entry->size, '\0');
+    size_t offset = 0;
+    while (offset < entry->size)
+    {
+        ssize_t len = ::pread(fd, &(*content)[offset], entry->size - offset, offset);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0)
+        {
+            LOG_ERROR("read {} error: {}", path, ::strerror(errno));
+            return nullptr;
+        }
+        if (len == 0)
+            break;
+        offset += len;
+    }
+    // 读取期间文件被截断时只缓存读到的部分，下次检查时会发现文件变化
+    content->resize(offset);
+    entry->size = offset;
+    entry->content = std::move(content);
+    return entry;
+}
+
+void mg::http::HttpStaticFiles::store(const std::string &path, const FileEntryPointer &entry, int64_t now)
+{
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    auto it = this->_cache.find(path);
+    if (it == this->_cache.end())
+    {
+        this->_recent.push_front(path);
+        it = this->_cache.emplace(path, CacheNode{nullptr, 0, this->_recent.begin()}).first;
+    }
+    else
+    {
+        if (it->second.entry->content)
+            this->_cachedBytes -= it->second.entry->content->size();
+        this->_recent.splice(this->_recent.begin(), this->_recent, it->second.recent);
+    }
+    it->second.entry = entry;
+    it->second.checked = now;
+    if (entry->content)
+        this->_cachedBytes += entry->content->size();
+
+    // 淘汰最久没有使用的文件，正在发送的文件由应答持有引用，发送完才释放
+    while (this->_recent.size() > 1 && (this->_cache.size() > this->_maxCachedFiles || this->_cachedBytes > this->_cacheSize))
+    {
+        auto last = this->_cache.find(this->_recent.back());
+        if (last->second.entry->content)
+            this->_cachedBytes -= last->second.entry->content->size();
+        this->_cache.erase(last);
+        this->_recent.pop_back();
+    }
+}
+
+void mg::http::HttpStaticFiles::erase(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    auto it = this->_cache.find(path);
+    if (it == this->_cache.end())
+        return;
+    if (it->second.entry->content)
+        this->_cachedBytes -= it->second.entry->content->size();
+    this->_recent.erase(it->second.recent);
+    this->_cache.erase(it);
+}
+
+bool mg::http::HttpStaticFiles::notModified(const HttpRequest *request, const FileEntry &entry)
+{
+    // If-None-Match优先于If-Modified-Since，使用弱比较
+    StringView match = request->getHeader("If-None-Match");
+    if (!match.empty())
+    {
+        size_t start = 0;
+        while (start < match.size())
+        {
+            size_t end = match.find(',', start);
+            if (end == std::string::npos)
+                end = match.size();
+            StringView tag = match.substr(start, end - start);
+            while (!tag.empty() && tag[0] == ' ')
+                tag = tag.substr(1);
+            while (!tag.empty() && tag[tag.size() - 1] == ' ')
+                tag = tag.substr(0, tag.size() - 1);
+            if (tag.substr(0, 2) == "W/")
+                tag = tag.substr(2);
+            if (tag == "*" || tag == entry.etag)
+                return true;
+            start = end + 1;
+        }
+        return false;
+    }
+
+    StringView since = request->getHeader("If-Modified-Since");
+    if (since.empty())
+        return false;
+    if (since == entry.lastModified)
+        return true;
+    struct tm tm = {};
+    std::string value = since.toString();
+    if (!::strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm))
+        return false;
+    return entry.modified.tv_sec <= ::timegm(&tm);
+}
+
+int mg::http::HttpStaticFiles::parseRange(const HttpRequest *request, const FileEntry &entry, size_t &begin, size_t &len)
+{
+    StringView range = request->getHeader("Range");
+    if (range.size() < 7 || range.substr(0, 6) != "bytes=" || range.find(',') != std::string::npos)
+        return 0;
+    // If-Range与当前文件不一致时说明客户端缓存的部分已经过期，回应整个文件
+    StringView ifRange = request->getHeader("If-Range");
+    if (!ifRange.empty() && ifRange != entry.etag && ifRange != entry.lastModified)
+        return 0;
+
+    StringView spec = range.substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos)
+        return 0;
+    StringView first = spec.substr(0, dash);
+    StringView last = spec.substr(dash + 1);
+    for (size_t i = 0; i < first.size(); i++)
+        if (first[i] < '0' || first[i] > '9')
+            return 0;
+    for (size_t i = 0; i < last.size(); i++)
+        if (last[i] < '0' || last[i] > '9')
+            return 0;
+    if (first.empty() && last.empty())
+        return 0;
+
+    if (first.empty())
+    {
+        // 最后n个字节
+        size_t suffix = ::strtoull(last.toString().c_str(), nullptr, 10);
+        if (suffix == 0 || entry.size == 0)
+            return -1;
+        len = std::min(suffix, entry.size);
+        begin = entry.size - len;
+        return 1;
+    }
+
+    size_t start = ::strtoull(first.toString().c_str(), nullptr, 10);
+    size_t end = last.empty() ? SIZE_MAX : ::strtoull(last.toString().c_str(), nullptr, 10);
+    if (end < start)
+        return 0;
+    if (start >= entry.size)
+        return -1;
+    begin = start;
+    len = std::min(end, entry.size - 1) - start + 1;
+    return 1;
+}
+
+const char *mg::http::HttpStaticFiles::contentType(const std::string &path)
+{
+    static const struct
+    {
+        const char *extension;
+        const char *type;
+    } types[] = {
+        {"html", "text/html; charset=utf-8"},
+        {"htm", "text/html; charset=utf-8"},
+        {"css", "text/css; charset=utf-8"},
+        {"js", "application/javascript; charset=utf-8"},
+        {"json", "application/json"},
+        {"txt", "text/plain; charset=utf-8"},
+        {"csv", "text/csv; charset=utf-8"},
+        {"xml", "application/xml"},
+        {"svg", "image/svg+xml"},
+        {"png", "image/png"},
+        {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"},
+        {"webp", "image/webp"},
+        {"ico", "image/x-icon"},
+        {"pdf", "application/pdf"},
+        {"wasm", "application/wasm"},
+        {"woff", "font/woff"},
+        {"woff2", "font/woff2"},
+        {"mp4", "video/mp4"},
+        {"mp3", "audio/mpeg"},
+        {"zip", "application/zip"},
+        {"gz", "application/gzip"},
+    };
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return "application/octet-stream";
+    const char *extension = path.c_str() + dot + 1;
+    for (auto &x : types)
+    {
+        if (::strcasecmp(extension, x.extension) == 0)
+            return x.type;
+    }
+    return "application/octet-stream";
+}
@@ -0,0 +1,150 @@
+#ifndef __MG_HTTP_STATIC_FILES_H__
+#define __MG_HTTP_STATIC_FILES_H__
+
+#include "noncopyable.h"
+#include "function-callbacks.h"
+#include "string-view.h"
+#include "output-queue.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+
+namespace mg
+{
+    namespace http
+    {
+        class HttpRequest;
+
+        /**
+         * @brief 静态文件服务，在HttpMessageCallback中调用handle回应GET和HEAD请求
+         *        不超过setMaxCachedFileSize的小文件读入内存缓存，应答直接引用缓存的内容；
+         *        更大的文件只缓存打开的描述符，应答用sendfile从页缓存直接写入套接口
+         *        支持ETag、Last-Modified的条件请求（304）和单个区间的Range请求（206、416）
+         *        缓存按照最近使用淘汰，距离上次检查超过setRevalidateInterval时重新stat，文件变化后重新加载
+         *        handle可以在多个loop线程中同时调用
+         */
+        class HttpStaticFiles : noncopyable
+        {
+        public:
+            /**
+             * @param root 文件所在的目录
+             * @param prefix 请求路径的前缀，去掉前缀之后的部分是root下的相对路径
+             */
+            explicit HttpStaticFiles(const std::string &root, const std::string &prefix = "/");
+
+            /**
+             * @brief 不超过该长度的文件缓存内容，默认64KB
+             */
+            void setMaxCachedFileSize(size_t size);
+
+            /**
+             * @brief 缓存内容的总长度上限，默认32MB
+             */
+            void setCacheSize(size_t size);
+
+            /**
+             * @brief 缓存的文件数上限，包括只缓存描述符的大文件，默认1024
+             */
+            void setMaxCachedFiles(size_t count);
+
+            /**
+             * @brief 缓存的文件超过该时间之后再次使用时检查是否变化，默认1秒，为0时每次都检查
+             */
+            void setRevalidateInterval(double seconds);
+
+            /**
+             * @brief 路径以'/'结尾时使用的文件，默认index.html
+             */
+            void setIndexFile(const std::string &name);
+
+            /**
+             * @brief 回应请求的文件
+             * @return 不是GET或HEAD请求，或者路径不在前缀之下时返回false，由调用者继续处理
+             */
+            bool handle(const HttpConnectionPointer &link, HttpRequest *request);
+
+            /**
+             * @brief 缓存的文件数
+             */
+            size_t cachedFiles();
+
+        private:
+            /**
+             * @brief 打开的文件和应答需要的元数据，创建之后不再修改
+             */
+            struct FileEntry
+            {
+                SharedBuffer content;     // 小文件的内容
+                SharedFile file;          // 大文件的描述符
+                size_t size;
+                dev_t device;
+                ino_t inode;
+                struct timespec modified; // 判断文件是否变化
+                std::string etag;
+                std::string lastModified;
+                const char *contentType;
+            };
+
+            using FileEntryPointer = std::shared_ptr<const FileEntry>;
+
+            struct CacheNode
+            {
+                FileEntryPointer entry;
+                int64_t checked;                         // 上次确认文件没有变化的时间，微秒
+                std::list<std::string>::iterator recent; // 在_recent中的位置
+            };
+
+            /**
+             * @brief 查找缓存，需要时检查文件是否变化并重新加载
+             * @return 文件不存在或者不是普通文件时返回nullptr
+             */
+            FileEntryPointer lookup(const std::string &path);
+
+            /**
+             * @brief 打开文件，小文件读入内存
+             */
+            FileEntryPointer load(const std::string &path);
+
+            /**
+             * @brief 放入缓存并淘汰最久没有使用的文件
+             */
+            void store(const std::string &path, const FileEntryPointer &entry, int64_t now);
+
+            void erase(const std::string &path);
+
+            /**
+             * @brief 请求是否带有与文件匹配的If-None-Match或者If-Modified-Since
+             */
+            static bool notModified(const HttpRequest *request, const FileEntry &entry);
+
+            /**
+             * @brief 解析单个区间的Range头部
+             * @return 1表示得到区间[begin, begin + len)，0表示忽略Range回应整个文件，-1表示区间无法满足
+             */
+            static int parseRange(const HttpRequest *request, const FileEntry &entry, size_t &begin, size_t &len);
+
+            static const char *contentType(const std::string &path);
+
+        private:
+            std::string _root;
+            std::string _prefix;
+            std::string _indexFile;
+            size_t _maxCachedFileSize;
+            size_t _cacheSize;
+            size_t _maxCachedFiles;
+            int64_t _revalidateInterval; // 微秒
+            std::mutex _mutex;           // 保护下面的缓存
+            std::unordered_map<std::string, CacheNode> _cache;
+            std::list<std::string> _recent; // 最近使用的在前面
+            size_t _cachedBytes;
+        };
+    }
+}
+
+#endif //__MG_HTTP_STATIC_FILES_H__
@@ -40,4 +40,20 @@ const char *mg::http::statusToString(HttpStatus status)
     default:
         return "Unknown Status";
     }
-}
\ No newline at end of file
+}
+
+const char *mg::http::statusLine(HttpStatus status, size_t &len)
+{
+    switch(status)
+    {
+    #define FUNC(code, name, desc)                               \
+        case mg::http::HttpStatus::name:                         \
+            len = sizeof("HTTP/1.1 " #code " " #desc "\r\n") - 1; \
+            return "HTTP/1.1 " #code " " #desc "\r\n";
+        HTTP_STATUS_DEFINE(FUNC)
+    #undef FUNC
+    default:
+        len = sizeof("HTTP/1.1 500 Internal Server Error\r\n") - 1;
+        return "HTTP/1.1 500 Internal Server Error\r\n";
+    }
+}
@@ -2,6 +2,7 @@
 #define __MG_HTTP_TYPE_H__
 
 #include <string>
+#include <stddef.h>
 
 namespace mg
 {
@@ -140,6 +141,13 @@ namespace mg
          * @return The string representation of the HTTP status
          */
         const char * statusToString(HttpStatus status);
+
+        /**
+         * @brief Returns the preformatted status line of an HttpStatus, e.g. "HTTP/1.1 200 OK\r\n"
+         * @param status The HttpStatus enumeration value
+         * @param len Set to the length of the status line
+         */
+        const char *statusLine(HttpStatus status, size_t &len);
     }
 }
 
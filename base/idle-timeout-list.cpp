@@ -0,0 +1,93 @@
+#include "idle-timeout-list.h"
+#include "tcp-connection.h"
+#include "event-loop.h"
+#include "log.h"
+
+mg::IdleTimeoutList::IdleTimeoutList(EventLoop *loop, int timeout)
+    : _loop(loop), _timeout(timeout), _current(TimeStamp::now().getSeconds()),
+      _head(nullptr), _tail(nullptr), _size(0)
+{
+    ;
+}
+
+mg::IdleTimeoutList::~IdleTimeoutList()
+{
+    this->_loop->cancel(this->_timerId);
+}
+
+void mg::IdleTimeoutList::start()
+{
+    std::weak_ptr<IdleTimeoutList> weak(shared_from_this());
+    this->_timerId = this->_loop->runEvery(1.0, [weak]()
+                                           {
+                                               std::shared_ptr<IdleTimeoutList> list = weak.lock();
+                                               if (list)
+                                                   list->onTick(); //
+                                           });
+}
+
+void mg::IdleTimeoutList::add(TcpConnection *connection)
+{
+    if (connection->_idleLinked)
+        return;
+    connection->_idleSecond = this->_current;
+    this->link(connection);
+}
+
+void mg::IdleTimeoutList::remove(TcpConnection *connection)
+{
+    if (connection->_idleLinked)
+        this->unlink(connection);
+}
+
+void mg::IdleTimeoutList::touch(TcpConnection *connection)
+{
+    // 同一秒内的读写不需要移动，避免每次读写都修改链表
+    if (!connection->_idleLinked || connection->_idleSecond == this->_current)
+        return;
+    connection->_idleSecond = this->_current;
+    if (connection == this->_tail)
+        return;
+    this->unlink(connection);
+    this->link(connection);
+}
+
+void mg::IdleTimeoutList::onTick()
+{
+    this->_current = TimeStamp::now().getSeconds();
+    while (this->_head && this->_head->_idleSecond + this->_timeout <= this->_current)
+    {
+        TcpConnection *connection = this->_head;
+        this->unlink(connection);
+        LOG_INFO("{} idle timeout", connection->name());
+        connection->forceClose();
+    }
+}
+
+void mg::IdleTimeoutList::link(TcpConnection *connection)
+{
+    connection->_idlePrev = this->_tail;
+    connection->_idleNext = nullptr;
+    if (this->_tail)
+        this->_tail->_idleNext = connection;
+    else
+        this->_head = connection;
+    this->_tail = connection;
+    connection->_idleLinked = true;
+    this->_size++;
+}
+
+void mg::IdleTimeoutList::unlink(TcpConnection *connection)
+{
+    if (connection->_idlePrev)
+        connection->_idlePrev->_idleNext = connection->_idleNext;
+    else
+        this->_head = connection->_idleNext;
+    if (connection->_idleNext)
+        connection->_idleNext->_idlePrev = connection->_idlePrev;
+    else
+        this->_tail = connection->_idlePrev;
+    connection->_idlePrev = connection->_idleNext = nullptr;
+    connection->_idleLinked = false;
+    this->_size--;
+}
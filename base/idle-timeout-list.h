@@ -0,0 +1,74 @@
+#ifndef __MG_IDLE_TIMEOUT_LIST_H__
+#define __MG_IDLE_TIMEOUT_LIST_H__
+
+#include "noncopyable.h"
+#include "timer-id.h"
+
+#include <memory>
+#include <cstdint>
+
+namespace mg
+{
+    class EventLoop;
+    class TcpConnection;
+
+    /**
+     * @brief 每个eventloop一个的空闲连接链表，连接按照最近活跃的秒数从旧到新排列
+     *        连接有读写时移动到链表尾部，同一秒内重复活跃不移动；整个链表只使用一个每秒触发的定时器，
+     *        从链表头部关闭空闲超过timeout秒的连接，连接本身不需要定时器
+     *        所有函数都只能在所属eventloop线程中调用
+     */
+    class IdleTimeoutList : noncopyable, public std::enable_shared_from_this<IdleTimeoutList>
+    {
+    public:
+        /**
+         * @param loop 所属的eventloop
+         * @param timeout 空闲超时秒数
+         */
+        IdleTimeoutList(EventLoop *loop, int timeout);
+
+        ~IdleTimeoutList();
+
+        /**
+         * @brief 启动每秒检查一次的定时器
+         */
+        void start();
+
+        /**
+         * @brief 连接建立时加入链表
+         */
+        void add(TcpConnection *connection);
+
+        /**
+         * @brief 连接关闭时移出链表
+         */
+        void remove(TcpConnection *connection);
+
+        /**
+         * @brief 连接有读写时刷新活跃时间
+         */
+        void touch(TcpConnection *connection);
+
+        inline size_t size() const { return this->_size; }
+
+    private:
+        /**
+         * @brief 每秒执行一次，关闭超时的连接
+         */
+        void onTick();
+
+        void link(TcpConnection *connection);
+
+        void unlink(TcpConnection *connection);
+
+        EventLoop *_loop;     // 所属的eventloop
+        int _timeout;         // 空闲超时秒数
+        int64_t _current;     // 当前的秒数
+        TcpConnection *_head; // 最久没有活跃的连接
+        TcpConnection *_tail; // 最近活跃的连接
+        size_t _size;         // 链表中的连接数
+        TimerId _timerId;     // 每秒检查一次的定时器
+    };
+};
+
+#endif //__MG_IDLE_TIMEOUT_LIST_H__
@@ -82,3 +82,27 @@ uint16_t mg::InternetAddress::port() const
 {
     return ::ntohs(_ipv6 ? _address._address6.sin6_port : _address._address4.sin_port);
 }
+
+size_t mg::InternetAddress::ipHash() const
+{
+    // FNV-1a
+    const unsigned char *data = nullptr;
+    size_t len = 0;
+    if (_ipv6)
+    {
+        data = reinterpret_cast<const unsigned char *>(&_address._address6.sin6_addr);
+        len = sizeof(_address._address6.sin6_addr);
+    }
+    else
+    {
+        data = reinterpret_cast<const unsigned char *>(&_address._address4.sin_addr);
+        len = sizeof(_address._address4.sin_addr);
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
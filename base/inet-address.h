@@ -27,6 +27,11 @@ namespace mg
 
         uint16_t port() const;
 
+        /**
+         * @brief 只对IP计算的哈希值，同一个客户端的不同连接得到相同的结果
+         */
+        size_t ipHash() const;
+
         sockaddr_in &getSockAddress_4() { return _address._address4; };
 
         sockaddr_in6 &getSockAddress_6() { return _address._address6; };
@@ -0,0 +1,132 @@
+#ifndef __MG_MPMC_QUEUE_H__
+#define __MG_MPMC_QUEUE_H__
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mg
+{
+    /**
+     * @brief 无锁的多生产者多消费者有界队列
+     *        每个槽位带一个序号，生产者和消费者各自通过CAS推进位置后独占槽位，序号表示槽位当前可写还是可读
+     *        容量向上取整到2的幂
+     */
+    template <typename T>
+    class MpmcQueue : noncopyable
+    {
+    public:
+        explicit MpmcQueue(size_t capacity) : _cells(nullptr), _mask(0), _enqueue(0), _dequeue(0)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            this->_cells = new Cell[size];
+            this->_mask = size - 1;
+            for (size_t i = 0; i < size; i++)
+                this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~MpmcQueue()
+        {
+            delete[] this->_cells;
+        }
+
+        /**
+         * @brief 任意线程向队列尾部插入数据
+         * @return 队列已满时返回false，value保持不变
+         */
+        bool push(T &&value)
+        {
+            Cell *cell = nullptr;
+            size_t position = this->_enqueue.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &this->_cells[position & this->_mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (diff == 0)
+                {
+                    if (this->_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    position = this->_enqueue.load(std::memory_order_relaxed);
+            }
+            cell->value = std::move(value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief 任意线程从队列头部取出数据
+         * @return 队列为空或者生产者还未写完槽位时返回false
+         */
+        bool pop(T &value)
+        {
+            Cell *cell = nullptr;
+            size_t position = this->_dequeue.load(std::memory_order_relaxed);
+            while (true)
+            {
+                cell = &this->_cells[position & this->_mask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (diff == 0)
+                {
+                    if (this->_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    position = this->_dequeue.load(std::memory_order_relaxed);
+            }
+            value = std::move(cell->value);
+            cell->value = T(); // 及时释放数据持有的资源
+            cell->sequence.store(position + this->_mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief 队列是否为空，其他线程同时读写时只是一个近似值
+         */
+        bool empty() const
+        {
+            return this->_enqueue.load(std::memory_order_relaxed) == this->_dequeue.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 队列中的元素个数，其他线程同时读写时只是一个近似值
+         */
+        size_t size() const
+        {
+            size_t enqueue = this->_enqueue.load(std::memory_order_relaxed);
+            size_t dequeue = this->_dequeue.load(std::memory_order_relaxed);
+            return enqueue > dequeue ? enqueue - dequeue : 0;
+        }
+
+        inline size_t capacity() const { return this->_mask + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence; // 等于位置时可写，等于位置加1时可读
+            T value;
+        };
+
+        Cell *_cells;                                    // 环形数组
+        size_t _mask;                                    // 容量减1
+        char _padding0[64 - sizeof(Cell *) - sizeof(size_t)];
+        std::atomic<size_t> _enqueue;                    // 生产者插入的位置
+        char _padding1[64 - sizeof(std::atomic<size_t>)]; // 避免生产者和消费者修改同一缓存行
+        std::atomic<size_t> _dequeue;                    // 消费者取出的位置
+        char _padding2[64 - sizeof(std::atomic<size_t>)];
+    };
+};
+
+#endif //__MG_MPMC_QUEUE_H__
@@ -0,0 +1,178 @@
+#ifndef __MG_MPSC_QUEUE_H__
+#define __MG_MPSC_QUEUE_H__
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+namespace mg
+{
+    /**
+     * @brief 无锁的多生产者单消费者无界队列
+     *        生产者通过一次原子交换挂入节点，消费者只在自己的线程中取出节点，全程不加锁
+     *        consume取完的节点归还到_spare，生产者一次取走整条链表放入线程局部缓存中复用，
+     *        稳定运行时push不再申请内存
+     */
+    template <typename T>
+    class MpscQueue : noncopyable
+    {
+    public:
+        MpscQueue() : _head(new Node()), _tail(_head.load(std::memory_order_relaxed)), _spare(nullptr)
+        {
+            ;
+        }
+
+        ~MpscQueue()
+        {
+            T value;
+            while (this->pop(value))
+                ;
+            delete this->_tail;
+            freeList(this->_spare.load(std::memory_order_acquire));
+        }
+
+        /**
+         * @brief 任意线程向队列尾部插入数据
+         * @param value 待插入的数据
+         */
+        void push(T &&value)
+        {
+            Node *node = this->acquire(std::move(value));
+            Node *prev = this->_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        /**
+         * @brief 消费者线程从队列头部取出数据
+         * @param value 保存取出的数据
+         * @return 队列为空或者生产者还未挂好节点时返回false
+         */
+        bool pop(T &value)
+        {
+            Node *node = this->popNode(value);
+            delete node;
+            return node != nullptr;
+        }
+
+        /**
+         * @brief 消费者线程取出调用时已经在队列中的数据，调用期间新插入的数据留给下一次处理
+         * @param callback 处理每个数据的回调
+         * @return 处理的数据个数
+         */
+        template <typename Function>
+        size_t consume(Function &&callback)
+        {
+            size_t count = 0;
+            Node *last = this->_head.load(std::memory_order_acquire);
+            Node *first = nullptr, *tail = nullptr, *node = nullptr;
+            T value;
+            while (this->_tail != last && (node = this->popNode(value)))
+            {
+                callback(value);
+                value = T(); // 及时释放数据持有的资源
+                count++;
+                node->next.store(first, std::memory_order_relaxed);
+                first = node;
+                if (!tail)
+                    tail = node;
+            }
+            if (first)
+                this->recycle(first, tail);
+            return count;
+        }
+
+        /**
+         * @brief 队列是否为空，只能在消费者线程调用
+         */
+        bool empty() const
+        {
+            return this->_tail->next.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        struct Node
+        {
+            Node() : next(nullptr) {}
+            explicit Node(T &&data) : next(nullptr), value(std::move(data)) {}
+
+            std::atomic<Node *> next;
+            T value;
+        };
+
+        // 线程局部的空闲节点链表，所有同类型队列共用
+        struct NodeCache
+        {
+            Node *list = nullptr;
+            ~NodeCache() { freeList(list); }
+        };
+
+        static NodeCache &localCache()
+        {
+            static thread_local NodeCache cache;
+            return cache;
+        }
+
+        static void freeList(Node *node)
+        {
+            while (node)
+            {
+                Node *next = node->next.load(std::memory_order_relaxed);
+                delete node;
+                node = next;
+            }
+        }
+
+        /**
+         * @brief 优先从线程局部缓存中获取节点，缓存为空时取走_spare上的全部节点
+         */
+        Node *acquire(T &&value)
+        {
+            NodeCache &cache = localCache();
+            if (!cache.list)
+                cache.list = this->_spare.exchange(nullptr, std::memory_order_acquire);
+            if (!cache.list)
+                return new Node(std::move(value));
+            Node *node = cache.list;
+            cache.list = node->next.load(std::memory_order_relaxed);
+            node->next.store(nullptr, std::memory_order_relaxed);
+            node->value = std::move(value);
+            return node;
+        }
+
+        /**
+         * @brief 取出下一个数据
+         * @return 取出后不再使用的旧节点，没有数据时返回nullptr
+         */
+        Node *popNode(T &value)
+        {
+            Node *next = this->_tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return nullptr;
+            value = std::move(next->value);
+            Node *node = this->_tail;
+            this->_tail = next;
+            return node;
+        }
+
+        /**
+         * @brief 把first到tail的节点链表挂到_spare上，生产者只会整条取走，不存在ABA问题
+         */
+        void recycle(Node *first, Node *tail)
+        {
+            Node *head = this->_spare.load(std::memory_order_relaxed);
+            do
+            {
+                tail->next.store(head, std::memory_order_relaxed);
+            } while (!this->_spare.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        std::atomic<Node *> _head;                       // 生产者插入的位置
+        char _padding[64 - sizeof(std::atomic<Node *>)]; // 避免生产者和消费者修改同一缓存行
+        Node *_tail;                                     // 消费者取出的位置，指向已经取出的节点
+        std::atomic<Node *> _spare;                      // 消费者归还的空闲节点
+    };
+};
+
+#endif //__MG_MPSC_QUEUE_H__
@@ -13,7 +13,7 @@ using json = nlohmann::json;
 mg::MysqlConnectionPool::MysqlConnectionPool() : _host(), _username(), _password(),
                                                  _databasename(), _port(0), _maxsize(0),
                                                  _minsize(0), _totalsize(0), _timeout(0),
-                                                 _idletimeout(0), _loop(nullptr)
+                                                 _idletimeout(0), _waittimeout(500), _loop(nullptr)
 {
     ;
 }
@@ -24,12 +24,10 @@ mg::MysqlConnectionPool::~MysqlConnectionPool()
 #ifdef _DEBUG
     LOG_DEBUG("~MysqlConnectionPool() called");
 #endif
-    while (!_queue.empty())
-    {
-        auto front = _queue.front();
-        _queue.pop();
-        SAFE_DELETE(front);
-    }
+    if (!_connections)
+        return;
+    while (Mysql *connection = _connections->pop())
+        SAFE_DELETE(connection);
 }
 
 bool mg::MysqlConnectionPool::initial(const std::string &configPath, const std::string &name)
@@ -49,6 +47,8 @@ bool mg::MysqlConnectionPool::initial(nlohmann::json &js, const std::string &nam
     _minsize = js.value("minsize", 1);
     _timeout = js.value("timeout", 0);
     _idletimeout = js.value("idletimeout", 0);
+    _waittimeout = js.value("waittimeout", 500);
+    _connections.reset(new ConnectionCache<Mysql>(std::max(_maxsize, _minsize)));
     _thread.reset(new mg::EventLoopThread(name));
     _loop = _thread->startLoop();
     return true;
@@ -58,11 +58,8 @@ bool mg::MysqlConnectionPool::start(int keeplive)
 {
     if (!_thread || _loop == nullptr)
         assert(0);
-    {
-        std::lock_guard<std::mutex> guard(_mutex);
-        if (!addInitial())
-            return false;
-    }
+    if (!addInitial())
+        return false;
     _loop->runEvery(_timeout, std::bind(&MysqlConnectionPool::remove, this));
     _loop->runEvery(_timeout, std::bind(&MysqlConnectionPool::add, this));
     if (keeplive)
@@ -76,40 +73,54 @@ void mg::MysqlConnectionPool::quit()
         _loop->quit();
 }
 
-std::shared_ptr<mg::Mysql> mg::MysqlConnectionPool::getHandle()
+mg::MysqlHandle mg::MysqlConnectionPool::getHandle()
 {
-    // 不能在定时器线程中执行此函数会导致死锁
+    // 在定时器线程中等待会阻塞连接的补充
     assert(!_loop->isInOwnerThread());
 
-    std::unique_lock<std::mutex> lock(_mutex);
-    if (_queue.empty() && _condition.wait_for(lock, std::chrono::milliseconds(500)) == std::cv_status::timeout)
+    Mysql *connection = _connections->acquire(std::chrono::milliseconds(_waittimeout));
+    if (!connection)
         return nullptr;
+    return MysqlHandle(this, connection);
+}
+
+void mg::MysqlConnectionPool::release(Mysql *connection)
+{
+    connection->freeResult();
+    connection->refresh();
+    if (!_connections->release(connection))
+    {
+        SAFE_DELETE(connection);
+        this->_totalsize--;
+    }
+}
 
-    std::shared_ptr<Mysql> res(_queue.front(), [this](mg::Mysql *connection)
-                               {
-                                   std::lock_guard<std::mutex> guard(this->_mutex);
-                                   connection->freeResult();
-                                   connection->refresh();
-                                   this->_queue.push(connection);
-                                   this->_condition.notify_one(); // 通知等待的线程有新连接可用
-                               });
-
-    _queue.pop();
-    return res;
+void mg::MysqlConnectionPool::putBack(Mysql *connection)
+{
+    if (!_connections->push(connection))
+    {
+        SAFE_DELETE(connection);
+        this->_totalsize--;
+    }
 }
 
 void mg::MysqlConnectionPool::remove()
 {
     LOG_TRACE("mysql remove called");
-    std::lock_guard<std::mutex> guard(_mutex);
-    while (_queue.size() > _minsize)
+    // 逐个取出空闲连接检查，检查期间其他线程照常取出和归还
+    size_t count = _connections->idle();
+    for (size_t i = 0; i < count && _totalsize > _minsize; i++)
     {
-        auto front = _queue.front();
-        if (front->getVacantTime().getSeconds() < _idletimeout)
+        Mysql *connection = _connections->pop();
+        if (!connection)
             break;
-        _queue.pop();
-        LOG_TRACE("mysql remove {}", (void *)front);
-        SAFE_DELETE(front);
+        if (connection->getVacantTime().getSeconds() < _idletimeout)
+        {
+            putBack(connection);
+            continue;
+        }
+        LOG_TRACE("mysql remove {}", (void *)connection);
+        SAFE_DELETE(connection);
         this->_totalsize--;
     }
 }
@@ -117,44 +128,46 @@ void mg::MysqlConnectionPool::remove()
 void mg::MysqlConnectionPool::add()
 {
     LOG_TRACE("mysql add called");
-    std::lock_guard<std::mutex> guard(_mutex);
-    if (!_queue.empty() || this->_totalsize > this->_maxsize)
+    if (_connections->idle() > 0 && _totalsize >= _minsize)
         return;
     addInitial();
-    _condition.notify_one();
 }
 
 bool mg::MysqlConnectionPool::addInitial()
 {
-    int len = std::min(_minsize, static_cast<uint16_t>(_minsize - _queue.size()));
+    // 不足最小连接数时补足，没有空闲连接时在最大连接数以内新建一批，新建连接时不持有任何锁
+    int len = _minsize - _totalsize.load();
+    if (len <= 0 && _connections->idle() == 0 && _totalsize < _maxsize)
+        len = std::min<int>(std::max<int>(_minsize, 1), _maxsize - _totalsize.load());
     for (int i = 0; i < len; i++)
     {
         mg::Mysql *sql = new mg::Mysql();
         if (!sql->connect(_username, _password, _databasename, _host, _port))
         {
             LOG_ERROR("mysql {} connect error", i + 1);
+            SAFE_DELETE(sql);
             return false;
         }
         sql->refresh();
         LOG_TRACE("mysql add {}", (void *)sql);
-        _queue.push(sql);
         this->_totalsize++;
+        putBack(sql);
     }
     return true;
 }
 
 void mg::MysqlConnectionPool::keepAlive()
 {
+    // 查询时不持有锁，正在检查的连接只是暂时不可用
     std::string sql = "select now()";
-    std::lock_guard<std::mutex> guard(_mutex);
-    std::queue<Mysql *> temp;
-    while (!_queue.empty())
+    size_t count = _connections->idle();
+    for (size_t i = 0; i < count; i++)
     {
-        auto front = _queue.front();
-        _queue.pop();
-        temp.push(front);
-        front->query(sql);
-        LOG_TRACE("mysql keepalive {}", (void *)front);
+        Mysql *connection = _connections->pop();
+        if (!connection)
+            break;
+        connection->query(sql);
+        LOG_TRACE("mysql keepalive {}", (void *)connection);
+        putBack(connection);
     }
-    temp.swap(_queue);
 }
@@ -6,10 +6,9 @@
 #include "thread.h"
 #include "timer-queue.h"
 #include "mysql.h"
+#include "connection-cache.h"
 
-#include <mutex>
-#include <condition_variable>
-#include <queue>
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -18,8 +17,17 @@ namespace mg
     class Mysql;
     class EventLoop;
     class EventLoopThread;
+    class MysqlConnectionPool;
+
+    /**
+     * @brief 从连接池取出的数据库连接，析构时自动归还
+     */
+    using MysqlHandle = PoolHandle<MysqlConnectionPool, Mysql>;
+
     class MysqlConnectionPool : public Singleton<MysqlConnectionPool>
     {
+        friend class PoolHandle<MysqlConnectionPool, Mysql>;
+
     public:
         MysqlConnectionPool();
 
@@ -45,9 +53,11 @@ namespace mg
         void quit();
 
         /**
-         * @brief 获取一个数据库实例
+         * @brief 获取一个数据库实例，没有空闲连接时最多等待waittimeout毫秒（默认500）
+         *        句柄析构时连接优先归还到当前线程的缓存槽位
+         * @return 超时返回空句柄
          */
-        std::shared_ptr<Mysql> getHandle();
+        MysqlHandle getHandle();
 
     private:
         /**
@@ -71,6 +81,16 @@ namespace mg
          */
         void keepAlive();
 
+        /**
+         * @brief 句柄析构时归还连接
+         */
+        void release(Mysql *connection);
+
+        /**
+         * @brief 放回共享队列，容器已满时释放连接
+         */
+        void putBack(Mysql *connection);
+
         std::string _host;
         std::string _username;
         std::string _password;
@@ -78,12 +98,11 @@ namespace mg
         uint16_t _port;
         uint16_t _maxsize;
         uint16_t _minsize;
-        uint16_t _totalsize;
+        std::atomic<uint16_t> _totalsize;
         uint16_t _timeout;
         uint32_t _idletimeout;
-        std::queue<Mysql *> _queue;
-        std::mutex _mutex;
-        std::condition_variable _condition;
+        uint32_t _waittimeout;
+        std::unique_ptr<ConnectionCache<Mysql>> _connections; // 空闲连接
         EventLoop *_loop;
         std::unique_ptr<mg::EventLoopThread> _thread;
     };
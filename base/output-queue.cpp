@@ -0,0 +1,210 @@
+#include "output-queue.h"
+
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+const size_t mg::OutputQueue::_maxIovecs;
+const size_t mg::OutputQueue::_maxCoalesceSize;
+
+mg::FileHandle::~FileHandle()
+{
+    if (this->_fd >= 0)
+        ::close(this->_fd);
+}
+
+mg::OutputQueue::OutputQueue() : _head(0), _bytes(0)
+{
+    ;
+}
+
+void mg::OutputQueue::append(const void *data, size_t len)
+{
+    if (!len)
+        return;
+
+    // 尾部数据块还有预留空间时直接追加，预留空间保证了追加不会触发重新分配
+    if (this->_head < this->_chunks.size())
+    {
+        Chunk &tail = this->_chunks.back();
+        if (tail.scratch && tail.scratch->size() + len <= tail.scratch->capacity())
+        {
+            tail.scratch->append(static_cast<const char *>(data), len);
+            tail.len += len;
+            this->_bytes += len;
+            return;
+        }
+    }
+
+    std::shared_ptr<std::string> block = std::make_shared<std::string>();
+    block->reserve(std::max(len, _maxCoalesceSize));
+    block->append(static_cast<const char *>(data), len);
+
+    Chunk chunk;
+    chunk.data = block->data();
+    chunk.len = len;
+    chunk.scratch = len < _maxCoalesceSize ? block.get() : nullptr;
+    chunk.fd = -1;
+    chunk.offset = 0;
+    chunk.holder = std::move(block);
+    this->push(std::move(chunk));
+    this->_bytes += len;
+}
+
+void mg::OutputQueue::append(std::string &&data, size_t offset)
+{
+    if (offset >= data.size())
+        return;
+    // 小数据直接合并进尾部数据块，减少writev的数据块数量
+    if (data.size() - offset < _maxCoalesceSize / 4)
+    {
+        this->append(data.data() + offset, data.size() - offset);
+        return;
+    }
+    this->append(std::make_shared<const std::string>(std::move(data)), offset);
+}
+
+void mg::OutputQueue::append(const SharedBuffer &data, size_t offset)
+{
+    if (!data || offset >= data->size())
+        return;
+    Chunk chunk;
+    chunk.data = data->data() + offset;
+    chunk.len = data->size() - offset;
+    chunk.scratch = nullptr;
+    chunk.fd = -1;
+    chunk.offset = 0;
+    chunk.holder = data;
+    this->_bytes += chunk.len;
+    this->push(std::move(chunk));
+}
+
+void mg::OutputQueue::append(const std::shared_ptr<Buffer> &data, size_t offset)
+{
+    if (!data || offset >= static_cast<size_t>(data->readableBytes()))
+        return;
+    Chunk chunk;
+    chunk.data = reinterpret_cast<const char *>(data->readPeek()) + offset;
+    chunk.len = data->readableBytes() - offset;
+    chunk.scratch = nullptr;
+    chunk.fd = -1;
+    chunk.offset = 0;
+    chunk.holder = data;
+    this->_bytes += chunk.len;
+    this->push(std::move(chunk));
+}
+
+void mg::OutputQueue::append(Buffer &&data, size_t offset)
+{
+    size_t size = data.readableBytes();
+    if (offset >= size)
+        return;
+    if (size - offset < _maxCoalesceSize / 4)
+    {
+        this->append(data.readPeek() + offset, size - offset);
+        return;
+    }
+    this->append(std::make_shared<Buffer>(std::move(data)), offset);
+}
+
+void mg::OutputQueue::append(const SharedFile &file, off_t offset, size_t len)
+{
+    if (!file || !len)
+        return;
+    Chunk chunk;
+    chunk.data = nullptr;
+    chunk.len = len;
+    chunk.scratch = nullptr;
+    chunk.fd = file->fd();
+    chunk.offset = offset;
+    chunk.holder = file;
+    this->_bytes += len;
+    this->push(std::move(chunk));
+}
+
+ssize_t mg::OutputQueue::send(int fd, int &saveError)
+{
+    if (this->_head < this->_chunks.size() && this->_chunks[this->_head].fd >= 0)
+    {
+        Chunk &front = this->_chunks[this->_head];
+        off_t offset = front.offset;
+        ssize_t len = ::sendfile(fd, front.fd, &offset, front.len);
+        if (len < 0)
+            saveError = errno;
+        else if (len == 0)
+        {
+            // 文件在发送过程中被截断，已经承诺的长度无法再发送完
+            saveError = EIO;
+            len = -1;
+        }
+        return len;
+    }
+
+    // 只收集文件区间之前的内存数据块，文件区间等到下一次发送
+    struct iovec vec[_maxIovecs];
+    size_t count = 0;
+    for (auto it = this->_chunks.begin() + this->_head; it != this->_chunks.end() && count < _maxIovecs && it->fd < 0; ++it, ++count)
+    {
+        vec[count].iov_base = const_cast<char *>(it->data);
+        vec[count].iov_len = it->len;
+    }
+
+    ssize_t len = ::writev(fd, vec, count);
+    if (len < 0)
+        saveError = errno;
+    return len;
+}
+
+void mg::OutputQueue::retrieve(size_t len)
+{
+    assert(len <= this->_bytes);
+    this->_bytes -= len;
+    while (len && this->_head < this->_chunks.size())
+    {
+        Chunk &front = this->_chunks[this->_head];
+        if (len < front.len)
+        {
+            if (front.fd >= 0)
+                front.offset += len;
+            else
+                front.data += len;
+            front.len -= len;
+            return;
+        }
+        len -= front.len;
+        front = Chunk();
+        this->_head++;
+    }
+    if (this->_head == this->_chunks.size())
+        this->reset();
+}
+
+void mg::OutputQueue::retrieveAll()
+{
+    this->reset();
+    this->_bytes = 0;
+}
+
+void mg::OutputQueue::push(Chunk &&chunk)
+{
+    // 没有空余位置时先把已经发送完的数据块移走，避免一直不清空的队列无限增长
+    if (this->_head && this->_chunks.size() == this->_chunks.capacity())
+    {
+        this->_chunks.erase(this->_chunks.begin(), this->_chunks.begin() + this->_head);
+        this->_head = 0;
+    }
+    this->_chunks.push_back(std::move(chunk));
+}
+
+void mg::OutputQueue::reset()
+{
+    if (this->_chunks.capacity() > _maxIovecs)
+        std::vector<Chunk>().swap(this->_chunks);
+    else
+        this->_chunks.clear();
+    this->_head = 0;
+}
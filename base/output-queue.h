@@ -0,0 +1,152 @@
+#ifndef __MG_OUTPUT_QUEUE_H__
+#define __MG_OUTPUT_QUEUE_H__
+
+#include "buffer.h"
+#include "noncopyable.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <stddef.h>
+#include <sys/types.h>
+
+namespace mg
+{
+    /**
+     * @brief 多个连接之间共享的只读数据块，入队时只增加引用计数不拷贝数据
+     */
+    using SharedBuffer = std::shared_ptr<const std::string>;
+
+    /**
+     * @brief 只读打开的文件，最后一个引用释放时关闭，多个连接可以同时发送同一个文件的不同区间
+     */
+    class FileHandle : noncopyable
+    {
+    public:
+        explicit FileHandle(int fd) : _fd(fd) {}
+
+        ~FileHandle();
+
+        inline int fd() const { return this->_fd; }
+
+    private:
+        int _fd;
+    };
+
+    using SharedFile = std::shared_ptr<const FileHandle>;
+
+    /**
+     * @brief 由引用计数数据块组成的发送队列，发送时使用writev一次写出多个数据块
+     *        队列中也可以是文件的一个区间，轮到时用sendfile从页缓存直接写入套接口，不经过用户态内存
+     */
+    class OutputQueue
+    {
+    public:
+        OutputQueue();
+
+        /**
+         * @brief 拷贝数据到队列尾部，尾部是自己持有的小数据块时合并进去避免产生碎片
+         * @param data 数据起始地址
+         * @param len 数据长度
+         */
+        void append(const void *data, size_t len);
+
+        /**
+         * @brief 接管string的内存，不拷贝数据
+         * @param data 待发送的数据
+         * @param offset 从data的offset处开始发送
+         */
+        void append(std::string &&data, size_t offset = 0);
+
+        /**
+         * @brief 引用共享数据块，不拷贝数据
+         * @param data 待发送的数据
+         * @param offset 从data的offset处开始发送
+         */
+        void append(const SharedBuffer &data, size_t offset = 0);
+
+        /**
+         * @brief 引用Buffer中的可读数据，不拷贝数据，入队后不能再修改该Buffer
+         * @param data 待发送的数据
+         * @param offset 从可读数据的offset处开始发送
+         */
+        void append(const std::shared_ptr<Buffer> &data, size_t offset = 0);
+
+        /**
+         * @brief 接管Buffer的内存，不拷贝数据
+         * @param data 待发送的数据
+         * @param offset 从可读数据的offset处开始发送
+         */
+        void append(Buffer &&data, size_t offset = 0);
+
+        /**
+         * @brief 引用文件的一个区间，发送时才从文件读取，区间长度计入待发送的字节数
+         * @param file 打开的文件
+         * @param offset 区间在文件中的起始位置
+         * @param len 区间长度
+         */
+        void append(const SharedFile &file, off_t offset, size_t len);
+
+        /**
+         * @brief 使用writev发送队列头部的数据块，头部是文件区间时使用sendfile发送
+         * @param fd 要发送的socket文件描述符
+         * @param saveError 保存发生错误时的状态
+         * @return 发送的字节数，出错时返回-1
+         */
+        ssize_t send(int fd, int &saveError);
+
+        /**
+         * @brief 从队列头部移除已经发送的数据
+         * @param len 移除的字节数
+         */
+        void retrieve(size_t len);
+
+        /**
+         * @brief 清空队列
+         */
+        void retrieveAll();
+
+        /**
+         * @brief 获取队列中待发送的字节数
+         */
+        inline size_t readableBytes() const { return this->_bytes; }
+
+        /**
+         * @brief 获取队列中数据块的数量
+         */
+        inline size_t chunks() const { return this->_chunks.size() - this->_head; }
+
+        inline bool empty() const { return this->_bytes == 0; }
+
+        static const size_t _maxIovecs = 64;         // 单次writev最多携带的数据块
+        static const size_t _maxCoalesceSize = 4096; // 小于该长度的拷贝数据合并到同一个数据块中
+
+    private:
+        struct Chunk
+        {
+            std::shared_ptr<const void> holder; // 数据块所有者，保证发送完之前数据有效
+            const char *data;                   // 待发送数据的起始地址
+            size_t len;                         // 待发送数据的长度
+            std::string *scratch;               // 由append(const void *, size_t)创建的可追加数据块
+            int fd;                             // 文件区间的描述符，内存数据块为-1
+            off_t offset;                       // 文件区间下一个待发送字节的位置
+        };
+
+        /**
+         * @brief 在队列尾部加入数据块
+         */
+        void push(Chunk &&chunk);
+
+        /**
+         * @brief 队列发送完之后清空，数据块很多时同时释放内存，空闲连接不占用内存
+         */
+        void reset();
+
+        // std::deque即使为空也会申请内存，这里用vector加上头部下标，空队列不占用内存
+        std::vector<Chunk> _chunks; // 待发送的数据块，[_head, size)是有效的
+        size_t _head;               // 队列头部数据块的下标
+        size_t _bytes;              // 待发送的字节数
+    };
+};
+
+#endif //__MG_OUTPUT_QUEUE_H__
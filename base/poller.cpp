@@ -1,9 +1,31 @@
 #include "poller.h"
 #include "channel.h"
 
-mg::Poller::Poller(EventLoop *loop) : _loop(loop) {}
+#include <algorithm>
+
+mg::Poller::Poller(EventLoop *loop) : _channelNums(0), _loop(loop) {}
 
 bool mg::Poller::hasChannel(Channel *channel) const
 {
-    return this->_channels.count(channel->fd());
+    int fd = channel->fd();
+    return fd >= 0 && static_cast<size_t>(fd) < this->_channels.size() && this->_channels[fd] == channel;
+}
+
+void mg::Poller::addChannel(Channel *channel)
+{
+    size_t fd = static_cast<size_t>(channel->fd());
+    if (fd >= this->_channels.size())
+        this->_channels.resize(std::max(fd + 1, this->_channels.size() << 1), nullptr);
+    if (!this->_channels[fd])
+        this->_channelNums++;
+    this->_channels[fd] = channel;
+}
+
+void mg::Poller::eraseChannel(Channel *channel)
+{
+    if (this->hasChannel(channel))
+    {
+        this->_channels[channel->fd()] = nullptr;
+        this->_channelNums--;
+    }
 }
\ No newline at end of file
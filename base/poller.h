@@ -1,7 +1,7 @@
 #ifndef __MG_POLLER_H__
 #define __MG_POLLER_H__
 
-#include <map>
+#include <vector>
 #include <sys/epoll.h>
 
 namespace mg
@@ -23,8 +23,20 @@ namespace mg
         virtual bool hasChannel(Channel *channel) const;
 
     protected:
-        using ChannelMap = std::map<int, Channel *>;
-        ChannelMap _channels;
+        /**
+         * @brief 记录fd对应的channel，表不够大时扩容
+         */
+        void addChannel(Channel *channel);
+
+        /**
+         * @brief 删除fd对应的channel
+         */
+        void eraseChannel(Channel *channel);
+
+        // 以fd为下标的channel表，fd总是取最小的可用值，表是紧凑的，增删查都是O(1)且不申请内存
+        using ChannelList = std::vector<Channel *>;
+        ChannelList _channels;
+        size_t _channelNums; // 表中的channel数量
 
     private:
         EventLoop *_loop;
@@ -0,0 +1,322 @@
+#include "redis-async-client.h"
+#include "event-loop.h"
+#include "channel.h"
+
+mg::RedisAsyncClient::RedisAsyncClient(EventLoop *loop, const std::string &ip, uint16_t port,
+                                       const std::string &password, int db)
+    : _loop(loop), _ip(ip), _port(port), _password(password), _db(db),
+      _context(nullptr), _connected(false), _stopped(false),
+      _retry(true), _retryInterval(1.0), _commandTimeout(0), _pending(0)
+{
+    ;
+}
+
+mg::RedisAsyncClient::~RedisAsyncClient()
+{
+    assert(this->_loop->isInOwnerThread());
+    this->_stopped = true;
+    this->_loop->cancel(this->_retryTimer);
+    this->_loop->cancel(this->_timeoutTimer);
+    // 未完成的命令以失败回调，并通过cleanup移除Channel
+    if (this->_context)
+        redisAsyncFree(this->_context);
+}
+
+void mg::RedisAsyncClient::connect()
+{
+    this->_stopped = false;
+    this->_loop->run(std::bind(&RedisAsyncClient::connectInLoop, this));
+}
+
+void mg::RedisAsyncClient::disconnect()
+{
+    this->_loop->run([this]()
+                     {
+                         this->_stopped = true;
+                         this->_loop->cancel(this->_retryTimer);
+                         if (this->_context)
+                             redisAsyncDisconnect(this->_context); //
+                     });
+}
+
+void mg::RedisAsyncClient::enableRetry(double interval)
+{
+    this->_retry = true;
+    this->_retryInterval = interval;
+}
+
+void mg::RedisAsyncClient::disableRetry()
+{
+    this->_retry = false;
+}
+
+void mg::RedisAsyncClient::setCommandTimeout(double seconds)
+{
+    this->_commandTimeout = seconds;
+}
+
+void mg::RedisAsyncClient::setConnectionCallback(ConnectionCallback callback)
+{
+    this->_connectionCallback = std::move(callback);
+}
+
+void mg::RedisAsyncClient::command(std::vector<std::string> args, CommandCallback callback)
+{
+    if (this->_loop->isInOwnerThread())
+        this->commandInLoop(args, callback);
+    else
+    {
+        std::shared_ptr<std::vector<std::string>> params = std::make_shared<std::vector<std::string>>(std::move(args));
+        std::shared_ptr<CommandCallback> done = std::make_shared<CommandCallback>(std::move(callback));
+        this->_loop->run([this, params, done]()
+                         { this->commandInLoop(*params, *done); });
+    }
+}
+
+void mg::RedisAsyncClient::command(std::initializer_list<std::string> args, CommandCallback callback)
+{
+    this->command(std::vector<std::string>(args), std::move(callback));
+}
+
+void mg::RedisAsyncClient::connectInLoop()
+{
+    if (this->_context || this->_stopped)
+        return;
+    redisAsyncContext *context = redisAsyncConnect(this->_ip.c_str(), this->_port);
+    if (!context)
+    {
+        LOG_ERROR("redis async connect {}:{} out of memory", this->_ip, this->_port);
+        return;
+    }
+    if (context->err)
+    {
+        LOG_ERROR("redis async connect {}:{} error: {}", this->_ip, this->_port, context->errstr);
+        redisAsyncFree(context);
+        this->retry();
+        return;
+    }
+
+    this->_context = context;
+    context->data = this;
+    context->ev.data = this;
+    context->ev.addRead = &RedisAsyncClient::addRead;
+    context->ev.delRead = &RedisAsyncClient::delRead;
+    context->ev.addWrite = &RedisAsyncClient::addWrite;
+    context->ev.delWrite = &RedisAsyncClient::delWrite;
+    context->ev.cleanup = &RedisAsyncClient::cleanup;
+    context->ev.scheduleTimer = &RedisAsyncClient::scheduleTimer;
+    redisAsyncSetConnectCallbackNC(context, &RedisAsyncClient::onConnect);
+    redisAsyncSetDisconnectCallback(context, &RedisAsyncClient::onDisconnect);
+    if (this->_commandTimeout > 0)
+    {
+        struct timeval tv;
+        tv.tv_sec = static_cast<time_t>(this->_commandTimeout);
+        tv.tv_usec = static_cast<suseconds_t>((this->_commandTimeout - tv.tv_sec) * 1000000);
+        redisAsyncSetTimeout(context, tv);
+    }
+
+    this->_channel = std::make_shared<Channel>(this->_loop, context->c.fd);
+    this->_channel->setReadCallback(std::bind(&RedisAsyncClient::handleRead, this, std::placeholders::_1));
+    this->_channel->setWriteCallback(std::bind(&RedisAsyncClient::handleWrite, this));
+    // 挂断和错误都交给hiredis的读处理，由它发现连接断开
+    this->_channel->setCloseCallback(std::bind(&RedisAsyncClient::handleRead, this, TimeStamp()));
+    this->_channel->setErrorCallback(std::bind(&RedisAsyncClient::handleRead, this, TimeStamp()));
+    // 非阻塞connect完成时可写
+    this->_channel->enableWriting();
+
+    // 认证和选择数据库排在所有命令之前，连接建立后一起发送
+    std::string name = this->_ip + ":" + std::to_string(this->_port);
+    if (!this->_password.empty())
+    {
+        std::vector<std::string> args{"AUTH", this->_password};
+        CommandCallback callback = [name](bool ok, RedisResult &result)
+        {
+            if (!ok)
+                LOG_ERROR("redis {} auth failed: {}", name, result.str);
+        };
+        this->commandInLoop(args, callback);
+    }
+    if (this->_db)
+    {
+        std::vector<std::string> args{"SELECT", std::to_string(this->_db)};
+        CommandCallback callback = [name](bool ok, RedisResult &result)
+        {
+            if (!ok)
+                LOG_ERROR("redis {} select failed: {}", name, result.str);
+        };
+        this->commandInLoop(args, callback);
+    }
+}
+
+void mg::RedisAsyncClient::commandInLoop(std::vector<std::string> &args, CommandCallback &callback)
+{
+    if (!this->_context || this->_context->c.flags & (REDIS_DISCONNECTING | REDIS_FREEING))
+    {
+        if (callback)
+        {
+            RedisResult result;
+            result.type = REDIS_REPLY_TYPE_ERROR;
+            result.str = "redis not connected";
+            callback(false, result);
+        }
+        return;
+    }
+
+    std::vector<const char *> argv;
+    std::vector<size_t> lens;
+    argv.reserve(args.size());
+    lens.reserve(args.size());
+    for (auto &x : args)
+    {
+        argv.push_back(x.data());
+        lens.push_back(x.size());
+    }
+
+    Request *request = new Request{this, std::move(callback)};
+    // 命令只是追加到hiredis的输出缓冲区并注册可写事件，同一轮中的多个命令在可写时一起发送
+    if (redisAsyncCommandArgv(this->_context, &RedisAsyncClient::onReply, request,
+                              static_cast<int>(args.size()), argv.data(), lens.data()) != REDIS_OK)
+    {
+        RedisResult result;
+        result.type = REDIS_REPLY_TYPE_ERROR;
+        result.str = this->_context->errstr[0] ? this->_context->errstr : "redis command failed";
+        if (request->callback)
+            request->callback(false, result);
+        delete request;
+        return;
+    }
+    this->_pending++;
+}
+
+void mg::RedisAsyncClient::retry()
+{
+    if (this->_stopped || !this->_retry)
+        return;
+    LOG_INFO("redis {}:{} reconnect after {}s", this->_ip, this->_port, this->_retryInterval);
+    this->_retryTimer = this->_loop->runAfter(this->_retryInterval, std::bind(&RedisAsyncClient::connectInLoop, this));
+}
+
+void mg::RedisAsyncClient::handleRead(TimeStamp time)
+{
+    if (this->_context)
+        redisAsyncHandleRead(this->_context);
+}
+
+void mg::RedisAsyncClient::handleWrite()
+{
+    // 读回调中连接可能已经被释放
+    if (this->_context)
+        redisAsyncHandleWrite(this->_context);
+}
+
+void mg::RedisAsyncClient::addRead(void *privdata)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    if (client->_channel && !client->_channel->isReading())
+        client->_channel->enableReading();
+}
+
+void mg::RedisAsyncClient::delRead(void *privdata)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    if (client->_channel && client->_channel->isReading())
+        client->_channel->disableReading();
+}
+
+void mg::RedisAsyncClient::addWrite(void *privdata)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    if (client->_channel && !client->_channel->isWriting())
+        client->_channel->enableWriting();
+}
+
+void mg::RedisAsyncClient::delWrite(void *privdata)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    if (client->_channel && client->_channel->isWriting())
+        client->_channel->disableWriting();
+}
+
+void mg::RedisAsyncClient::cleanup(void *privdata)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    client->_loop->cancel(client->_timeoutTimer);
+    client->_timeoutTimer = TimerId();
+    if (!client->_channel)
+        return;
+    // 可能正在Channel的事件回调中，Channel延后到本轮事件处理完之后再释放
+    std::shared_ptr<Channel> channel = std::move(client->_channel);
+    channel->disableAllEvents();
+    channel->remove();
+    client->_loop->push([channel]() {});
+}
+
+void mg::RedisAsyncClient::scheduleTimer(void *privdata, struct timeval tv)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(privdata);
+    client->_loop->cancel(client->_timeoutTimer);
+    double delay = tv.tv_sec + tv.tv_usec / 1000000.0;
+    client->_timeoutTimer = client->_loop->runAfter(delay, [client]()
+                                                    {
+                                                        if (client->_context)
+                                                            redisAsyncHandleTimeout(client->_context); //
+                                                    });
+}
+
+void mg::RedisAsyncClient::onConnect(redisAsyncContext *context, int status)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(context->data);
+    if (status != REDIS_OK)
+    {
+        // 连接失败时hiredis随后会释放context，不会再调用onDisconnect
+        LOG_ERROR("redis {}:{} connect failed: {}", client->_ip, client->_port, context->errstr);
+        client->_context = nullptr;
+        client->_pending = 0;
+        if (client->_connectionCallback)
+            client->_connectionCallback(false);
+        client->retry();
+        return;
+    }
+    LOG_INFO("redis {}:{} connected", client->_ip, client->_port);
+    client->_connected = true;
+    if (client->_connectionCallback)
+        client->_connectionCallback(true);
+}
+
+void mg::RedisAsyncClient::onDisconnect(const redisAsyncContext *context, int status)
+{
+    RedisAsyncClient *client = static_cast<RedisAsyncClient *>(context->data);
+    if (status != REDIS_OK)
+        LOG_ERROR("redis {}:{} disconnected: {}", client->_ip, client->_port, context->errstr);
+    else
+        LOG_INFO("redis {}:{} disconnected", client->_ip, client->_port);
+    // 返回之后hiredis会释放context
+    client->_context = nullptr;
+    client->_connected = false;
+    client->_pending = 0;
+    if (client->_connectionCallback)
+        client->_connectionCallback(false);
+    client->retry();
+}
+
+void mg::RedisAsyncClient::onReply(redisAsyncContext *context, void *reply, void *privdata)
+{
+    Request *request = static_cast<Request *>(privdata);
+    RedisAsyncClient *client = request->client;
+    if (client->_pending)
+        client->_pending--;
+
+    RedisResult result;
+    bool ok = false;
+    if (reply)
+        ok = parseRedisReply(static_cast<redisReply *>(reply), result);
+    else
+    {
+        // 连接断开、超时或者释放context时未完成的命令得到空应答
+        result.type = REDIS_REPLY_TYPE_ERROR;
+        result.str = context->errstr[0] ? context->errstr : "redis connection closed";
+    }
+    if (request->callback)
+        request->callback(ok, result);
+    delete request;
+}
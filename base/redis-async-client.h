@@ -0,0 +1,141 @@
+#ifndef __MG_REDIS_ASYNC_CLIENT_H__
+#define __MG_REDIS_ASYNC_CLIENT_H__
+
+#include "noncopyable.h"
+#include "redis.h"
+#include "timer-id.h"
+#include <hiredis/include/async.h>
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mg
+{
+    class EventLoop;
+    class Channel;
+
+    /**
+     * @brief 基于hiredis异步接口的redis客户端，套接字由所属eventloop的Channel驱动，不会阻塞loop线程
+     *        同一轮事件循环中发出的多个命令写在同一个缓冲区中一次发送，应答按照发送顺序依次回调，
+     *        多个并发的命令自动在一个连接上流水线执行
+     *        回调都在所属loop线程中执行，对象需要在所属loop线程中析构
+     */
+    class RedisAsyncClient : noncopyable
+    {
+    public:
+        /**
+         * @brief 命令完成时的回调
+         * @param ok 命令执行成功时为true，错误应答、连接断开或者超时时为false
+         * @param result 应答内容，失败时result.str中保存错误信息
+         */
+        using CommandCallback = std::function<void(bool ok, RedisResult &result)>;
+        using ConnectionCallback = std::function<void(bool connected)>;
+
+        RedisAsyncClient(EventLoop *loop, const std::string &ip, uint16_t port,
+                         const std::string &password = std::string(), int db = 0);
+
+        ~RedisAsyncClient();
+
+        /**
+         * @brief 发起连接，连接建立之前发出的命令会先缓存，连接建立后一起发送
+         */
+        void connect();
+
+        /**
+         * @brief 等待已经发出的命令完成后断开连接，不再重连
+         */
+        void disconnect();
+
+        /**
+         * @brief 连接断开后每隔interval秒重连一次，默认开启
+         */
+        void enableRetry(double interval = 1.0);
+
+        void disableRetry();
+
+        /**
+         * @brief 单个命令的超时时间，超时后连接会被断开，所有未完成的命令都以失败回调，0表示不超时
+         */
+        void setCommandTimeout(double seconds);
+
+        /**
+         * @brief 连接建立或者断开时的回调
+         */
+        void setConnectionCallback(ConnectionCallback callback);
+
+        /**
+         * @brief 发送命令，可以在任意线程调用，参数按照二进制安全的方式发送
+         * @param args 命令和参数，例如{"SET", key, value}
+         * @param callback 完成时在所属loop线程中执行，可以为空
+         */
+        void command(std::vector<std::string> args, CommandCallback callback = CommandCallback());
+        void command(std::initializer_list<std::string> args, CommandCallback callback = CommandCallback());
+
+        /**
+         * @brief 是否已经建立连接，只能在所属loop线程中调用
+         */
+        inline bool connected() const { return this->_connected; }
+
+        /**
+         * @brief 已经发出还没有收到应答的命令数，只能在所属loop线程中调用
+         */
+        inline size_t pendingCommands() const { return this->_pending; }
+
+        inline EventLoop *getLoop() const { return this->_loop; }
+
+    private:
+        void connectInLoop();
+
+        void commandInLoop(std::vector<std::string> &args, CommandCallback &callback);
+
+        /**
+         * @brief 连接断开后按照设置决定是否重连
+         */
+        void retry();
+
+        void handleRead(TimeStamp time);
+
+        void handleWrite();
+
+        /*-------以下是注册给hiredis的事件钩子，privdata为RedisAsyncClient--------*/
+        static void addRead(void *privdata);
+        static void delRead(void *privdata);
+        static void addWrite(void *privdata);
+        static void delWrite(void *privdata);
+        static void cleanup(void *privdata);
+        static void scheduleTimer(void *privdata, struct timeval tv);
+
+        static void onConnect(redisAsyncContext *context, int status);
+        static void onDisconnect(const redisAsyncContext *context, int status);
+        static void onReply(redisAsyncContext *context, void *reply, void *privdata);
+
+        // 每个命令的上下文，作为hiredis的privdata
+        struct Request
+        {
+            RedisAsyncClient *client;
+            CommandCallback callback;
+        };
+
+        EventLoop *_loop;                    // 所属的事件循环
+        std::string _ip;                     // redis地址
+        uint16_t _port;                      // redis端口
+        std::string _password;               // 密码，为空时不认证
+        int _db;                             // 连接后选择的数据库
+        redisAsyncContext *_context;         // hiredis的异步上下文，断开后为空
+        std::shared_ptr<Channel> _channel;   // 管理redis套接字的Channel
+        bool _connected;                     // 是否已经建立连接
+        bool _stopped;                       // 是否主动断开
+        bool _retry;                         // 断开后是否重连
+        double _retryInterval;               // 重连间隔秒数
+        double _commandTimeout;              // 命令超时秒数
+        TimerId _retryTimer;                 // 重连定时器
+        TimerId _timeoutTimer;               // hiredis的超时定时器
+        size_t _pending;                     // 还没有收到应答的命令数
+        ConnectionCallback _connectionCallback; // 连接建立或者断开时的回调
+    };
+};
+
+#endif //__MG_REDIS_ASYNC_CLIENT_H__
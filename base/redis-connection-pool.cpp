@@ -9,7 +9,7 @@
 
 mg::RedisConnectionPool::RedisConnectionPool(mg::EventLoop *loop, const std::string &name)
     : _loop(loop), _name(name), _db(0), _port(0), _maxsize(0), _minsize(0),
-      _totalsize(0), _timeout(0), _idletimeout(), _keepalive(false)
+      _totalsize(0), _timeout(0), _idletimeout(), _waittimeout(500), _keepalive(false)
 {
     ;
 }
@@ -20,11 +20,10 @@ mg::RedisConnectionPool::~RedisConnectionPool()
      * FIXME: Before destruction, connections in the queue
      *        may have been allocated but not fully released
      */
-    while (!_queue.empty())
-    {
-        SAFE_DELETE(_queue.front());
-        _queue.pop_front();
-    }
+    if (!this->_connections)
+        return;
+    while (RedisConnection *connection = this->_connections->pop())
+        SAFE_DELETE(connection);
 }
 
 bool mg::RedisConnectionPool::initial(const std::string &configPath, const std::string &name)
@@ -42,6 +41,8 @@ bool mg::RedisConnectionPool::initial(nlohmann::json &config, const std::string
     _minsize = config.value("minsize", 1);
     _timeout = config.value("timeout", 0);
     _idletimeout = config.value("idletimeout", 0);
+    _waittimeout = config.value("waittimeout", 500);
+    _connections.reset(new ConnectionCache<RedisConnection>(std::max(_maxsize, _minsize)));
     if (this->_loop == nullptr)
     {
         _thread.reset(new mg::EventLoopThread(name));
@@ -53,40 +54,14 @@ bool mg::RedisConnectionPool::initial(nlohmann::json &config, const std::string
 bool mg::RedisConnectionPool::start()
 {
     assert(this->_loop != nullptr && "redis start failed");
-    {
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (!this->addInitial())
-            return false;
-    }
+    if (!this->addInitial())
+        return false;
 
     this->_loop->runEvery(this->_timeout, std::bind(&RedisConnectionPool::add, this));
     this->_loop->runEvery(this->_timeout, std::bind(&RedisConnectionPool::remove, this));
 
     if (this->_keepalive)
-    {
-        this->_loop->runEvery(this->_idletimeout, [this]()
-                              {
-                                  std::lock_guard<std::mutex> guard(this->_mutex);
-                                  mg::RedisResult result;
-                                  int size = this->_queue.size();
-                                  for (int i = 0; i < size; i++)
-                                  {
-                                      auto con = this->_queue.front();
-                                      this->_queue.pop_front();
-                                      result.reset();
-                                      con->execute("PING", result);
-                                      this->_queue.push_back(con);
-                                      std::string resultStr = result;
-                                      if (resultStr == "PONG")
-                                      {
-                                          con->refresh();
-                                          LOG_TRACE("redis {} keepalive {}", this->_name, (void *)con);
-                                      }
-                                      else
-                                          LOG_ERROR("redis {} keepalive error {}", this->_name, (void *)con);
-                                  } //
-                              });
-    }
+        this->_loop->runEvery(this->_idletimeout, std::bind(&RedisConnectionPool::keepAlive, this));
     LOG_INFO("redis pool {} start success", this->_name);
     return true;
 }
@@ -97,35 +72,43 @@ void mg::RedisConnectionPool::quit()
         this->_loop->quit();
 }
 
-std::shared_ptr<mg::RedisConnection> mg::RedisConnectionPool::getHandle()
+mg::RedisHandle mg::RedisConnectionPool::getHandle()
 {
+    // 在定时器线程中等待会阻塞连接的补充
     assert(!_loop->isInOwnerThread());
 
-    std::unique_lock<std::mutex> lock(_mutex);
-    if (_queue.empty() && _condition.wait_for(lock, std::chrono::milliseconds(500)) == std::cv_status::timeout)
+    RedisConnection *connection = this->_connections->acquire(std::chrono::milliseconds(this->_waittimeout));
+    if (!connection)
         return nullptr;
+    return RedisHandle(this, connection);
+}
 
-    std::shared_ptr<RedisConnection> res(_queue.front(), [this](mg::RedisConnection *connection)
-                                         {
-                                             std::lock_guard<std::mutex> guard(this->_mutex);
-                                             connection->refresh();
-                                             this->_queue.push_back(connection);
-                                             this->_condition.notify_one(); //
-                                         });
-
-    _queue.pop_front();
-    return res;
+void mg::RedisConnectionPool::release(RedisConnection *connection)
+{
+    connection->refresh();
+    if (!this->_connections->release(connection))
+    {
+        SAFE_DELETE(connection);
+        this->_totalsize--;
+    }
 }
 
 bool mg::RedisConnectionPool::addInitial()
 {
-    int len = std::min(_minsize, static_cast<uint16_t>(_minsize - _queue.size()));
+    // 新建连接时不持有任何锁，已有的空闲连接可以照常取出
+    int len = this->_minsize - this->_totalsize.load();
+    if (len <= 0 && this->_connections->idle() == 0 && this->_totalsize < this->_maxsize)
+        len = std::min<int>(std::max<int>(this->_minsize, 1), this->_maxsize - this->_totalsize.load());
     for (int i = 0; i < len; i++)
     {
         mg::RedisConnection *redis = new mg::RedisConnection();
         if (!redis->connect(this->_host, this->_port, this->_password, this->_db, this->_timeout))
+        {
+            SAFE_DELETE(redis);
             return false;
-        this->_queue.push_back(redis);
+        }
+        this->_totalsize++;
+        this->putBack(redis);
     }
     return true;
 }
@@ -133,25 +116,60 @@ bool mg::RedisConnectionPool::addInitial()
 void mg::RedisConnectionPool::add()
 {
     LOG_TRACE("redis {} add called", this->_name);
-    std::lock_guard<std::mutex> guard(_mutex);
-    if (!_queue.empty() || this->_totalsize > this->_maxsize)
+    if (this->_connections->idle() > 0 && this->_totalsize >= this->_minsize)
         return;
-    addInitial();
-    _condition.notify_one();
+    this->addInitial();
 }
 
 void mg::RedisConnectionPool::remove()
 {
     LOG_TRACE("redis {} remove called", this->_name);
-    std::lock_guard<std::mutex> guard(_mutex);
-    while (_queue.size() > _minsize)
+    // 逐个取出空闲连接检查，仍在使用期限内的放回，检查期间其他线程照常取出和归还
+    size_t count = this->_connections->idle();
+    for (size_t i = 0; i < count && this->_totalsize > this->_minsize; i++)
     {
-        auto front = _queue.front();
-        if (front->getVacantTime().getSeconds() < _idletimeout)
+        RedisConnection *connection = this->_connections->pop();
+        if (!connection)
             break;
-        _queue.pop_front();
-        LOG_TRACE("redis {} remove {}", this->_name, (void *)front);
-        SAFE_DELETE(front);
+        if (connection->getVacantTime().getSeconds() < _idletimeout)
+        {
+            this->putBack(connection);
+            continue;
+        }
+        LOG_TRACE("redis {} remove {}", this->_name, (void *)connection);
+        SAFE_DELETE(connection);
+        this->_totalsize--;
+    }
+}
+
+void mg::RedisConnectionPool::keepAlive()
+{
+    // PING时不持有锁，正在检查的连接只是暂时不可用
+    mg::RedisResult result;
+    size_t count = this->_connections->idle();
+    for (size_t i = 0; i < count; i++)
+    {
+        RedisConnection *connection = this->_connections->pop();
+        if (!connection)
+            break;
+        result.reset();
+        connection->execute("PING", result);
+        if (result.type == REDIS_REPLY_TYPE_STATUS && result.str == "PONG")
+        {
+            connection->refresh();
+            LOG_TRACE("redis {} keepalive {}", this->_name, (void *)connection);
+        }
+        else
+            LOG_ERROR("redis {} keepalive error {}", this->_name, (void *)connection);
+        this->putBack(connection);
+    }
+}
+
+void mg::RedisConnectionPool::putBack(RedisConnection *connection)
+{
+    if (!this->_connections->push(connection))
+    {
+        SAFE_DELETE(connection);
         this->_totalsize--;
     }
 }
@@ -204,7 +222,7 @@ std::shared_ptr<mg::RedisConnectionPool> mg::RedisPoolManager::getPool(const std
     return it->second;
 }
 
-std::shared_ptr<mg::RedisConnection> mg::RedisPoolManager::getHandle(const std::string &poolName)
+mg::RedisHandle mg::RedisPoolManager::getHandle(const std::string &poolName)
 {
     auto pool = this->getPool(poolName);
     if (!pool)
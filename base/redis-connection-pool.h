@@ -5,12 +5,11 @@
 #include "redis.h"
 #include "json_fwd.hpp"
 #include "eventloop-thread.h"
+#include "connection-cache.h"
 
+#include <atomic>
 #include <string>
 #include <memory>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 
 namespace mg
 {
@@ -18,8 +17,17 @@ namespace mg
     class EventLoop;
     class EventLoopThread;
 
+    class RedisConnectionPool;
+
+    /**
+     * @brief 从连接池取出的redis连接，析构时自动归还
+     */
+    using RedisHandle = PoolHandle<RedisConnectionPool, RedisConnection>;
+
     class RedisConnectionPool
     {
+        friend class PoolHandle<RedisConnectionPool, RedisConnection>;
+
     public:
         RedisConnectionPool(EventLoop *loop = nullptr, const std::string &name = "");
 
@@ -49,9 +57,11 @@ namespace mg
         void quit();
 
         /**
-         * @brief get a redis connection
+         * @brief get a redis connection, wait at most waittimeout milliseconds (default 500) when all connections are busy
+         *        the connection returns to the pool when the handle is destroyed, prefer the calling thread's cache slot
+         * @return empty handle if timeout
          */
-        std::shared_ptr<RedisConnection> getHandle();
+        RedisHandle getHandle();
 
         /**
          * @brief enable keepalive connection like mysql ping
@@ -65,10 +75,22 @@ namespace mg
 
         void remove();
 
+        void keepAlive();
+
+        /**
+         * @brief called by RedisHandle when the connection is returned
+         */
+        void release(RedisConnection *connection);
+
+        /**
+         * @brief put the connection back to the shared queue, delete it if the pool is full
+         */
+        void putBack(RedisConnection *connection);
+
     private:
         EventLoop *_loop;
         std::unique_ptr<mg::EventLoopThread> _thread;
-        std::deque<RedisConnection *> _queue;
+        std::unique_ptr<ConnectionCache<RedisConnection>> _connections; // idle connections
         std::string _name;
         std::string _host;
         std::string _password;
@@ -76,11 +98,10 @@ namespace mg
         uint16_t _port;
         uint16_t _maxsize;
         uint16_t _minsize;
-        uint16_t _totalsize;
+        std::atomic<uint16_t> _totalsize;
         uint16_t _timeout;
         uint32_t _idletimeout;
-        std::mutex _mutex;
-        std::condition_variable _condition;
+        uint32_t _waittimeout;
         bool _keepalive;
     };
 
@@ -96,7 +117,7 @@ namespace mg
 
         std::shared_ptr<RedisConnectionPool> getPool(const std::string &poolName);
 
-        std::shared_ptr<RedisConnection> getHandle(const std::string &poolName);
+        RedisHandle getHandle(const std::string &poolName);
 
     private:
         std::map<std::string, std::shared_ptr<RedisConnectionPool>> _pools;
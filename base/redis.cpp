@@ -1,6 +1,7 @@
 #include "redis.h"
 
-#include <sstream>
+#include <ctype.h>
+#include <strings.h>
 
 mg::RedisConnection::~RedisConnection()
 {
@@ -38,17 +39,58 @@ bool mg::RedisConnection::connect(const std::string &ip, uint16_t port, const st
 
 bool mg::RedisConnection::execute(const std::string &command, RedisResult &result)
 {
-    this->freeReply();
-    this->_reply = (redisReply *)redisCommand(this->_context, command.c_str());
+    // 与不带格式参数的redisCommand一样按照空白拆分参数，命令中的'%'不会被当作格式符
+    std::vector<RedisArg> args;
+    size_t len = command.size();
+    size_t start = 0;
+    while (start < len)
+    {
+        while (start < len && ::isspace(static_cast<unsigned char>(command[start])))
+            start++;
+        size_t end = start;
+        while (end < len && !::isspace(static_cast<unsigned char>(command[end])))
+            end++;
+        if (end > start)
+            args.emplace_back(command.data() + start, end - start);
+        start = end;
+    }
+    if (args.empty())
+        return false;
+    this->execArgv(args);
     return this->parseReply(result);
 }
 
+bool mg::RedisConnection::command(std::initializer_list<RedisArg> args, RedisResult &result)
+{
+    this->execArgv(args);
+    return this->parseReply(result);
+}
+
+bool mg::RedisConnection::command(const std::vector<RedisArg> &args, RedisResult &result)
+{
+    this->execArgv(args);
+    return this->parseReply(result);
+}
+
+bool mg::RedisConnection::command(std::initializer_list<RedisArg> args, RedisReplyView &reply)
+{
+    bool ok = this->execArgv(args);
+    reply = RedisReplyView(this->_reply);
+    return ok && !reply.isError();
+}
+
+bool mg::RedisConnection::command(const std::vector<RedisArg> &args, RedisReplyView &reply)
+{
+    bool ok = this->execArgv(args);
+    reply = RedisReplyView(this->_reply);
+    return ok && !reply.isError();
+}
+
 bool mg::RedisConnection::authenticate(const std::string &password)
 {
     if (password.empty())
         return true;
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "AUTH %s", password.c_str()));
+    this->execArgv({RedisArg("AUTH", 4), password});
     if (this->_reply == nullptr || this->_reply->type == REDIS_REPLY_TYPE_ERROR)
     {
         this->freeReply();
@@ -60,64 +102,53 @@ bool mg::RedisConnection::authenticate(const std::string &password)
 bool mg::RedisConnection::selectDatabase(int db)
 {
     RedisResult result;
-    std::stringstream ss;
-    ss << "SELECT " << db;
-    return this->execute(ss.str(), result);
+    return this->command({RedisArg("SELECT", 6), std::to_string(db)}, result);
 }
 
 bool mg::RedisConnection::GET(const std::string &key, RedisResult &result)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "GET %s", key.c_str()));
+    this->execArgv({RedisArg("GET", 3), key});
     return this->parseReply(result);
 }
 
 bool mg::RedisConnection::SET(const std::string &key, const std::string &value)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "SET %s %s",
-                                                          key.c_str(), value.c_str()));
+    this->execArgv({RedisArg("SET", 3), key, value});
     return this->parseReply(_temp);
 }
 
 bool mg::RedisConnection::MGET(std::initializer_list<std::string> &&keys, RedisResult &values)
 {
-    return this->MGET(std::vector<std::string>(keys), values);
+    return this->MGET(keys, values);
 }
 
 bool mg::RedisConnection::MSET(std::initializer_list<std::string> &&keys, std::vector<std::string> &values)
 {
-    return this->MSET(std::vector<std::string>(keys), values);
+    std::vector<std::string> _keys(keys);
+    return this->MSET(_keys, values);
 }
 
 bool mg::RedisConnection::DEL(const std::string &key)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "DEL %s",
-                                                          key.c_str()));
+    this->execArgv({RedisArg("DEL", 3), key});
     return this->parseReply(_temp);
 }
 
 bool mg::RedisConnection::HGET(const std::string &key, const std::string &field, RedisResult &result)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HGET %s %s",
-                                                          key.c_str(), field.c_str()));
+    this->execArgv({RedisArg("HGET", 4), key, field});
     return this->parseReply(result);
 }
 
 bool mg::RedisConnection::HGETALL(const std::string &key, RedisResult &result)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HGETALL %s", key.c_str()));
+    this->execArgv({RedisArg("HGETALL", 7), key});
     return this->parseReply(result);
 }
 
 bool mg::RedisConnection::HEXISTS(const std::string &key, const std::string &field, RedisResult &result)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HEXISTS %s %s",
-                                                          key.c_str(), field.c_str()));
+    this->execArgv({RedisArg("HEXISTS", 7), key, field});
     return this->parseReply(result);
 }
 
@@ -128,18 +159,18 @@ bool mg::RedisConnection::HMGET(const std::string &key, std::initializer_list<st
 
 bool mg::RedisConnection::HDEL(const std::string &key, const std::string &field)
 {
-    this->freeReply();
-    this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HDEL %s %s",
-                                                          key.c_str(), field.c_str()));
+    this->execArgv({RedisArg("HDEL", 4), key, field});
     return this->parseReply(RedisResult());
 }
 
 bool mg::RedisConnection::HDEL(const std::string &key, std::vector<std::string> &fields)
 {
-    this->freeReply();
-    std::vector<std::string> _fields = {"HDEL", key};
-    _fields.insert(_fields.end(), fields.begin(), fields.end());
-    return this->execByParams(_fields);
+    std::vector<RedisArg> args;
+    args.reserve(fields.size() + 2);
+    args.emplace_back("HDEL", 4);
+    args.emplace_back(key);
+    args.insert(args.end(), fields.begin(), fields.end());
+    return this->execArgv(args);
 }
 
 void mg::RedisConnection::freeReply()
@@ -163,19 +194,151 @@ bool mg::RedisConnection::checkReply()
     return true;
 }
 
-bool mg::RedisConnection::execByParams(std::vector<std::string> &params)
+bool mg::RedisConnection::execArgv(const RedisArg *args, size_t count)
 {
     this->freeReply();
 
+    // 常用命令的参数很少，直接放在栈上，避免每次执行命令都分配内存
+    static const size_t kStackArgs = 16;
+    const char *stackArgv[kStackArgs];
+    size_t stackLens[kStackArgs];
+    std::vector<const char *> heapArgv;
+    std::vector<size_t> heapLens;
+    const char **argv = stackArgv;
+    size_t *lens = stackLens;
+    if (count > kStackArgs)
+    {
+        heapArgv.resize(count);
+        heapLens.resize(count);
+        argv = heapArgv.data();
+        lens = heapLens.data();
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        argv[i] = args[i].data;
+        lens[i] = args[i].len;
+    }
+
+    this->_reply = static_cast<redisReply *>(redisCommandArgv(this->_context, static_cast<int>(count), argv, lens));
+    return this->checkReply();
+}
+
+mg::RedisPipeline mg::RedisConnection::pipeline()
+{
+    return RedisPipeline(*this);
+}
+
+mg::RedisPipeline::RedisPipeline(RedisConnection &connection) : _connection(connection)
+{
+    ;
+}
+
+mg::RedisPipeline &mg::RedisPipeline::append(std::vector<std::string> args)
+{
+    if (!args.empty())
+        this->_commands.push_back(std::move(args));
+    return *this;
+}
+
+mg::RedisPipeline &mg::RedisPipeline::append(std::initializer_list<std::string> args)
+{
+    return this->append(std::vector<std::string>(args));
+}
+
+mg::RedisPipeline &mg::RedisPipeline::multi()
+{
+    return this->append({"MULTI"});
+}
+
+mg::RedisPipeline &mg::RedisPipeline::exec()
+{
+    return this->append({"EXEC"});
+}
+
+void mg::RedisPipeline::clear()
+{
+    this->_commands.clear();
+}
+
+bool mg::RedisPipeline::execute(std::vector<RedisResult> &results)
+{
+    results.clear();
+    std::vector<std::vector<std::string>> commands;
+    commands.swap(this->_commands);
+    if (commands.empty())
+        return true;
+
+    redisContext *context = this->_connection._context;
+    if (!context)
+        return false;
+    this->_connection.freeReply();
+
+    // 所有命令先写入hiredis的输出缓冲区，第一次redisGetReply时一起发送
     std::vector<const char *> args;
     std::vector<size_t> lens;
-    for (auto &key : params)
+    for (auto &command : commands)
     {
-        args.push_back(key.c_str());
-        lens.push_back(key.size());
+        args.clear();
+        lens.clear();
+        for (auto &x : command)
+        {
+            args.push_back(x.data());
+            lens.push_back(x.size());
+        }
+        if (redisAppendCommandArgv(context, command.size(), args.data(), lens.data()) != REDIS_OK)
+        {
+            LOG_ERROR("redis pipeline append error: {}", context->errstr);
+            return false;
+        }
     }
 
-    this->_reply = static_cast<redisReply *>(redisCommandArgv(this->_context, params.size(),
-                                                              args.data(), lens.data()));
-    return this->checkReply();
-}
\ No newline at end of file
+    bool ok = true;
+    bool inTransaction = false;
+    std::vector<size_t> queued; // 事务中命令的下标
+    results.resize(commands.size());
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        void *reply = nullptr;
+        if (redisGetReply(context, &reply) != REDIS_OK || !reply)
+        {
+            LOG_ERROR("redis pipeline execute error: {}", context->errstr);
+            results.resize(i);
+            return false;
+        }
+        redisReply *current = static_cast<redisReply *>(reply);
+        ok = parseRedisReply(current, results[i]) && ok;
+
+        const std::string &name = commands[i][0];
+        if (strcasecmp(name.c_str(), "MULTI") == 0)
+        {
+            inTransaction = true;
+            queued.clear();
+        }
+        else if (inTransaction && strcasecmp(name.c_str(), "EXEC") == 0)
+        {
+            inTransaction = false;
+            // EXEC的应答为空说明WATCH的键被修改，事务没有执行
+            bool executed = current->type == REDIS_REPLY_ARRAY && current->elements == queued.size();
+            for (size_t j = 0; j < queued.size(); j++)
+            {
+                RedisResult &result = results[queued[j]];
+                if (executed)
+                    ok = parseRedisReply(current->element[j], result) && ok;
+                else
+                {
+                    result.reset();
+                    result.type = REDIS_REPLY_TYPE_NIL;
+                    result.str = "REDIS_REPLY_TYPE_NIL";
+                    ok = false;
+                }
+            }
+        }
+        else if (inTransaction && strcasecmp(name.c_str(), "DISCARD") == 0)
+            inTransaction = false;
+        else if (inTransaction)
+            queued.push_back(i);
+        freeReplyObject(reply);
+    }
+    this->_connection.refresh();
+    return ok;
+}
@@ -7,11 +7,13 @@
 #include <hiredis/include/hiredis.h>
 
 #include <stddef.h>
+#include <string.h>
 #include <cstdint>
 #include <string>
 #include <stdexcept>
 #include <vector>
 #include <list>
+#include <initializer_list>
 
 namespace mg
 {
@@ -86,9 +88,181 @@ namespace mg
 
     using RedisResult = RedisValue;
 
+    /**
+     * @brief 命令参数，只引用调用者的数据而不复制，数据中可以包含'\0'
+     *        参数只在命令执行期间使用，调用者需要保证数据在此期间有效
+     */
+    struct RedisArg
+    {
+        const char *data;
+        size_t len;
+
+        RedisArg(const std::string &str) : data(str.data()), len(str.size()) {}
+
+        RedisArg(const char *str) : data(str), len(::strlen(str)) {}
+
+        RedisArg(const char *str, size_t len) : data(str), len(len) {}
+    };
+
+    /**
+     * @brief 直接引用hiredis应答的只读视图，读取时不会为每个元素创建std::string
+     *        只在产生它的应答被释放之前有效
+     */
+    class RedisReplyView
+    {
+    public:
+        RedisReplyView(const redisReply *reply = nullptr) : _reply(reply) {}
+
+        inline bool valid() const { return this->_reply != nullptr; }
+
+        inline RedisReplyType type() const
+        {
+            return this->_reply ? static_cast<RedisReplyType>(this->_reply->type) : REDIS_REPLY_TYPE_UNKNOWN;
+        }
+
+        inline bool isNil() const { return this->type() == REDIS_REPLY_TYPE_NIL; }
+
+        inline bool isError() const { return this->type() == REDIS_REPLY_TYPE_ERROR; }
+
+        /**
+         * @brief 字符串、状态和错误应答的数据，不以'\0'结尾时需要配合size使用
+         */
+        inline const char *data() const { return this->_reply ? this->_reply->str : nullptr; }
+
+        inline size_t size() const { return this->_reply && this->_reply->str ? this->_reply->len : 0; }
+
+        inline long long integer() const { return this->_reply ? this->_reply->integer : 0; }
+
+        /**
+         * @brief 数组应答的元素个数
+         */
+        inline size_t elements() const
+        {
+            return this->type() == REDIS_REPLY_TYPE_ARRAY ? this->_reply->elements : 0;
+        }
+
+        inline RedisReplyView operator[](size_t index) const
+        {
+            return index < this->elements() ? RedisReplyView(this->_reply->element[index]) : RedisReplyView();
+        }
+
+        /**
+         * @brief 需要保存数据时复制为std::string
+         */
+        inline std::string str() const { return std::string(this->data() ? this->data() : "", this->size()); }
+
+    private:
+        const redisReply *_reply;
+    };
+
+    /**
+     * @brief 把hiredis的应答转换为RedisResult，同步和异步客户端共用
+     * @return 应答为空或者是错误应答时返回false，错误信息保存在result.str中
+     */
+    inline bool parseRedisReply(const redisReply *reply, RedisResult &result)
+    {
+        if (!reply)
+            return false;
+        result.reset();
+        result.type = static_cast<RedisReplyType>(reply->type);
+        switch (reply->type)
+        {
+        case REDIS_REPLY_TYPE_STRING:
+        case REDIS_REPLY_TYPE_STATUS:
+        {
+            result.str = std::string(reply->str, reply->len);
+            break;
+        }
+        case REDIS_REPLY_TYPE_INTEGER:
+        {
+            result.value = reply->integer;
+            break;
+        }
+        case REDIS_REPLY_TYPE_ERROR:
+        {
+            result.str = std::string(reply->str, reply->len);
+            return false;
+        }
+        case REDIS_REPLY_TYPE_ARRAY:
+        {
+            int count = reply->elements;
+            for (int i = 0; i < count; i++)
+            {
+                auto &element = reply->element[i];
+                if (element->str)
+                    result.array.emplace_back(element->str, element->len);
+                else
+                {
+                    LOG_WARN("value is null: {}", i);
+                    result.array.emplace_back("");
+                }
+            }
+            break;
+        }
+        case REDIS_REPLY_TYPE_NIL:
+        {
+            result.str = "REDIS_REPLY_TYPE_NIL";
+            break;
+        }
+        default:
+            return false;
+        }
+        return true;
+    }
+
+    class RedisConnection;
+
+    /**
+     * @brief 在一个RedisConnection上批量执行命令
+     *        append只在本地保存命令，execute时用redisAppendCommandArgv把所有命令写入输出缓冲区，
+     *        一次发送后依次读取应答，多条命令只需要一次网络往返
+     *        multi和exec之间的命令在同一个事务中执行，它们的结果取自EXEC的应答
+     */
+    class RedisPipeline
+    {
+    public:
+        explicit RedisPipeline(RedisConnection &connection);
+
+        /**
+         * @brief 追加一条命令，参数按照二进制安全的方式发送
+         * @param args 命令和参数，例如{"HGET", key, field}
+         */
+        RedisPipeline &append(std::vector<std::string> args);
+        RedisPipeline &append(std::initializer_list<std::string> args);
+
+        /**
+         * @brief 开始事务，之后追加的命令直到exec都在事务中执行
+         */
+        RedisPipeline &multi();
+
+        /**
+         * @brief 提交事务
+         */
+        RedisPipeline &exec();
+
+        /**
+         * @brief 发送所有命令并读取应答，执行之后清空已追加的命令
+         * @param results 与追加的命令一一对应的结果，事务中命令的结果为实际执行的结果而不是QUEUED
+         * @return 所有命令都执行成功时返回true，连接出错时results中只有已经读到的结果
+         */
+        bool execute(std::vector<RedisResult> &results);
+
+        /**
+         * @brief 清空已追加的命令
+         */
+        void clear();
+
+        inline size_t size() const { return this->_commands.size(); }
+
+    private:
+        RedisConnection &_connection;
+        std::vector<std::vector<std::string>> _commands; // 待发送的命令
+    };
+
     class RedisConnection
     {
         friend class RedisConnectionPool;
+        friend class RedisPipeline;
 
     public:
         ~RedisConnection();
@@ -96,10 +270,32 @@ namespace mg
         bool connect(const std::string &ip, uint16_t port, const std::string &password,
                      int db = 0, int timeout = 0);
 
+        /**
+         * @brief 执行以空白分隔参数的命令，例如"EXPIRE key 60"，参数中不能包含空白
+         */
         bool execute(const std::string &command, RedisResult &result);
 
+        /**
+         * @brief 以二进制安全的方式执行命令，参数按照长度发送而不会被复制，可以保存序列化后的二进制数据
+         * @param args 命令和参数，例如{"SET", key, value}
+         */
+        bool command(std::initializer_list<RedisArg> args, RedisResult &result);
+        bool command(const std::vector<RedisArg> &args, RedisResult &result);
+
+        /**
+         * @brief 同上，应答以RedisReplyView返回，在下一次执行命令之前有效
+         * @return 连接出错或者错误应答时返回false
+         */
+        bool command(std::initializer_list<RedisArg> args, RedisReplyView &reply);
+        bool command(const std::vector<RedisArg> &args, RedisReplyView &reply);
+
         bool selectDatabase(int db);
 
+        /**
+         * @brief 创建在当前连接上批量执行命令的RedisPipeline
+         */
+        RedisPipeline pipeline();
+
     public: // Here are all the commonly used Redis command methods
         /**
          * @brief The following functions provide interfaces to access Redis.
@@ -175,7 +371,20 @@ namespace mg
         template <typename T>
         bool parseReply(T &&result);
 
-        bool execByParams(std::vector<std::string> &params);
+        /**
+         * @brief 用redisCommandArgv执行命令，应答保存在_reply中
+         */
+        bool execArgv(const RedisArg *args, size_t count);
+
+        inline bool execArgv(std::initializer_list<RedisArg> args)
+        {
+            return this->execArgv(args.begin(), args.size());
+        }
+
+        inline bool execArgv(const std::vector<RedisArg> &args)
+        {
+            return this->execArgv(args.data(), args.size());
+        }
 
         inline TimeStamp getVacantTime()
         {
@@ -210,59 +419,17 @@ namespace mg
         if (std::is_rvalue_reference<decltype(result)>::value)
             return true;
 
-        result.reset();
-        result.type = static_cast<RedisReplyType>(this->_reply->type);
-        switch (this->_reply->type)
-        {
-        case REDIS_REPLY_TYPE_STRING:
-        case REDIS_REPLY_TYPE_STATUS:
-        {
-            result.str = std::string(this->_reply->str, this->_reply->len);
-            break;
-        }
-        case REDIS_REPLY_TYPE_INTEGER:
-        {
-            result.value = this->_reply->integer;
-            break;
-        }
-        case REDIS_REPLY_TYPE_ERROR:
-        {
-            result.str = std::string(this->_reply->str, this->_reply->len);
-            return false;
-        }
-        case REDIS_REPLY_TYPE_ARRAY:
-        {
-            int count = this->_reply->elements;
-            for (int i = 0; i < count; i++)
-            {
-                auto &reply = this->_reply->element[i];
-                if (reply->str)
-                    result.array.emplace_back(reply->str, reply->len);
-                else
-                {
-                    LOG_WARN("value is null: {}", i);
-                    result.array.emplace_back("");
-                }
-            }
-            break;
-        }
-        case REDIS_REPLY_TYPE_NIL:
-        {
-            result.str = "REDIS_REPLY_TYPE_NIL";
-            break;
-        }
-        default:
-            return false;
-        }
-        return true;
+        return parseRedisReply(this->_reply, result);
     }
 
     template <typename T>
     inline bool RedisConnection::MGET(T &&keys, RedisResult &values)
     {
-        std::vector<std::string> _keys = {"MGET"};
-        _keys.insert(_keys.end(), keys.begin(), keys.end());
-        if (!this->execByParams(_keys))
+        std::vector<RedisArg> args;
+        args.reserve(keys.size() + 1);
+        args.emplace_back("MGET", 4);
+        args.insert(args.end(), keys.begin(), keys.end());
+        if (!this->execArgv(args))
             return false;
         return this->parseReply(values);
     }
@@ -272,14 +439,16 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, std::vector<std::string>>::value,
                       "RedisConnection::MSET only support std::vector<std::string>");
-        std::vector<std::string> _keys = {"MSET"};
-        int len = std::min(keys.size(), values.size());
-        for (int i = 0; i < len; i++)
+        size_t len = std::min(keys.size(), values.size());
+        std::vector<RedisArg> args;
+        args.reserve(len * 2 + 1);
+        args.emplace_back("MSET", 4);
+        for (size_t i = 0; i < len; i++)
         {
-            _keys.push_back(keys[i]);
-            _keys.push_back(values[i]);
+            args.emplace_back(keys[i]);
+            args.emplace_back(values[i]);
         }
-        return this->execByParams(_keys);
+        return this->execArgv(args);
     }
 
     template <typename T>
@@ -287,8 +456,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::INCR() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "INCR %s", key.c_str()));
+        this->execArgv({RedisArg("INCR", 4), key});
         return this->parseReply(std::forward<T>(result));
     }
 
@@ -297,9 +465,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::INCRBY() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context,
-                                                              "INCRBY %s %lld", key.c_str(), value));
+        this->execArgv({RedisArg("INCRBY", 6), key, std::to_string(value)});
         return this->parseReply(std::forward<T>(result));
     }
 
@@ -308,8 +474,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::DECR() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "DECR %s", key.c_str()));
+        this->execArgv({RedisArg("DECR", 4), key});
         return this->parseReply(std::forward<T>(result));
     }
 
@@ -318,9 +483,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::DECRBY() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context,
-                                                              "DECRBY %s %lld", key.c_str(), value));
+        this->execArgv({RedisArg("DECRBY", 6), key, std::to_string(value)});
         return this->parseReply(std::forward<T>(result));
     }
 
@@ -330,10 +493,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::HSET() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HSET %s %s %s",
-                                                              key.c_str(), field.c_str(),
-                                                              value.c_str()));
+        this->execArgv({RedisArg("HSET", 4), key, field, value});
         return this->parseReply(std::forward<T>(result));
     }
 
@@ -343,9 +503,12 @@ namespace mg
         static_assert(std::is_same<typename std::remove_const<T>::type, std::vector<std::string>>::value ||
                           std::is_same<typename std::remove_const<T>::type, std::initializer_list<std::string>>::value,
                       "RedisConnection::HMGET() only support std::vector<std::string> or std::initializer_list<std::string>");
-        std::vector<std::string> _fields = {"HMGET", key};
-        _fields.insert(_fields.end(), fields.begin(), fields.end());
-        if (!this->execByParams(_fields))
+        std::vector<RedisArg> args;
+        args.reserve(fields.size() + 2);
+        args.emplace_back("HMGET", 5);
+        args.emplace_back(key);
+        args.insert(args.end(), fields.begin(), fields.end());
+        if (!this->execArgv(args))
             return false;
         return this->parseReply(result);
     }
@@ -364,14 +527,17 @@ namespace mg
                       "RedisConnection::HMSET() only support std::vector<std::string>");
         if (fields.size() != values.size())
             return false;
-        std::vector<std::string> _fields = {"HMSET", key};
-        int len = fields.size();
-        for (int i = 0; i < len; i++)
+        std::vector<RedisArg> args;
+        args.reserve(fields.size() * 2 + 2);
+        args.emplace_back("HMSET", 5);
+        args.emplace_back(key);
+        size_t len = fields.size();
+        for (size_t i = 0; i < len; i++)
         {
-            _fields.emplace_back(fields[i]);
-            _fields.emplace_back(values[i]);
+            args.emplace_back(fields[i]);
+            args.emplace_back(values[i]);
         }
-        return this->execByParams(_fields);
+        return this->execArgv(args);
     }
 
     template <typename T>
@@ -379,9 +545,7 @@ namespace mg
     {
         static_assert(std::is_same<typename std::remove_reference<T>::type, RedisResult>::value,
                       "RedisConnection::HINCRBY() only support RedisResult");
-        this->freeReply();
-        this->_reply = static_cast<redisReply *>(redisCommand(this->_context, "HINCRBY %s %s %lld",
-                                                              key.c_str(), field.c_str(), value));
+        this->execArgv({RedisArg("HINCRBY", 7), key, field, std::to_string(value)});
         return this->parseReply(std::forward<T>(result));
     }
 };
@@ -103,7 +103,8 @@ int mg::Socket::accept(InternetAddress *peer_address)
         }
     }
 
-    if (connnect_fd == -1)
+    // 非阻塞套接字取完连接时返回EAGAIN，不是错误
+    if (connnect_fd == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
         LOG_ERROR("[{}]: {}", this->socket_fd, strerror(errno));
 
     return connnect_fd;
@@ -0,0 +1,92 @@
+#ifndef __MG_STRING_VIEW_H__
+#define __MG_STRING_VIEW_H__
+
+#include <string>
+#include <ostream>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+namespace mg
+{
+    /**
+     * @brief 只引用外部数据的字符串视图，不拥有也不复制数据，数据中可以包含'\0'
+     *        使用者需要保证被引用的数据在视图使用期间有效
+     */
+    class StringView
+    {
+    public:
+        StringView() : _data(""), _size(0) {}
+
+        StringView(const char *data, size_t size) : _data(data), _size(size) {}
+
+        StringView(const char *str) : _data(str), _size(::strlen(str)) {}
+
+        StringView(const std::string &str) : _data(str.data()), _size(str.size()) {}
+
+        inline const char *data() const { return this->_data; }
+
+        inline size_t size() const { return this->_size; }
+
+        inline bool empty() const { return this->_size == 0; }
+
+        inline const char *begin() const { return this->_data; }
+
+        inline const char *end() const { return this->_data + this->_size; }
+
+        inline char operator[](size_t index) const { return this->_data[index]; }
+
+        /**
+         * @brief 需要保存数据时复制为std::string
+         */
+        inline std::string toString() const { return std::string(this->_data, this->_size); }
+
+        inline StringView substr(size_t pos, size_t len = std::string::npos) const
+        {
+            if (pos > this->_size)
+                pos = this->_size;
+            if (len > this->_size - pos)
+                len = this->_size - pos;
+            return StringView(this->_data + pos, len);
+        }
+
+        inline size_t find(char c, size_t pos = 0) const
+        {
+            if (pos >= this->_size)
+                return std::string::npos;
+            const void *found = ::memchr(this->_data + pos, c, this->_size - pos);
+            return found ? static_cast<const char *>(found) - this->_data : std::string::npos;
+        }
+
+        inline bool equalsIgnoreCase(const StringView &other) const
+        {
+            return this->_size == other._size && ::strncasecmp(this->_data, other._data, this->_size) == 0;
+        }
+
+        inline bool operator==(const StringView &other) const
+        {
+            return this->_size == other._size && ::memcmp(this->_data, other._data, this->_size) == 0;
+        }
+
+        inline bool operator!=(const StringView &other) const { return !(*this == other); }
+
+    private:
+        const char *_data;
+        size_t _size;
+    };
+
+    inline bool operator==(const std::string &left, const StringView &right) { return StringView(left) == right; }
+
+    inline bool operator==(const char *left, const StringView &right) { return StringView(left) == right; }
+
+    inline bool operator!=(const std::string &left, const StringView &right) { return StringView(left) != right; }
+
+    inline bool operator!=(const char *left, const StringView &right) { return StringView(left) != right; }
+
+    inline std::ostream &operator<<(std::ostream &os, const StringView &view)
+    {
+        return os.write(view.data(), view.size());
+    }
+};
+
+#endif //__MG_STRING_VIEW_H__
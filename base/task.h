@@ -0,0 +1,157 @@
+#ifndef __MG_TASK_H__
+#define __MG_TASK_H__
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mg
+{
+    /**
+     * @brief 只能移动的无参回调，捕获内容不超过_inlineSize字节时直接存放在对象内部，不申请堆内存
+     *        用于替代eventloop、定时器和线程池任务队列中的std::function<void()>
+     */
+    class Task
+    {
+    public:
+        static const size_t _inlineSize = 64; // 内部存储的大小
+
+        Task() noexcept : _ops(nullptr) {}
+
+        Task(std::nullptr_t) noexcept : _ops(nullptr) {}
+
+        template <typename Function,
+                  typename = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, Task>::value>::type>
+        Task(Function &&function) : _ops(nullptr)
+        {
+            using Type = typename std::decay<Function>::type;
+            using Manager = typename std::conditional<isInline<Type>(), InlineOps<Type>, HeapOps<Type>>::type;
+            Manager::create(&this->_storage, std::forward<Function>(function));
+            this->_ops = &Manager::ops;
+        }
+
+        Task(Task &&other) noexcept : _ops(nullptr)
+        {
+            this->moveFrom(other);
+        }
+
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                this->reset();
+                this->moveFrom(other);
+            }
+            return *this;
+        }
+
+        Task &operator=(std::nullptr_t) noexcept
+        {
+            this->reset();
+            return *this;
+        }
+
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task()
+        {
+            this->reset();
+        }
+
+        /**
+         * @brief 执行保存的回调，回调为空时抛出std::bad_function_call
+         */
+        void operator()() const
+        {
+            if (!this->_ops)
+                throw std::bad_function_call();
+            this->_ops->invoke(&this->_storage);
+        }
+
+        explicit operator bool() const noexcept { return this->_ops != nullptr; }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void *storage);
+            void (*move)(void *from, void *to); // 移动到to之后销毁from
+            void (*destroy)(void *storage);
+        };
+
+        using Storage = typename std::aligned_storage<_inlineSize, alignof(std::max_align_t)>::type;
+
+        template <typename Type>
+        static constexpr bool isInline()
+        {
+            return sizeof(Type) <= _inlineSize && alignof(Type) <= alignof(Storage) &&
+                   std::is_nothrow_move_constructible<Type>::value;
+        }
+
+        // 回调直接构造在_storage中
+        template <typename Type>
+        struct InlineOps
+        {
+            template <typename Function>
+            static void create(void *storage, Function &&function)
+            {
+                new (storage) Type(std::forward<Function>(function));
+            }
+            static void invoke(void *storage) { (*static_cast<Type *>(storage))(); }
+            static void move(void *from, void *to)
+            {
+                new (to) Type(std::move(*static_cast<Type *>(from)));
+                static_cast<Type *>(from)->~Type();
+            }
+            static void destroy(void *storage) { static_cast<Type *>(storage)->~Type(); }
+            static const Ops ops;
+        };
+
+        // 回调过大时放在堆上，_storage中只保存指针
+        template <typename Type>
+        struct HeapOps
+        {
+            template <typename Function>
+            static void create(void *storage, Function &&function)
+            {
+                *static_cast<Type **>(storage) = new Type(std::forward<Function>(function));
+            }
+            static void invoke(void *storage) { (**static_cast<Type **>(storage))(); }
+            static void move(void *from, void *to) { *static_cast<Type **>(to) = *static_cast<Type **>(from); }
+            static void destroy(void *storage) { delete *static_cast<Type **>(storage); }
+            static const Ops ops;
+        };
+
+        void moveFrom(Task &other) noexcept
+        {
+            if (other._ops)
+            {
+                other._ops->move(&other._storage, &this->_storage);
+                this->_ops = other._ops;
+                other._ops = nullptr;
+            }
+        }
+
+        void reset() noexcept
+        {
+            if (this->_ops)
+            {
+                this->_ops->destroy(&this->_storage);
+                this->_ops = nullptr;
+            }
+        }
+
+        mutable Storage _storage; // 回调对象或者指向回调对象的指针
+        const Ops *_ops;          // 操作_storage的函数表，为空表示没有回调
+    };
+
+    template <typename Type>
+    const Task::Ops Task::InlineOps<Type>::ops = {&Task::InlineOps<Type>::invoke, &Task::InlineOps<Type>::move, &Task::InlineOps<Type>::destroy};
+
+    template <typename Type>
+    const Task::Ops Task::HeapOps<Type>::ops = {&Task::HeapOps<Type>::invoke, &Task::HeapOps<Type>::move, &Task::HeapOps<Type>::destroy};
+};
+
+#endif //__MG_TASK_H__
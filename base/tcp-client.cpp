@@ -15,7 +15,7 @@ namespace mg
 
 mg::TcpClient::TcpClient(int domain, int type, EventLoop *loop, const InternetAddress &address, const std::string &name)
     : _loop(loop), _name(name), _connected(false), _connector(new Connector(domain, type, _loop, address)),
-      _isIpv6(address.isIpv6()), _connectionID(0), _retry(false)
+      _isIpv6(address.isIpv6()), _connectionID(0), _retry(false), _edgeTriggered(false)
 {
     _connector->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
 }
@@ -82,6 +82,11 @@ void mg::TcpClient::disableRetry()
     this->_retry = false;
 }
 
+void mg::TcpClient::setEdgeTriggered(bool on)
+{
+    this->_edgeTriggered = on;
+}
+
 void mg::TcpClient::setConnectionCallback(TcpConnectionCallback callback)
 {
     _connectionCallback = std::move(callback);
@@ -122,6 +127,7 @@ void mg::TcpClient::newConnection(int sockfd)
     connection->setMessageCallback(_messgageDataCallback);
     connection->setConnectionCallback(_connectionCallback);
     connection->setCloseCallback(std::bind(&TcpClient::removeConntction, this, std::placeholders::_1));
+    connection->setEdgeTriggered(this->_edgeTriggered);
     {
         std::lock_guard<std::mutex> guard(_mutex);
         this->_connection = connection;
@@ -43,6 +43,11 @@ namespace mg
          */
         void disableRetry();
 
+        /**
+         * @brief 连接是否使用边沿触发，默认为水平触发，需要在connect之前设置
+         */
+        void setEdgeTriggered(bool on);
+
         /**
          * @brief 设置新连接建立时的回调，传递过程：用户自定义函数->TcpClient->TcpConnection
          */
@@ -89,6 +94,7 @@ namespace mg
         bool _isIpv6;                     // 是否是IPV6地址
         int _connectionID;                // 标识每一条连接
         bool _retry;                      // 断开连接后是否重连
+        bool _edgeTriggered;              // 连接是否使用边沿触发
 
         /*-------以下是保存用户自定义的函数--------*/
         TcpConnectionCallback _connectionCallback;    // 新连接回调
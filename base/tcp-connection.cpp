@@ -2,21 +2,29 @@
 #include "event-loop.h"
 #include "log.h"
 
+#include <algorithm>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
 #define RECYCLE_INTERVAL 30
 const uint32_t maxBuffsize = 1024 * 1024 * 5;
+const int mg::TcpConnection::_edgeTriggeredBudget;
 
 mg::TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockfd,
                                  const InternetAddress &localAddress, const InternetAddress &peerAddress)
-    : _loop(loop), _name(name), _socket(new Socket(sockfd)), _channel(new Channel(loop, sockfd)),
-      _state(CONNECTING), _localAddress(localAddress), _peerAddress(peerAddress),
-      _userStat(0), _isReading(true), _maxReadBufferSize(maxBuffsize)
+    : _highWaterMark(64 * 1024 * 1024), _loop(loop), _name(name), _socket(new Socket(sockfd)),
+      _channel(new Channel(loop, sockfd)), _state(CONNECTING), _localAddress(localAddress),
+      _hasLocalAddress(localAddress.port() != 0), _peerAddress(peerAddress), _id(0), _userStat(0), _isReading(true), _maxReadBufferSize(maxBuffsize),
+      _idlePrev(nullptr), _idleNext(nullptr), _idleSecond(0), _idleLinked(false),
+      _loadCounted(false), _reportedPendingBytes(0)
 {
     this->_channel->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     this->_channel->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
     this->_channel->setErrorCallback(std::bind(&TcpConnection::handleError, this));
     this->_channel->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
     this->_socket->setKeepLive(true);
-    this->enableRecycleClear();
 }
 
 mg::TcpConnection::~TcpConnection()
@@ -25,6 +33,16 @@ mg::TcpConnection::~TcpConnection()
     assert(_state == DISCONNECTED);
 }
 
+const mg::InternetAddress &mg::TcpConnection::localAddress() const
+{
+    if (!this->_hasLocalAddress)
+    {
+        this->_localAddress = Socket::getLocalAddress(this->_socket->fd(), this->_peerAddress.isIpv6());
+        this->_hasLocalAddress = true;
+    }
+    return this->_localAddress;
+}
+
 void mg::TcpConnection::setConnectionCallback(TcpConnectionCallback callback)
 {
     this->_connectionCallback = std::move(callback);
@@ -56,6 +74,21 @@ void mg::TcpConnection::setMaxReadBufferSize(uint32_t size)
     this->_maxReadBufferSize = size;
 }
 
+void mg::TcpConnection::setIdleTimeoutList(std::shared_ptr<IdleTimeoutList> list)
+{
+    this->_idleList = std::move(list);
+}
+
+void mg::TcpConnection::setEdgeTriggered(bool on)
+{
+    this->_channel->setEdgeTriggered(on);
+}
+
+void mg::TcpConnection::setTcpNoDelay(bool on)
+{
+    this->_socket->setTcpNoDelay(on);
+}
+
 bool mg::TcpConnection::connected()
 {
     return this->_state == CONNECTED;
@@ -65,14 +98,15 @@ void mg::TcpConnection::shutdown()
 {
     if (_state == CONNECTED)
     {
-        this->setConnectionState(DISCONNECTED);
+        // 写队列还没有发送完时由handleWrite在发送完之后关闭写端
+        this->setConnectionState(DISCONNECTING);
         _loop->run(std::bind(&TcpConnection::shutDownInOwnerLoop, this));
     }
 }
 
 void mg::TcpConnection::forceClose()
 {
-    if (_state == CONNECTED || _state == CONNECTING)
+    if (_state == CONNECTED || _state == CONNECTING || _state == DISCONNECTING)
     {
         this->setConnectionState(DISCONNECTING);
         _loop->run(std::bind(&TcpConnection::forceCloseInOwnerloop, this, shared_from_this()));
@@ -90,24 +124,71 @@ void mg::TcpConnection::send(const std::string &data)
 }
 
 void mg::TcpConnection::send(Buffer &data)
+{
+    if (_state != CONNECTED)
+        return;
+    this->send(data.retrieveAllAsString());
+}
+
+void mg::TcpConnection::send(std::string &&data)
 {
     if (_state != CONNECTED)
         return;
     if (_loop->isInOwnerThread())
-        this->sendInOwnerLoop(data.retrieveAllAsString());
+        this->sendInOwnerLoop(std::move(data));
     else
     {
-        std::string buffer = data.retrieveAllAsString();
-        _loop->run(std::bind((void (TcpConnection::*)(const std::string &))(&TcpConnection::sendInOwnerLoop), this, buffer));
+        // 回调只执行一次，执行时把绑定的数据移入写流程
+        _loop->run(std::bind([this](std::string &data)
+                             { this->sendInOwnerLoop(std::move(data)); },
+                             std::move(data)));
     }
 }
 
+void mg::TcpConnection::send(Buffer &&data)
+{
+    if (_state != CONNECTED)
+        return;
+    if (_loop->isInOwnerThread())
+        this->sendInOwnerLoop(std::move(data));
+    else
+    {
+        _loop->run(std::bind([this](Buffer &data)
+                             { this->sendInOwnerLoop(std::move(data)); },
+                             std::move(data)));
+    }
+}
+
+void mg::TcpConnection::send(const SharedBuffer &data)
+{
+    if (_state != CONNECTED)
+        return;
+    if (_loop->isInOwnerThread())
+        this->sendInOwnerLoop(data);
+    else
+        _loop->run(std::bind((void (TcpConnection::*)(const SharedBuffer &))(&TcpConnection::sendInOwnerLoop), this, data));
+}
+
+void mg::TcpConnection::sendFile(const SharedFile &file, off_t offset, size_t len)
+{
+    if (_state != CONNECTED)
+        return;
+    if (_loop->isInOwnerThread())
+        this->sendInOwnerLoop(nullptr, 0, file, offset, len);
+    else
+        _loop->run(std::bind((void (TcpConnection::*)(const void *, int, const SharedFile &, off_t, size_t))(&TcpConnection::sendInOwnerLoop),
+                             this, nullptr, 0, file, offset, len));
+}
+
 void mg::TcpConnection::connectionEstablished()
 {
     // 这一部分是内置函数，需要将连接加入sub-eventloop中进行注册
     this->setConnectionState(CONNECTED);
     this->_channel->tie(shared_from_this());
     this->_channel->enableReading();
+    if (this->_idleList)
+        this->_idleList->add(this);
+    this->addLoopLoad();
 
     // 执行用户自定义的连接建立时的回调
     if (this->_connectionCallback)
@@ -118,13 +199,16 @@ void mg::TcpConnection::connectionDestoryed()
 {
     LOG_TRACE("{} destroyed", this->_name);
     assert(_loop->isInOwnerThread());
-    if (this->_state == CONNECTED)
+    if (this->_state == CONNECTED || this->_state == DISCONNECTING)
     {
         this->setConnectionState(DISCONNECTED);
         this->_channel->disableAllEvents();
         if (this->_connectionCallback)
             this->_connectionCallback(shared_from_this());
     }
+    if (this->_idleList)
+        this->_idleList->remove(this);
+    this->removeLoopLoad();
     this->_channel->remove();
 }
 
@@ -138,23 +222,25 @@ int mg::TcpConnection::getUserConnectionState()
     return this->_userStat;
 }
 
-mg::TimerId mg::TcpConnection::runAt(TimeStamp time, std::function<void()> callback)
+mg::TimerId mg::TcpConnection::runAt(TimeStamp time, Task callback)
 {
     mg::TimerId id = this->_loop->runAt(time, std::move(callback));
+    this->recycleOnGrowth();
     this->_timerIds.emplace_back(std::move(id), id._timer->expiration());
     LOG_DEBUG("{} runAt new TimerId {}", this->name(), id._sequence);
     return this->_timerIds.back().first;
 }
 
-mg::TimerId mg::TcpConnection::runAfter(double delay, std::function<void()> callback)
+mg::TimerId mg::TcpConnection::runAfter(double delay, Task callback)
 {
     mg::TimerId id = this->_loop->runAfter(delay, std::move(callback));
+    this->recycleOnGrowth();
     this->_timerIds.emplace_back(std::move(id), id._timer->expiration());
     LOG_DEBUG("{} runAfter new TimerId {}", this->name(), id._sequence);
     return this->_timerIds.back().first;
 }
 
-mg::TimerId mg::TcpConnection::runEvery(double interval, std::function<void()> callback)
+mg::TimerId mg::TcpConnection::runEvery(double interval, Task callback)
 {
     mg::TimerId id = this->_loop->runEvery(interval, std::move(callback));
     this->_timerIds.emplace_back(std::move(id), mg::TimeStamp());
@@ -187,6 +273,15 @@ void mg::TcpConnection::stopReadInLoop()
     }
 }
 
+void mg::TcpConnection::resumeReadIfDrained()
+{
+    // 连接已经关闭时不能重新注册读事件
+    if (this->_state == DISCONNECTED)
+        return;
+    if (this->_isReading && !this->_channel->isReading() && (this->_readBuffer.readableBytes() < this->_maxReadBufferSize))
+        this->_channel->enableReading();
+}
+
 void mg::TcpConnection::setConnectionState(State state)
 {
     this->_state = state;
@@ -194,25 +289,54 @@ void mg::TcpConnection::setConnectionState(State state)
 
 void mg::TcpConnection::handleRead(TimeStamp time)
 {
-    int saveErrno = 0;
-    int len = this->_readBuffer.receive(this->_channel->fd(), saveErrno);
-    if (len > 0)
+    const bool edgeTriggered = this->_channel->isEdgeTriggered();
+    const int times = edgeTriggered ? _edgeTriggeredBudget : 1;
+    for (int i = 0; i < times; i++)
     {
-        if (this->_channel->isReading() && (this->_readBuffer.readableBytes() > this->_maxReadBufferSize))
-            this->stopReadInLoop();
-
-        this->onRead(time);
-
-        if (!this->_channel->isReading() && (this->_readBuffer.readableBytes() < this->_maxReadBufferSize))
-            this->startReadInLoop();
+        int saveErrno = 0;
+        int len = this->_readBuffer.receive(this->_channel->fd(), saveErrno);
+        if (len > 0)
+        {
+            if (this->_idleList)
+                this->_idleList->touch(this);
+            // 缓冲区过大时暂时停止读，不改变_isReading，使用者调用stopReadInLoop停止的读不会被这里恢复
+            if (this->_channel->isReading() && (this->_readBuffer.readableBytes() > this->_maxReadBufferSize))
+                this->_channel->disableReading();
+
+            this->onRead(time);
+            // 数据处理完之后归还读缓冲区的内存，空闲连接不占用缓冲区
+            this->_readBuffer.shrink();
+
+            this->resumeReadIfDrained();
+            // 停止读或者连接在回调中被关闭
+            if (!this->_channel->isReading())
+                return;
+        }
+        else if (len == 0)
+        {
+            this->handleClose();
+            return;
+        }
+        else if (edgeTriggered && (saveErrno == EAGAIN || saveErrno == EWOULDBLOCK))
+            return;
+        else
+        {
+            errno = saveErrno;
+            LOG_ERROR("{} {}", this->_name, ::strerror(errno));
+            this->handleError();
+            return;
+        }
     }
-    else if (len == 0)
-        this->handleClose();
-    else
+
+    // 边沿触发时数据可能还没有读完，不会再有新的通知，等本轮其他连接处理完之后继续读
+    if (edgeTriggered)
     {
-        errno = saveErrno;
-        LOG_ERROR("{} {}", this->_name, ::strerror(errno));
-        this->handleError();
+        TcpConnectionPointer self(shared_from_this());
+        this->_loop->push([self, time]()
+                          {
+                              if (self->_channel->isReading())
+                                  self->handleRead(time); //
+                          });
     }
 }
 
@@ -221,6 +345,9 @@ void mg::TcpConnection::handleClose()
     this->setConnectionState(DISCONNECTED);
     this->_channel->disableAllEvents();
     this->clearTimer();
+    if (this->_idleList)
+        this->_idleList->remove(this);
+    this->removeLoopLoad();
     TcpConnectionPointer temp(shared_from_this());
     if (this->_connectionCallback)
         this->_connectionCallback(temp);
@@ -245,14 +372,25 @@ void mg::TcpConnection::handleError()
 
 void mg::TcpConnection::handleWrite()
 {
-    if (this->_channel->isWriting())
+    if (!this->_channel->isWriting())
+    {
+        LOG_ERROR("{} don't need to send", this->_name);
+        return;
+    }
+
+    const bool edgeTriggered = this->_channel->isEdgeTriggered();
+    const int times = edgeTriggered ? _edgeTriggeredBudget : 1;
+    for (int i = 0; i < times; i++)
     {
         int saveError = 0;
-        int len = _sendBuffer.send(_channel->fd(), saveError);
+        ssize_t len = _outputQueue.send(_channel->fd(), saveError);
         if (len > 0)
         {
-            _sendBuffer.retrieve(len);
-            if (_sendBuffer.readableBytes() == 0)
+            if (this->_idleList)
+                this->_idleList->touch(this);
+            _outputQueue.retrieve(len);
+            this->updatePendingBytes();
+            if (_outputQueue.empty())
             {
                 _channel->disableWriting(); // 取消写事件
 
@@ -260,13 +398,31 @@ void mg::TcpConnection::handleWrite()
 
                 if (_state == DISCONNECTING)
                     this->shutDownInOwnerLoop();
+                return;
             }
         }
         else
-            LOG_ERROR("{} {}", this->_name, ::strerror(saveError));
+        {
+            if (saveError != EAGAIN && saveError != EWOULDBLOCK && saveError != EINTR)
+            {
+                // 写队列已经无法发送完，例如对端重置了连接或者正在发送的文件被截断，关闭连接避免一直触发可写事件
+                LOG_ERROR("{} {}", this->_name, ::strerror(saveError));
+                this->handleClose();
+            }
+            return;
+        }
+    }
+
+    // 边沿触发时写队列还没有写完并且套接字仍然可写，不会再有新的通知，等本轮其他连接处理完之后继续写
+    if (edgeTriggered)
+    {
+        TcpConnectionPointer self(shared_from_this());
+        this->_loop->push([self]()
+                          {
+                              if (self->_channel->isWriting())
+                                  self->handleWrite(); //
+                          });
     }
-    else
-        LOG_ERROR("{} don't need to send", this->_name);
 }
 
 void mg::TcpConnection::shutDownInOwnerLoop()
@@ -277,22 +433,250 @@ void mg::TcpConnection::shutDownInOwnerLoop()
 
 void mg::TcpConnection::sendInOwnerLoop(const void *data, int len)
 {
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    bool hasError = false;
+    int hasWrite = this->writeInOwnerLoop(data, len, hasError);
+    if (!hasError && hasWrite < len)
+    {
+        this->prepareQueueInOwnerLoop(len - hasWrite);
+        _outputQueue.append(static_cast<const char *>(data) + hasWrite, len - hasWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const std::string &data)
+{
+    this->sendInOwnerLoop(data.data(), data.size());
+}
+
+void mg::TcpConnection::sendInOwnerLoop(std::string &&data)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
     bool hasError = false;
-    int remain = len, hasWrite = 0;
+    int len = data.size();
+    int hasWrite = this->writeInOwnerLoop(data.data(), len, hasError);
+    if (!hasError && hasWrite < len)
+    {
+        this->prepareQueueInOwnerLoop(len - hasWrite);
+        _outputQueue.append(std::move(data), hasWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const SharedBuffer &data)
+{
     if (_state == DISCONNECTED)
     {
-        LOG_ERROR("[{}] disconnected");
+        LOG_ERROR("[{}] disconnected", this->_name);
         return;
     }
+    if (!data)
+        return;
+
+    bool hasError = false;
+    int len = data->size();
+    int hasWrite = this->writeInOwnerLoop(data->data(), len, hasError);
+    if (!hasError && hasWrite < len)
+    {
+        this->prepareQueueInOwnerLoop(len - hasWrite);
+        _outputQueue.append(data, hasWrite);
+        this->updatePendingBytes();
+    }
+}
 
-    // 没有注册可写事件并且发送缓冲区为空
-    if (!_channel->isWriting() && _sendBuffer.readableBytes() == 0)
+void mg::TcpConnection::sendInOwnerLoop(Buffer &&data)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    bool hasError = false;
+    int len = data.readableBytes();
+    int hasWrite = this->writeInOwnerLoop(data.readPeek(), len, hasError);
+    if (!hasError && hasWrite < len)
+    {
+        this->prepareQueueInOwnerLoop(len - hasWrite);
+        _outputQueue.append(std::move(data), hasWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const void *head, int headLen, std::string &&body)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    bool hasError = false;
+    int bodyLen = body.size();
+    int hasWrite = this->writeInOwnerLoop(head, headLen, body.data(), bodyLen, hasError);
+    int bodyWrite = this->queueHeadInOwnerLoop(head, headLen, bodyLen, hasWrite, hasError);
+    if (bodyWrite >= 0)
+    {
+        if (bodyWrite < bodyLen)
+            _outputQueue.append(std::move(body), bodyWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const void *head, int headLen, const SharedBuffer &body)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    bool hasError = false;
+    int bodyLen = body ? body->size() : 0;
+    int hasWrite = this->writeInOwnerLoop(head, headLen, body ? body->data() : nullptr, bodyLen, hasError);
+    int bodyWrite = this->queueHeadInOwnerLoop(head, headLen, bodyLen, hasWrite, hasError);
+    if (bodyWrite >= 0)
+    {
+        if (bodyWrite < bodyLen)
+            _outputQueue.append(body, bodyWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const void *head, int headLen, const void *body, int bodyLen)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    bool hasError = false;
+    int hasWrite = this->writeInOwnerLoop(head, headLen, body, bodyLen, hasError);
+    int bodyWrite = this->queueHeadInOwnerLoop(head, headLen, bodyLen, hasWrite, hasError);
+    if (bodyWrite >= 0)
+    {
+        if (bodyWrite < bodyLen)
+            _outputQueue.append(static_cast<const char *>(body) + bodyWrite, bodyLen - bodyWrite);
+        this->updatePendingBytes();
+    }
+}
+
+void mg::TcpConnection::sendInOwnerLoop(const void *head, int headLen, const SharedFile &file, off_t offset, size_t len)
+{
+    if (_state == DISCONNECTED)
+    {
+        LOG_ERROR("[{}] disconnected", this->_name);
+        return;
+    }
+
+    int hasWrite = 0;
+    size_t fileWrite = 0;
+    // 没有注册可写事件并且发送队列为空
+    if (!_channel->isWriting() && _outputQueue.empty())
+    {
+        if (headLen > 0)
+        {
+            hasWrite = ::send(_channel->fd(), head, headLen, len ? MSG_MORE : 0);
+            if (hasWrite < 0)
+            {
+                hasWrite = 0;
+                if (errno == EPIPE || errno == ECONNRESET)
+                {
+                    LOG_ERROR("{} Error: {}", this->_name, ::strerror(errno));
+                    return;
+                }
+            }
+        }
+        if (hasWrite == headLen && len)
+        {
+            off_t position = offset;
+            ssize_t n = ::sendfile(_channel->fd(), file->fd(), &position, len);
+            if (n > 0)
+                fileWrite = n;
+            else if (n < 0 && (errno == EPIPE || errno == ECONNRESET))
+            {
+                LOG_ERROR("{} Error: {}", this->_name, ::strerror(errno));
+                return;
+            }
+        }
+        if (hasWrite == headLen && fileWrite == len)
+        {
+            this->onWriteComplete();
+            return;
+        }
+    }
+
+    this->prepareQueueInOwnerLoop(headLen - hasWrite + len - fileWrite);
+    if (hasWrite < headLen)
+        _outputQueue.append(static_cast<const char *>(head) + hasWrite, headLen - hasWrite);
+    _outputQueue.append(file, offset + fileWrite, len - fileWrite);
+    this->updatePendingBytes();
+}
+
+int mg::TcpConnection::writeInOwnerLoop(const void *head, int headLen, const void *body, int bodyLen, bool &hasError)
+{
+    int hasWrite = 0;
+    // 没有注册可写事件并且发送队列为空
+    if (!_channel->isWriting() && _outputQueue.empty())
+    {
+        struct iovec vec[2];
+        vec[0].iov_base = const_cast<void *>(head);
+        vec[0].iov_len = headLen;
+        vec[1].iov_base = const_cast<void *>(body);
+        vec[1].iov_len = bodyLen;
+        hasWrite = ::writev(_channel->fd(), vec, bodyLen > 0 ? 2 : 1);
+        if (hasWrite >= 0)
+        {
+            if (hasWrite == headLen + bodyLen)
+                this->onWriteComplete();
+        }
+        else
+        {
+            hasWrite = 0;
+            if ((errno != EWOULDBLOCK) && (errno == EPIPE || errno == ECONNRESET))
+            {
+                hasError = true;
+                LOG_ERROR("{} Error: {}", this->_name, ::strerror(errno));
+            }
+        }
+    }
+    return hasWrite;
+}
+
+int mg::TcpConnection::queueHeadInOwnerLoop(const void *head, int headLen, int bodyLen, int hasWrite, bool hasError)
+{
+    if (hasError || hasWrite >= headLen + bodyLen)
+        return -1;
+    this->prepareQueueInOwnerLoop(headLen + bodyLen - hasWrite);
+    if (hasWrite < headLen)
+    {
+        _outputQueue.append(static_cast<const char *>(head) + hasWrite, headLen - hasWrite);
+        return 0;
+    }
+    return hasWrite - headLen;
+}
+
+int mg::TcpConnection::writeInOwnerLoop(const void *data, int len, bool &hasError)
+{
+    int hasWrite = 0;
+    // 没有注册可写事件并且发送队列为空
+    if (!_channel->isWriting() && _outputQueue.empty())
     {
         hasWrite = ::write(_channel->fd(), data, len);
         if (hasWrite >= 0)
         {
-            remain = len - hasWrite;
-            if (remain == 0)
+            if (hasWrite == len)
                 this->onWriteComplete();
         }
         else
@@ -305,30 +689,62 @@ void mg::TcpConnection::sendInOwnerLoop(const void *data, int len)
             }
         }
     }
+    return hasWrite;
+}
 
+void mg::TcpConnection::prepareQueueInOwnerLoop(size_t remain)
+{
     /**
-     * 说明当前这一次write并没有把数据全部发送出去 剩余的数据需要保存到缓冲区当中
+     * 说明当前这一次write并没有把数据全部发送出去 剩余的数据需要保存到发送队列当中
      * 然后给channel注册EPOLLOUT事件，Poller发现tcp的发送缓冲区有空间后会通知
      * 相应的sock->channel，调用channel对应注册的writeCallback_回调方法，
      * channel的writeCallback_实际上就是TcpConnection设置的handleWrite回调，
-     * 把发送缓冲区outputBuffer_的内容全部发送完成
+     * 发送队列中的数据块由writev批量发送
      **/
-    if (!hasError && remain)
-    {
-        int last = _sendBuffer.readableBytes();
+    size_t last = _outputQueue.readableBytes();
+    size_t highWaterMark = _highWaterMark;
 
-        if (last + remain >= _highWaterMark && last < _highWaterMark && _highWaterCallback)
-            _loop->push(std::bind(_highWaterCallback, shared_from_this(), last + remain));
+    if (last + remain >= highWaterMark && last < highWaterMark && _highWaterCallback)
+        _loop->push(std::bind(_highWaterCallback, shared_from_this(), static_cast<int>(std::min<size_t>(last + remain, INT_MAX))));
 
-        _sendBuffer.append((char *)data + hasWrite, remain);
-        if (!_channel->isWriting())
-            _channel->enableWriting();
-    }
+    if (!_channel->isWriting())
+        _channel->enableWriting();
 }
 
-void mg::TcpConnection::sendInOwnerLoop(const std::string &data)
+void mg::TcpConnection::reserveLoopLoad()
 {
-    this->sendInOwnerLoop(data.data(), data.size());
+    if (this->_loadCounted)
+        return;
+    this->_loadCounted = true;
+    this->_loop->addConnectionCount(1);
+}
+
+void mg::TcpConnection::addLoopLoad()
+{
+    this->reserveLoopLoad();
+    this->updatePendingBytes();
+}
+
+void mg::TcpConnection::removeLoopLoad()
+{
+    if (!this->_loadCounted)
+        return;
+    this->_loop->addConnectionCount(-1);
+    this->_loop->addPendingBytes(-static_cast<long>(this->_reportedPendingBytes));
+    this->_reportedPendingBytes = 0;
+    this->_loadCounted = false;
+}
+
+void mg::TcpConnection::updatePendingBytes()
+{
+    if (!this->_loadCounted)
+        return;
+    size_t bytes = this->_outputQueue.readableBytes();
+    if (bytes != this->_reportedPendingBytes)
+    {
+        this->_loop->addPendingBytes(static_cast<long>(bytes) - static_cast<long>(this->_reportedPendingBytes));
+        this->_reportedPendingBytes = bytes;
+    }
 }
 
 void mg::TcpConnection::forceCloseInOwnerloop(TcpConnectionPointer con)
@@ -347,18 +763,19 @@ void mg::TcpConnection::clearTimer()
 
 void mg::TcpConnection::recycleClear()
 {
-    int len = _timerIds.size() - 1;
-    mg::TimeStamp zero, now = mg::TimeStamp::now();
-    std::vector<int> memo;
-    for (int i = 0; i <= len; i++)
-    {
-        if (!this->_timerIds[i].second.getMircoSecond() || now < this->_timerIds[i].second)
-            continue;
-        memo.push_back(i);
-    }
-    for (int i = 0; i < memo.size(); i++, len--)
-        std::swap(this->_timerIds[len], this->_timerIds[memo[i]]);
-    this->_timerIds.resize(len + 1);
+    mg::TimeStamp now = mg::TimeStamp::now();
+    auto end = std::remove_if(this->_timerIds.begin(), this->_timerIds.end(),
+                              [&now](const std::pair<mg::TimerId, mg::TimeStamp> &x)
+                              { return x.second.getMircoSecond() && !(now < x.second); });
+    this->_timerIds.erase(end, this->_timerIds.end());
+}
+
+void mg::TcpConnection::recycleOnGrowth()
+{
+    // 定时器数量每增长到2的幂时回收一次，均摊下来每次添加是O(1)
+    size_t size = this->_timerIds.size();
+    if (size >= 16 && !(size & (size - 1)))
+        this->recycleClear();
 }
 
 void mg::TcpConnection::onRead(TimeStamp time)
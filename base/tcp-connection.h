@@ -7,10 +7,14 @@
 #include "function-callbacks.h"
 #include "noncopyable.h"
 #include "buffer.h"
+#include "output-queue.h"
 #include "timer-id.h"
+#include "task.h"
+#include "idle-timeout-list.h"
 
 #include <memory>
 #include <atomic>
+#include <vector>
 
 namespace mg
 {
@@ -18,6 +22,9 @@ namespace mg
     class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
     {
     public:
+        /**
+         * @param localAddress 本端地址，端口为0时在第一次调用localAddress()时才获取
+         */
         TcpConnection(EventLoop *loop, const std::string &name, int sockfd,
                       const InternetAddress &localAddress, const InternetAddress &peerAddress);
 
@@ -27,10 +34,20 @@ namespace mg
 
         inline EventLoop *getLoop() { return this->_loop; }
 
-        inline const InternetAddress &localAddress() const { return this->_localAddress; }
+        /**
+         * @brief 本端地址，构造时没有传入时第一次调用才通过getsockname获取，只能在所属eventloop线程中调用
+         */
+        const InternetAddress &localAddress() const;
 
         inline const InternetAddress &peerAddress() const { return this->_peerAddress; }
 
+        /**
+         * @brief 连接的编号，TcpServer用它管理所有连接
+         */
+        inline uint64_t id() const { return this->_id; }
+
+        inline void setId(uint64_t id) { this->_id = id; }
+
         void setConnectionCallback(TcpConnectionCallback callback);
 
         void setMessageCallback(MessageDataCallback callback);
@@ -43,6 +60,27 @@ namespace mg
 
         void setMaxReadBufferSize(uint32_t size);
 
+        /**
+         * @brief 设置所属eventloop的空闲连接链表，需要在连接建立之前设置
+         */
+        void setIdleTimeoutList(std::shared_ptr<IdleTimeoutList> list);
+
+        /**
+         * @brief 设置是否使用边沿触发，需要在连接建立之前设置
+         *        边沿触发时每次事件一直读写到EAGAIN，超过_edgeTriggeredBudget次后让出eventloop，稍后继续
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * @brief 选定loop之后立即计入该loop的连接数，连接建立之前的下一次选择就能看到，需要在连接建立之前调用
+         */
+        void reserveLoopLoad();
+
+        /**
+         * @brief 关闭Nagle算法，多个小的应答连续写出时不必等待对端的ACK
+         */
+        void setTcpNoDelay(bool on);
+
         bool connected();
 
         void shutdown();
@@ -56,6 +94,27 @@ namespace mg
         void send(const std::string &data);
         void send(Buffer &data);
 
+        /**
+         * @brief 发送数据并接管数据的所有权，跨线程调用时数据只移动不拷贝
+         * @param data 待发送的数据，调用后不再可用
+         */
+        void send(std::string &&data);
+        void send(Buffer &&data);
+
+        /**
+         * @brief 发送共享数据块，数据只增加引用计数不会被拷贝，适合同一份数据发往多个连接
+         * @param data 待发送的数据
+         */
+        void send(const SharedBuffer &data);
+
+        /**
+         * @brief 发送文件的一个区间，轮到时用sendfile从页缓存直接写入套接口，发送完之前文件保持打开
+         * @param file 打开的文件
+         * @param offset 区间在文件中的起始位置
+         * @param len 区间长度
+         */
+        void sendFile(const SharedFile &file, off_t offset, size_t len);
+
         /**
          * @brief TcpServer接受到新连接需要处理的逻辑，这里放在TcpConnection类中，
          *        因为一个连接的建立与销毁的操作只与该链接有关
@@ -80,22 +139,22 @@ namespace mg
          * @param time 给定时间
          * @param callback 待执行回调
          */
-        TimerId runAt(TimeStamp time, std::function<void()> callback);
+        TimerId runAt(TimeStamp time, Task callback);
 
         /**
          * @brief 给定延迟time秒后执行回调
          * @param time 延迟秒数
          */
-        TimerId runAfter(double delay, std::function<void()> callback);
+        TimerId runAfter(double delay, Task callback);
 
         /**
          * @brief 每delay延迟执行一次
          * @param interval 循环执行时间
          */
-        TimerId runEvery(double interval, std::function<void()> callback);
+        TimerId runEvery(double interval, Task callback);
 
         /**
-         * @brief 定时回收无效定时器
+         * @brief 定时回收无效定时器，默认在添加定时器时按需回收，不再需要单独的定时器
          */
         void enableRecycleClear();
 
@@ -107,6 +166,7 @@ namespace mg
 
         friend class TcpPacketParser;
         friend class HttpPacketParser;
+        friend class IdleTimeoutList;
 
     protected:
         enum State
@@ -124,6 +184,12 @@ namespace mg
          */
         void handleRead(TimeStamp time);
 
+        /**
+         * @brief 读缓冲区降到上限以下时恢复因为缓冲区过大而暂停的读，使用者调用stopReadInLoop停止的读不恢复
+         *        在handleRead之外取走缓冲区数据之后也要调用，否则暂停的读不会再恢复
+         */
+        void resumeReadIfDrained();
+
         /**
          * @brief 套接口连接关闭事件
          */
@@ -151,6 +217,53 @@ namespace mg
          */
         void sendInOwnerLoop(const void *data, int len);
         void sendInOwnerLoop(const std::string &data);
+        void sendInOwnerLoop(std::string &&data);
+        void sendInOwnerLoop(const SharedBuffer &data);
+        void sendInOwnerLoop(Buffer &&data);
+
+        /**
+         * @brief 在所属loop中用一次writev发送头部和数据体，例如http应答的头部和内容
+         *        没有发送完的头部拷贝进写队列，数据体按照自己的类型移动、引用或者拷贝进写队列
+         * @param head 头部数据，调用返回后可以复用
+         * @param headLen 头部长度
+         * @param body 数据体
+         */
+        void sendInOwnerLoop(const void *head, int headLen, std::string &&body);
+        void sendInOwnerLoop(const void *head, int headLen, const SharedBuffer &body);
+        void sendInOwnerLoop(const void *head, int headLen, const void *body, int bodyLen);
+
+        /**
+         * @brief 在所属loop中发送头部和文件的一个区间，头部带MSG_MORE写出，与文件开头的数据合并成一个报文
+         */
+        void sendInOwnerLoop(const void *head, int headLen, const SharedFile &file, off_t offset, size_t len);
+
+        /**
+         * @brief 发送队列为空时用writev直接写出头部和数据体
+         * @param hasError 发生不可恢复的错误时置为true
+         * @return 已经写出的字节数
+         */
+        int writeInOwnerLoop(const void *head, int headLen, const void *body, int bodyLen, bool &hasError);
+
+        /**
+         * @brief 两段数据没有写完时，剩余的头部拷贝进写队列
+         * @return 数据体已经写出的字节数，由调用者把剩余的数据体放入写队列，没有剩余数据或者出错时返回-1
+         */
+        int queueHeadInOwnerLoop(const void *head, int headLen, int bodyLen, int hasWrite, bool hasError);
+
+        /**
+         * @brief 发送队列为空时直接写套接口
+         * @param data 待发送的数据
+         * @param len 待发送数据的长度
+         * @param hasError 发生不可恢复的错误时置为true
+         * @return 已经写出的字节数
+         */
+        int writeInOwnerLoop(const void *data, int len, bool &hasError);
+
+        /**
+         * @brief 剩余数据入队前检查是否越过高水位，并注册可写事件
+         * @param remain 即将入队的字节数
+         */
+        void prepareQueueInOwnerLoop(size_t remain);
 
         /**
          * @brief 在所属线程中强制关闭连接
@@ -167,6 +280,26 @@ namespace mg
          */
         void recycleClear();
 
+        /**
+         * @brief 定时器集合增长到一定数量时清除无效定时器
+         */
+        void recycleOnGrowth();
+
+        /**
+         * @brief 连接计入所属loop的负载，连接建立时调用，已经预先计入连接数时只同步待发送字节数
+         */
+        void addLoopLoad();
+
+        /**
+         * @brief 从所属loop的负载中扣除连接和未发送的字节数，可以重复调用
+         */
+        void removeLoopLoad();
+
+        /**
+         * @brief 写队列长度变化后同步到所属loop的待发送字节数
+         */
+        void updatePendingBytes();
+
         /**
          * @brief 自定义的拆包逻辑
          */
@@ -183,19 +316,29 @@ namespace mg
         std::unique_ptr<Socket> _socket;                              // 使用的套接口
         std::unique_ptr<Channel> _channel;                            // 管理套口事件的Channel类
         std::atomic<State> _state;                                    // 连接状态
-        const InternetAddress _localAddress;                          // 本端IP地址
+        mutable InternetAddress _localAddress;                        // 本端IP地址
+        mutable bool _hasLocalAddress;                                // 是否已经获取了本端地址
         const InternetAddress _peerAddress;                           // 对端IP地址
+        uint64_t _id;                                                 // 连接编号
         TcpConnectionCallback _connectionCallback;                    // 连接建立或者断开时的回调
         MessageDataCallback _messageCallback;                         // 有读写消息时的回调
         WriteCompleteCallback _writeCompleteCallback;                 // 消息发送完毕时的回调
         ConnectionClosedCallback _closeCallback;                      // 连接关闭时的回调
         HighWaterMarkCallback _highWaterCallback;                     // 写缓冲区数据过多执行的回调
-        Buffer _sendBuffer;                                           // 写缓冲区
+        OutputQueue _outputQueue;                                     // 写队列
         Buffer _readBuffer;                                           // 读缓冲区
         std::atomic_int _userStat;                                    // 用户自定义的Tcp连接状态
         std::vector<std::pair<mg::TimerId, mg::TimeStamp>> _timerIds; // 所有定时器集合
         bool _isReading;                                              // 是否监听读事件
         uint32_t _maxReadBufferSize;                                  // 缓冲区最大长度
+        std::shared_ptr<IdleTimeoutList> _idleList;                   // 所属eventloop的空闲连接链表
+        TcpConnection *_idlePrev;                                     // 空闲连接链表中的前一个连接
+        TcpConnection *_idleNext;                                     // 空闲连接链表中的后一个连接
+        int64_t _idleSecond;                                          // 最近活跃的秒数
+        bool _idleLinked;                                             // 是否在空闲连接链表中
+        bool _loadCounted;                                            // 是否已经计入所属loop的负载
+        size_t _reportedPendingBytes;                                 // 已经计入所属loop的待发送字节数
+        static const int _edgeTriggeredBudget = 16;                   // 边沿触发时每次事件最多读写的次数，避免一个连接占满eventloop
     };
 };
 
@@ -1,19 +1,35 @@
 #include "tcp-server.h"
 #include "log.h"
 
+#include <future>
+
 mg::TcpServer::TcpServer(EventLoop *loop, const InternetAddress &listenAddress, const std::string &name, int domain, int type)
     : _isStarted(false), _name(name), _loop(loop),
-      _acceptor(new Acceptor(domain, type, loop, listenAddress, true)),
       _connectionID(0),
       _threadInitialCallback(), _threadPool(new EventLoopThreadPool(loop, name)),
-      _address(listenAddress)
+      _address(listenAddress), _idleTimeout(0), _edgeTriggered(false),
+      _domain(domain), _type(type), _reusePort(false)
 
 {
-    this->_acceptor->setNewConnectionCallBack(std::bind(&TcpServer::acceptorCallback, this, std::placeholders::_1, std::placeholders::_2));
+    ;
 }
 
 mg::TcpServer::~TcpServer()
 {
+    // acceptor的channel属于sub-loop，需要在所属线程中析构，等待析构完成后才能释放this
+    for (auto &acceptor : this->_loopAcceptors)
+    {
+        EventLoop *loop = acceptor->getLoop();
+        std::promise<void> done;
+        loop->run([&acceptor, &done]()
+                  {
+                      acceptor.reset();
+                      done.set_value(); //
+                  });
+        done.get_future().wait();
+    }
+
+    std::lock_guard<std::mutex> guard(this->_mutex);
     for (auto &x : _connectionMemo)
     {
         TcpConnectionPointer connection(x.second);
@@ -38,9 +54,57 @@ void mg::TcpServer::start()
         return;
     this->_isStarted = true;
     _threadPool->start(_threadInitialCallback);
+    if (this->_idleTimeout > 0)
+    {
+        for (auto loop : _threadPool->getAllEventLoops())
+        {
+            std::shared_ptr<IdleTimeoutList> list = std::make_shared<IdleTimeoutList>(loop, this->_idleTimeout);
+            loop->run(std::bind(&IdleTimeoutList::start, list));
+            this->_idleLists[loop] = std::move(list);
+        }
+    }
+    if (this->_reusePort)
+    {
+        for (auto loop : _threadPool->getAllEventLoops())
+        {
+            std::unique_ptr<Acceptor> acceptor(new Acceptor(this->_domain, this->_type, loop, this->_address, true));
+            acceptor->setNewConnectionCallBack(std::bind(&TcpServer::newConnection, this, loop, std::placeholders::_1, std::placeholders::_2));
+            loop->run(std::bind(&Acceptor::listen, acceptor.get()));
+            this->_loopAcceptors.push_back(std::move(acceptor));
+        }
+        return;
+    }
+    // 只有一个监听套接字时不设置SO_REUSEPORT，端口已经被其他进程占用时bind失败，而不是与其分摊连接
+    this->_acceptor.reset(new Acceptor(this->_domain, this->_type, _loop, this->_address, false));
+    this->_acceptor->setNewConnectionCallBack(std::bind(&TcpServer::acceptorCallback, this, std::placeholders::_1, std::placeholders::_2));
     _loop->run(std::bind(&Acceptor::listen, this->_acceptor.get()));
 }
 
+void mg::TcpServer::setReusePort(bool on)
+{
+    if (this->_isStarted)
+    {
+        LOG_ERROR("{} setReusePort must be called before start", this->_name);
+        return;
+    }
+    this->_reusePort = on;
+}
+
+void mg::TcpServer::setIdleTimeout(int seconds)
+{
+    if (this->_isStarted)
+    {
+        LOG_ERROR("{} setIdleTimeout must be called before start", this->_name);
+        return;
+    }
+    this->_idleTimeout = seconds;
+}
+
+void mg::TcpServer::setEdgeTriggered(bool on)
+{
+    this->_edgeTriggered = on;
+}
+
 const std::string &mg::TcpServer::getName() const
 {
     return this->_name;
@@ -66,6 +130,31 @@ void mg::TcpServer::setThreadNums(int nums)
     this->_threadPool->setThreadNums(nums);
 }
 
+void mg::TcpServer::setLoopSelectPolicy(EventLoopThreadPool::SelectPolicy policy)
+{
+    this->_threadPool->setSelectPolicy(policy);
+}
+
+void mg::TcpServer::setLoopSelector(EventLoopThreadPool::LoopSelector selector)
+{
+    this->_threadPool->setLoopSelector(std::move(selector));
+}
+
+void mg::TcpServer::setLoopCpuAffinity(std::vector<int> cpus)
+{
+    this->_threadPool->setCpuAffinity(std::move(cpus));
+}
+
+bool mg::TcpServer::setLoopNumaNode(int node)
+{
+    return this->_threadPool->setNumaNode(node);
+}
+
+bool mg::TcpServer::setLoopInterfaceNode(const std::string &interface)
+{
+    return this->_threadPool->setInterfaceNode(interface);
+}
+
 void mg::TcpServer::setConnectionCallback(const TcpConnectionCallback &callback)
 {
     this->_connectionCallback = callback;
@@ -78,43 +167,44 @@ void mg::TcpServer::setMessageCallback(const MessageDataCallback &callback)
 
 void mg::TcpServer::acceptorCallback(int fd, const InternetAddress &peerAddress)
 {
-    EventLoop *loop = this->_threadPool->getNextLoop();
+    EventLoop *loop = this->_threadPool->getNextLoop(peerAddress.ipHash());
     if (!loop)
     {
         LOG_ERROR("{} EventLoop nullptr", this->_name);
         return;
     }
-    LOG_INFO("{} new connection:[{}] socketFd:{}", this->_name, peerAddress.toIpPort(), fd);
+    this->newConnection(loop, fd, peerAddress);
+}
 
-    char buf[1024] = {0};
-    ::snprintf(buf, sizeof(buf), "-%s-%d", peerAddress.toIpPort().c_str(), ++this->_connectionID);
-    std::string connectionName = this->_name + buf;
+void mg::TcpServer::newConnection(EventLoop *loop, int fd, const InternetAddress &peerAddress)
+{
+    uint64_t id = ++this->_connectionID;
+    std::string peer = peerAddress.toIpPort();
+    LOG_INFO("{} new connection:[{}] socketFd:{}", this->_name, peer, fd);
 
-    // 拿到本机ip地址
-    sockaddr_in local;
-    ::memset(&local, 0, sizeof(local));
-    socklen_t addresslen = sizeof(local);
+    // 连接名称只在这里拼接一次，本端地址等到使用时再获取
+    std::string connectionName;
+    connectionName.reserve(this->_name.size() + peer.size() + 22);
+    connectionName.append(this->_name).append(1, '-').append(peer).append(1, '-').append(std::to_string(id));
 
-    int ret = TEMP_FAILURE_RETRY(::getsockname(fd, (sockaddr *)&local, &addresslen));
-    if (ret < 0)
-    {
-        TEMP_FAILURE_RETRY(::close(fd));
-        LOG_ERROR("{} get local address failed", this->_name);
-        return;
-    }
-    InternetAddress localAddress(local);
-
-    this->handleNewConnection(loop, connectionName, fd, localAddress, peerAddress);
+    this->handleNewConnection(loop, id, connectionName, fd, peerAddress);
 }
 
 void mg::TcpServer::removeConnection(const TcpConnectionPointer &connection)
 {
-    this->_loop->run(std::bind(&TcpServer::removeConnectionCallBack, this, connection));
+    // 多个acceptor时连接在所属的loop中直接移除，不经过mainloop
+    if (this->_reusePort)
+        this->removeConnectionCallBack(connection);
+    else
+        this->_loop->run(std::bind(&TcpServer::removeConnectionCallBack, this, connection));
 }
 
 void mg::TcpServer::removeConnectionCallBack(const TcpConnectionPointer &connection)
 {
-    this->_connectionMemo.erase(connection->name());
+    {
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        this->_connectionMemo.erase(connection->id());
+    }
     EventLoop *loop = connection->getLoop();
     loop->push(std::bind(&TcpConnection::connectionDestoryed, connection));
     /*
@@ -126,16 +216,31 @@ void mg::TcpServer::removeConnectionCallBack(const TcpConnectionPointer &connect
      */
 }
 
-void mg::TcpServer::handleNewConnection(EventLoop *loop, const std::string &name, int fd,
-                                        const mg::InternetAddress &local,
+void mg::TcpServer::handleNewConnection(EventLoop *loop, uint64_t id, const std::string &name, int fd,
                                         const mg::InternetAddress &peer)
 {
-    TcpConnectionPointer connection = std::make_shared<TcpConnection>(loop, name, fd, local, peer);
+    TcpConnectionPointer connection = std::make_shared<TcpConnection>(loop, name, fd, InternetAddress(), peer);
+    connection->setId(id);
     connection->setConnectionCallback(this->_connectionCallback);
     connection->setMessageCallback(this->_messgageDataCallback);
     connection->setWriteCompleteCallback(this->_writeCompleteCallback);
     connection->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-    this->_connectionMemo[name] = connection;
+    connection->setIdleTimeoutList(this->getIdleTimeoutList(loop));
+    connection->setEdgeTriggered(this->_edgeTriggered);
+    connection->reserveLoopLoad();
+    this->addConnection(connection);
 
     loop->run(std::bind(&TcpConnection::connectionEstablished, connection.get()));
+}
+
+void mg::TcpServer::addConnection(const TcpConnectionPointer &connection)
+{
+    std::lock_guard<std::mutex> guard(this->_mutex);
+    this->_connectionMemo[connection->id()] = connection;
+}
+
+std::shared_ptr<mg::IdleTimeoutList> mg::TcpServer::getIdleTimeoutList(EventLoop *loop)
+{
+    auto it = this->_idleLists.find(loop);
+    return it == this->_idleLists.end() ? nullptr : it->second;
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 namespace mg
 {
@@ -35,6 +38,23 @@ namespace mg
          */
         void setThreadNums(int nums);
 
+        /**
+         * @brief 设置新连接分配到sub-loop的策略，默认为轮询，开启setReusePort时由内核分配，不使用该策略
+         */
+        void setLoopSelectPolicy(EventLoopThreadPool::SelectPolicy policy);
+
+        /**
+         * @brief 使用自定义的函数为新连接选择sub-loop
+         */
+        void setLoopSelector(EventLoopThreadPool::LoopSelector selector);
+
+        /**
+         * @brief sub-loop线程的CPU亲和性和NUMA节点，参见EventLoopThreadPool，需要在start之前调用
+         */
+        void setLoopCpuAffinity(std::vector<int> cpus);
+        bool setLoopNumaNode(int node);
+        bool setLoopInterfaceNode(const std::string &interface);
+
         /**
          * @brief 设置新连接建立时的回调，传递过程：用户自定义函数->TcpServer->TcpConnection
          */
@@ -52,6 +72,24 @@ namespace mg
          */
         void setWriteCompleteCallback(const WriteCompleteCallback &callback);
 
+        /**
+         * @brief 开启空闲连接超时，连接超过seconds秒没有读写时被关闭，需要在start之前调用
+         *        每个eventloop只使用一个定时器，连接本身不再创建定时器
+         * @param seconds 超时秒数，0表示关闭
+         */
+        void setIdleTimeout(int seconds);
+
+        /**
+         * @brief 新连接是否使用边沿触发，默认为水平触发
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * @brief 每个sub-loop使用自己的监听套接字(SO_REUSEPORT)接受连接，由内核分配新连接，
+         *        连接直接在接受它的loop中建立，不需要经过mainloop转交，需要在start之前调用
+         */
+        void setReusePort(bool on);
+
         /**
          * @brief 开启服务器
          */
@@ -83,6 +121,16 @@ namespace mg
          */
         void acceptorCallback(int fd, const InternetAddress &peerAddress);
 
+        /**
+         * @brief 在loop中建立新连接
+         */
+        void newConnection(EventLoop *loop, int fd, const InternetAddress &peerAddress);
+
+        /**
+         * @brief 按照连接编号保存新连接，多个acceptor时会在不同线程中调用
+         */
+        void addConnection(const TcpConnectionPointer &connection);
+
         /**
          * @brief 移除连接
          */
@@ -96,19 +144,31 @@ namespace mg
         /**
          * @brief 连接到来时具体的处理逻辑
          */
-        virtual void handleNewConnection(EventLoop *loop, const std::string &name, int fd,
-                                         const mg::InternetAddress &local,
+        virtual void handleNewConnection(EventLoop *loop, uint64_t id, const std::string &name, int fd,
                                          const mg::InternetAddress &peer);
 
+        /**
+         * @brief 得到loop对应的空闲连接链表，没有开启空闲超时时返回空
+         */
+        std::shared_ptr<IdleTimeoutList> getIdleTimeoutList(EventLoop *loop);
+
         bool _isStarted;                                                                 // 是否启动
         std::string _name;                                                               // 服务器的名称
         EventLoop *_loop;                                                                // 用户定义的mainloop
-        std::unique_ptr<Acceptor> _acceptor;                                             // 用于接受新连接的类实例
-        int _connectionID;                                                               // 用于区分相同TCP连接时不同的名字
+        std::unique_ptr<Acceptor> _acceptor;                                             // mainloop中接受新连接，开启setReusePort时不创建
+        std::atomic<uint64_t> _connectionID;                                             // 连接编号，用于管理连接以及区分相同TCP连接时不同的名字
         ThreadInitialCallBack _threadInitialCallback;                                    // loop线程初始化的回调函数
         std::shared_ptr<EventLoopThreadPool> _threadPool;                                // 线程池
         InternetAddress _address;                                                        // 绑定的地址
-        std::unordered_map<std::string, std::shared_ptr<TcpConnection>> _connectionMemo; // 管理所有连接
+        std::mutex _mutex;                                                               // 保护_connectionMemo，多个acceptor时会在不同线程中修改
+        std::unordered_map<uint64_t, std::shared_ptr<TcpConnection>> _connectionMemo;    // 管理所有连接，以连接编号为键
+        int _idleTimeout;                                                                // 空闲连接超时秒数
+        std::unordered_map<EventLoop *, std::shared_ptr<IdleTimeoutList>> _idleLists;    // 每个eventloop的空闲连接链表
+        bool _edgeTriggered;                                                             // 新连接是否使用边沿触发
+        int _domain;                                                                     // 监听套接字的协议族
+        int _type;                                                                       // 监听套接字的类型
+        bool _reusePort;                                                                 // 是否每个sub-loop使用自己的acceptor
+        std::vector<std::unique_ptr<Acceptor>> _loopAcceptors;                           // 每个sub-loop的acceptor
 
         /*-------以下是保存用户自定义的函数--------*/
         TcpConnectionCallback _connectionCallback;    // 新链接回调
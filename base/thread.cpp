@@ -1,5 +1,6 @@
 #include "thread.h"
 #include "current-thread.h"
+#include "cpu-affinity.h"
 
 #include <semaphore.h>
 
@@ -7,7 +8,7 @@ std::atomic<int32_t> mg::Thread::_threadIndex(0);
 
 mg::Thread::Thread(ThreadFunction cb, const std::string &name)
     : _start(false), _join(false), _tid(0),
-      _name(name), _function(std::move(cb))
+      _name(name), _function(std::move(cb)), _numaNode(-1)
 {
     setDefaultName();
 }
@@ -18,6 +19,16 @@ mg::Thread::~Thread()
         _thread->detach();
 }
 
+void mg::Thread::setCpuAffinity(std::vector<int> cpus)
+{
+    this->_cpus = std::move(cpus);
+}
+
+void mg::Thread::setNumaNode(int node)
+{
+    this->_numaNode = node;
+}
+
 void mg::Thread::start()
 {
     _start = true;
@@ -27,6 +38,11 @@ void mg::Thread::start()
         [&]()
         {
             this->_tid = currentThread::tid();
+            // 在入口函数之前设置，线程之后申请的内存都来自所在的节点
+            if (!this->_cpus.empty())
+                cpuAffinity::bindCurrentThread(this->_cpus);
+            if (this->_numaNode >= 0)
+                cpuAffinity::preferNode(this->_numaNode);
             sem_post(&semephore);
             this->_function(); // 执行入口函数
         }));
@@ -6,6 +6,7 @@
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 namespace mg
 {
@@ -18,6 +19,16 @@ namespace mg
 
         ~Thread();
 
+        /**
+         * @brief 线程启动后绑定到cpus中的CPU上，需要在start之前调用
+         */
+        void setCpuAffinity(std::vector<int> cpus);
+
+        /**
+         * @brief 线程启动后优先从node节点申请内存，需要在start之前调用，-1表示不设置
+         */
+        void setNumaNode(int node);
+
         void start();
 
         void join();
@@ -32,6 +43,8 @@ namespace mg
         pid_t _tid;               // 线程pid
         std::string _name;        // 线程名字
         ThreadFunction _function; // 线程要执行的入口函数
+        std::vector<int> _cpus;   // 绑定的CPU，为空时不绑定
+        int _numaNode;            // 优先申请内存的NUMA节点，-1表示不设置
         std::shared_ptr<std::thread> _thread;
         static std::atomic<int32_t> _threadIndex; // 线程索引
     };
@@ -3,9 +3,15 @@
 #include <string.h>
 
 #include "log.h"
+#include "cpu-affinity.h"
+
+// 当前线程所属的线程池和它在线程池中的下标
+static __thread mg::ThreadPool *t_threadPool = nullptr;
+static __thread size_t t_workerIndex = 0;
 
 mg::ThreadPool::ThreadPool(std::string name, int queueSize)
-    : _name(name), _running(false), _maxQueueSize(queueSize)
+    : _name(name), _taskQueue(queueSize), _running(false),
+      _idleConsumers(0), _waitingProductors(0), _numaNode(-1)
 {
     ;
 }
@@ -20,6 +26,10 @@ void mg::ThreadPool::start(int threadNums)
 {
     this->_running = true;
     this->_threads.reserve(threadNums);
+    this->_workers.reserve(threadNums);
+    // 先创建所有线程的队列，线程启动后就可能互相窃取
+    for (int i = 0; i < threadNums; i++)
+        this->_workers.emplace_back(new Worker());
     for (int i = 0; i < threadNums; i++)
     {
         char buf[128] = {0};
@@ -27,25 +37,63 @@ void mg::ThreadPool::start(int threadNums)
         ::snprintf(buf + this->_name.size(),
                    sizeof(buf) - this->_name.size() - 1, "-ID[%d]", i);
         this->_threads.emplace_back(
-            new Thread(std::bind(&ThreadPool::threadTask, this), buf));
+            new Thread(std::bind(&ThreadPool::threadTask, this, static_cast<size_t>(i)), buf));
+        if (!this->_cpus.empty())
+            this->_threads[i]->setCpuAffinity({this->_cpus[i % this->_cpus.size()]});
+        else if (!this->_nodeCpus.empty())
+            this->_threads[i]->setCpuAffinity(this->_nodeCpus);
+        this->_threads[i]->setNumaNode(this->_numaNode);
         this->_threads[i]->start();
     }
     if (!threadNums && this->_initialTask)
         this->_initialTask();
 }
 
+void mg::ThreadPool::setCpuAffinity(std::vector<int> cpus)
+{
+    this->_cpus = std::move(cpus);
+}
+
+bool mg::ThreadPool::setNumaNode(int node)
+{
+    std::vector<int> cpus = cpuAffinity::nodeCpus(node);
+    if (cpus.empty())
+    {
+        LOG_ERROR("ThreadPool[{}] numa node {} has no cpu", this->_name, node);
+        return false;
+    }
+    this->_nodeCpus = std::move(cpus);
+    this->_numaNode = node;
+    return true;
+}
+
 void mg::ThreadPool::append(Task task)
 {
     if (this->_threads.empty())
+    {
         task();
-    else
+        return;
+    }
+
+    if (t_threadPool == this)
+    {
+        // 工作线程中提交的任务放在自己的队列中，空闲的线程可以来窃取
+        Worker &worker = *this->_workers[t_workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        worker.size.store(worker.tasks.size(), std::memory_order_relaxed);
+    }
+    else if (!this->_taskQueue.push(std::move(task)))
     {
         std::unique_lock<std::mutex> lock(this->_mutex);
-        this->_productor.wait(lock, [&]()
-                              { return this->_taskQueue.size() < this->_maxQueueSize; });
-        this->_taskQueue.push(std::move(task));
-        this->_consumer.notify_one();
+        this->_waitingProductors++;
+        // 与notifyProductor配合：要么这里的重试成功，要么消费者看到_waitingProductors后唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!this->_taskQueue.push(std::move(task)) && this->_running)
+            this->_productor.wait(lock);
+        this->_waitingProductors--;
     }
+    this->notifyConsumer();
 }
 
 void mg::ThreadPool::stop()
@@ -54,37 +102,112 @@ void mg::ThreadPool::stop()
     {
         std::lock_guard<std::mutex> lock(this->_mutex);
         this->_consumer.notify_all();
+        this->_productor.notify_all();
     }
     for (auto &x : this->_threads)
         x->join();
 }
 
-void mg::ThreadPool::threadTask()
+void mg::ThreadPool::threadTask(size_t index)
 {
-    try
+    t_threadPool = this;
+    t_workerIndex = index;
+    if (this->_initialTask)
+        this->_initialTask();
+    while (this->_running)
     {
-        if (this->_initialTask)
-            this->_initialTask();
-        while (this->_running)
+        Task task;
+        if (this->popTask(index, task))
         {
-            Task task;
+            try
             {
-                std::unique_lock<std::mutex> lock(this->_mutex);
-                this->_consumer.wait(lock, [&]()
-                                     { return !this->_running || !this->_taskQueue.empty(); });
-                if (!this->_taskQueue.empty())
-                {
-                    task = this->_taskQueue.front();
-                    this->_taskQueue.pop();
-                    this->_productor.notify_all();
-                }
-            }
-            if (task)
                 task();
+            }
+            catch (...)
+            {
+                LOG_ERROR("ThreadPool[{}] catch exception", this->_name);
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_idleConsumers++;
+        // 与notifyConsumer配合：要么这里看到新任务，要么生产者看到_idleConsumers后唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        this->_consumer.wait(lock, [&]()
+                             { return !this->_running || this->hasTask(); });
+        this->_idleConsumers--;
+    }
+    t_threadPool = nullptr;
+}
+
+bool mg::ThreadPool::popTask(size_t index, Task &task)
+{
+    Worker &self = *this->_workers[index];
+    if (self.size.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(self.mutex);
+        if (!self.tasks.empty())
+        {
+            task = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            self.size.store(self.tasks.size(), std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    if (this->_taskQueue.pop(task))
+    {
+        this->notifyProductor();
+        return true;
+    }
+
+    size_t size = this->_workers.size();
+    for (size_t i = 1; i < size; i++)
+    {
+        Worker &victim = *this->_workers[(index + i) % size];
+        if (!victim.size.load(std::memory_order_relaxed))
+            continue;
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (lock.owns_lock() && !victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            victim.size.store(victim.tasks.size(), std::memory_order_relaxed);
+            return true;
         }
     }
-    catch (...)
+    return false;
+}
+
+bool mg::ThreadPool::hasTask() const
+{
+    if (!this->_taskQueue.empty())
+        return true;
+    for (auto &worker : this->_workers)
     {
-        LOG_ERROR("ThreadPool[{}] catch exception", this->_name);
+        if (worker->size.load(std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+void mg::ThreadPool::notifyConsumer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_idleConsumers.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_consumer.notify_one();
+    }
+}
+
+void mg::ThreadPool::notifyProductor()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_waitingProductors.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_productor.notify_all();
     }
 }
@@ -2,20 +2,32 @@
 #define __MG_THREADPOOL_H__
 
 #include "thread.h"
+#include "task.h"
+
+#include "mpmc-queue.h"
 
 #include <string>
 #include <vector>
-#include <queue>
+#include <deque>
+#include <future>
 #include <condition_variable>
 #include <mutex>
+#include <type_traits>
 
 namespace mg
 {
     class EventLoop;
+
+    /**
+     * @brief 工作窃取线程池
+     *        其他线程提交的任务进入无锁的有界队列，工作线程中提交的任务放入该线程自己的双端队列，
+     *        工作线程优先从自己的队列尾部取任务，然后是共享队列，最后从其他线程的队列头部窃取，
+     *        只有队列满时的生产者和没有任务可做的工作线程才会使用_mutex
+     */
     class ThreadPool
     {
     public:
-        using Task = std::function<void()>;
+        using Task = mg::Task;
         /**
          * @brief 线程池构造
          * @param name 线程池名
@@ -32,10 +44,33 @@ namespace mg
         void start(int threadNums);
 
         /**
-         * @brief 如果存在线程则将任务交给线程执行，否则自己执行
+         * @brief 第i个线程绑定到cpus[i % cpus.size()]上，需要在start之前调用
+         */
+        void setCpuAffinity(std::vector<int> cpus);
+
+        /**
+         * @brief 线程限制在node节点的CPU上运行，并优先从该节点申请内存，需要在start之前调用
+         */
+        bool setNumaNode(int node);
+
+        /**
+         * @brief 如果存在线程则将任务交给线程执行，否则自己执行，共享队列已满时阻塞等待
          */
         void append(Task task);
 
+        /**
+         * @brief 提交任务并通过std::future获取返回值或者异常
+         */
+        template <typename Function>
+        std::future<typename std::result_of<typename std::decay<Function>::type()>::type> submit(Function &&function)
+        {
+            using Result = typename std::result_of<typename std::decay<Function>::type()>::type;
+            std::packaged_task<Result()> task(std::forward<Function>(function));
+            std::future<Result> future = task.get_future();
+            this->append(std::move(task));
+            return future;
+        }
+
         /**
          * @brief 停止线程池
          */
@@ -55,20 +90,54 @@ namespace mg
         const std::string &getName() const { return this->_name; };
 
     private:
+        // 每个工作线程的任务队列，所属线程从尾部存取，其他线程从头部窃取
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            std::atomic<size_t> size{0}; // tasks的长度，不加锁判断是否有任务可以窃取
+            char padding[64];            // 避免相邻的Worker共享缓存行
+        };
+
         /**
          * @brief 创建线程入口函数，线程要执行的操作
          */
-        void threadTask();
+        void threadTask(size_t index);
+
+        /**
+         * @brief 依次从自己的队列、共享队列和其他线程的队列中取任务
+         */
+        bool popTask(size_t index, Task &task);
+
+        /**
+         * @brief 是否还有等待执行的任务，用于工作线程休眠前的检查
+         */
+        bool hasTask() const;
+
+        /**
+         * @brief 有工作线程休眠时唤醒一个
+         */
+        void notifyConsumer();
+
+        /**
+         * @brief 有生产者因为共享队列已满而等待时唤醒它们
+         */
+        void notifyProductor();
 
-        mutable std::mutex _mutex;                     // 互斥锁
+        mutable std::mutex _mutex;                     // 只用于休眠和唤醒
         std::condition_variable _consumer;             // 消费者等待
         std::condition_variable _productor;            // 生产者等待
         std::string _name;                             // 线程ID
         Task _initialTask;                             // 线程池初始化任务
         std::vector<std::unique_ptr<Thread>> _threads; // 管理线程实例
-        std::queue<Task> _taskQueue;                   // 任务队列
+        std::vector<std::unique_ptr<Worker>> _workers; // 每个线程的任务队列
+        MpmcQueue<Task> _taskQueue;                    // 其他线程提交任务的共享队列
         std::atomic_bool _running;                     // 线程池是否处于运行中
-        size_t _maxQueueSize;                          // 任务队列最大数量
+        std::atomic<int> _idleConsumers;               // 正在休眠的工作线程数
+        std::atomic<int> _waitingProductors;           // 等待共享队列空位的生产者数
+        std::vector<int> _cpus;                        // 各个线程依次绑定的CPU
+        std::vector<int> _nodeCpus;                    // NUMA节点的CPU
+        int _numaNode;                                 // 线程所在的NUMA节点，-1表示不设置
     };
 };
 
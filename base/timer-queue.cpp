@@ -14,7 +14,7 @@ mg::TimerQueue::TimerQueue(EventLoop *loop)
     : _loop(loop), _timerFd(createTimerFd()),
       _channel(_loop, _timerFd), _list(),
       _activeTimers(), _isCallingExpiredTimers(false),
-      _cancleingTimers()
+      _cancleingTimers(), _wheelExpiration(0), _hasAdded(false)
 {
     _channel.setReadCallback(std::bind(&TimerQueue::handleRead, this));
     _channel.enableReading();
@@ -29,9 +29,14 @@ mg::TimerQueue::~TimerQueue()
         delete x.second;
 }
 
-mg::TimerId mg::TimerQueue::addTimer(std::function<void()> callback, TimeStamp time, double interval)
+mg::TimerId mg::TimerQueue::addTimer(Task callback, TimeStamp time, double interval)
 {
-    auto timer = new Timer(std::move(callback), time, interval);
+    Timer *timer = nullptr;
+    if (this->_wheel)
+        timer = this->_wheel->create(std::move(callback), time, interval);
+    else
+        timer = new Timer(std::move(callback), time, interval);
+    this->_hasAdded = true;
     _loop->run(std::bind(&TimerQueue::addTimerInOwnerLoop, this, timer));
     return TimerId(timer, timer->getTimerId());
 }
@@ -44,6 +49,11 @@ void mg::TimerQueue::cancel(TimerId timerId)
 
 void mg::TimerQueue::clear()
 {
+    if (this->_wheel)
+    {
+        _loop->run(std::bind(&TimerQueue::clearInOwnerLoop, this));
+        return;
+    }
     std::vector<TimerId> memo;
     for (auto &x : _list)
         memo.push_back(TimerId(x.second, x.second->getTimerId()));
@@ -58,6 +68,12 @@ void mg::TimerQueue::addTimerInOwnerLoop(Timer *timer)
         LOG_ERROR("Timer not added in the owner thread");
         return;
     }
+    if (this->_wheel)
+    {
+        this->_wheel->insert(timer);
+        this->resetWheelTimerFd();
+        return;
+    }
     if (this->insert(timer))
         resetTimerFd(this->_timerFd, timer->expiration());
 }
@@ -67,6 +83,14 @@ void mg::TimerQueue::handleRead()
     TimeStamp now = TimeStamp::now();
     readTimerFd(_timerFd);
 
+    if (this->_wheel)
+    {
+        this->_wheel->expire(now);
+        this->_wheelExpiration = TimeStamp(0);
+        this->resetWheelTimerFd();
+        return;
+    }
+
     auto expired = this->getExpired(now);
     _isCallingExpiredTimers = true;
     _cancleingTimers.clear();
@@ -126,6 +150,11 @@ bool mg::TimerQueue::insert(Timer *timer)
 void mg::TimerQueue::cancelInOwnerLoop(TimerId id)
 {
     assert(_loop->isInOwnerThread());
+    if (this->_wheel)
+    {
+        this->_wheel->cancel(id._timer, id._sequence);
+        return;
+    }
     assert(_list.size() == _activeTimers.size());
     ActiveTimer timer(id._timer, id._sequence);
     auto it = _activeTimers.find(timer);
@@ -139,6 +168,38 @@ void mg::TimerQueue::cancelInOwnerLoop(TimerId id)
         _cancleingTimers.insert(timer);
 }
 
+void mg::TimerQueue::clearInOwnerLoop()
+{
+    this->_wheel->clear();
+}
+
+bool mg::TimerQueue::setBackend(Backend backend)
+{
+    assert(_loop->isInOwnerThread());
+    if (this->_hasAdded)
+    {
+        LOG_ERROR("EventLoop[{}] timers already added, backend unchanged", this->_loop->getLoopName());
+        return false;
+    }
+    if (backend == TIMING_WHEEL && !this->_wheel)
+        this->_wheel.reset(new TimingWheel());
+    else if (backend == TIMER_TREE)
+        this->_wheel.reset();
+    return true;
+}
+
+void mg::TimerQueue::resetWheelTimerFd()
+{
+    TimeStamp next = this->_wheel->nextExpiration();
+    if (!next.getMircoSecond())
+        return;
+    if (!this->_wheelExpiration.getMircoSecond() || next < this->_wheelExpiration)
+    {
+        resetTimerFd(this->_timerFd, next);
+        this->_wheelExpiration = next;
+    }
+}
+
 static int createTimerFd()
 {
     int timeFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
@@ -4,11 +4,13 @@
 #include "timer.h"
 #include "channel.h"
 #include "timer-id.h"
+#include "timing-wheel.h"
 
 #include <set>
 #include <utility>
 #include <atomic>
 #include <vector>
+#include <memory>
 
 namespace mg
 {
@@ -16,6 +18,12 @@ namespace mg
     class TimerQueue
     {
     public:
+        enum Backend
+        {
+            TIMER_TREE = 0,  // 红黑树，默认
+            TIMING_WHEEL = 1 // 分层时间轮，适合大量定时器频繁添加和取消
+        };
+
         explicit TimerQueue(EventLoop *loop);
 
         ~TimerQueue();
@@ -24,7 +32,7 @@ namespace mg
          * @brief 添加定时器任务
          * @return 定时器ID
          */
-        TimerId addTimer(std::function<void()> callback, TimeStamp time, double interval);
+        TimerId addTimer(Task callback, TimeStamp time, double interval);
 
         /**
          * @brief 取消定时器
@@ -37,6 +45,12 @@ namespace mg
          */
         void clear();
 
+        /**
+         * @brief 切换定时器的实现，只能在所属线程中、添加任何定时器之前调用
+         * @return 已经添加过定时器时切换失败返回false
+         */
+        bool setBackend(Backend backend);
+
     private:
         using Entry = std::pair<TimeStamp, Timer *>;
         using TimerList = std::set<Entry>;
@@ -55,6 +69,13 @@ namespace mg
 
         void cancelInOwnerLoop(TimerId id);
 
+        void clearInOwnerLoop();
+
+        /**
+         * @brief 时间轮下一个需要处理的时刻早于_timerFd当前的超时时间时重置_timerFd
+         */
+        void resetWheelTimerFd();
+
         EventLoop *_loop;                         // 所属的loop
         const int _timerFd;                       // linux提供的定时器接口
         Channel _channel;                         // 管理_timerFd的channel
@@ -62,6 +83,9 @@ namespace mg
         ActiveTimerSet _activeTimers;             // 已销毁的连接处于活跃的定时器事件集合
         std::atomic_bool _isCallingExpiredTimers; // 是否处于执行定时器事件中
         ActiveTimerSet _cancleingTimers;          // 待销毁的定时器事件集合
+        std::unique_ptr<TimingWheel> _wheel;      // 不为空时使用时间轮管理定时器
+        TimeStamp _wheelExpiration;               // 时间轮模式下_timerFd的超时时间
+        std::atomic_bool _hasAdded;               // 是否添加过定时器
     };
     /**
      * @date 2024-10-19 21:42
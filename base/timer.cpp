@@ -16,7 +16,7 @@ mg::Timer::Timer() : _callback(), _expiration(0),
 }
 
 mg::Timer::Timer(TimerCallback cb, TimeStamp time, double interval)
-    : _callback(cb), _expiration(time),
+    : _callback(std::move(cb)), _expiration(time),
       _interval(interval), _repeat(interval > 0.0),
       _id(generateAndGetID())
 {
@@ -3,15 +3,14 @@
 
 #include "noncopyable.h"
 #include "time-stamp.h"
-
-#include <functional>
+#include "task.h"
 
 namespace mg
 {
     class Timer : noncopyable
     {
     public:
-        using TimerCallback = std::function<void()>;
+        using TimerCallback = Task;
 
         Timer();
 
@@ -0,0 +1,260 @@
+#include "timing-wheel.h"
+#include "log.h"
+
+#include <string.h>
+#include <algorithm>
+
+const int64_t mg::TimingWheel::_tickMicroSeconds;
+const int mg::TimingWheel::_slotBits;
+const int mg::TimingWheel::_slots;
+const int mg::TimingWheel::_levels;
+const int mg::TimingWheel::_chunkSize;
+
+mg::TimingWheel::TimingWheel()
+    : _currentTick(TimeStamp::now().getMircoSecond() / _tickMicroSeconds),
+      _size(0), _pending(nullptr), _freeList(nullptr)
+{
+    ::memset(this->_wheel, 0, sizeof(this->_wheel));
+    ::memset(this->_bitmap, 0, sizeof(this->_bitmap));
+}
+
+mg::TimingWheel::~TimingWheel()
+{
+    for (auto &chunk : this->_chunks)
+    {
+        for (int i = 0; i < _chunkSize; i++)
+        {
+            if (chunk[i].state != FREE)
+                toTimer(&chunk[i])->~Timer();
+        }
+        delete[] chunk;
+    }
+}
+
+mg::Timer *mg::TimingWheel::create(Task callback, TimeStamp time, double interval)
+{
+    Node *node = this->allocate();
+    Timer *timer = new (&node->_timer) Timer(std::move(callback), time, interval);
+    node->prev = node->next = nullptr;
+    node->state = CREATED;
+    node->canceled = false;
+    node->sequence.store(timer->getTimerId(), std::memory_order_release);
+    return timer;
+}
+
+void mg::TimingWheel::insert(Timer *timer)
+{
+    Node *node = toNode(timer);
+    if (node->canceled)
+    {
+        this->release(node);
+        return;
+    }
+    // 时间轮为空时直接对齐到当前时间，避免新定时器从很久之前的tick开始计算层级
+    if (!this->_size && !this->_pending)
+        this->_currentTick = std::max(this->_currentTick, TimeStamp::now().getMircoSecond() / _tickMicroSeconds);
+    // 已经处理过的tick不会再被处理，过期的定时器放到下一个tick
+    node->tick = std::max(toTick(timer->expiration()), this->_currentTick + 1);
+    this->place(node, node->tick);
+}
+
+bool mg::TimingWheel::cancel(Timer *timer, int64_t sequence)
+{
+    if (!timer || !sequence)
+        return false;
+    Node *node = toNode(timer);
+    if (node->sequence.load(std::memory_order_acquire) != sequence)
+        return false;
+    if (node->state == LINKED)
+    {
+        this->unlink(node);
+        this->release(node);
+    }
+    else
+        node->canceled = true;
+    return true;
+}
+
+void mg::TimingWheel::clear()
+{
+    for (int level = 0; level < _levels; level++)
+    {
+        for (int slot = 0; slot < _slots && this->_bitmap[level]; slot++)
+        {
+            Node *node = this->detach(level, slot);
+            while (node)
+            {
+                Node *next = node->next;
+                this->release(node);
+                node = next;
+            }
+        }
+    }
+    for (Node *node = this->_pending; node; node = node->next)
+        node->canceled = true;
+}
+
+void mg::TimingWheel::expire(TimeStamp now)
+{
+    int64_t nowTick = now.getMircoSecond() / _tickMicroSeconds;
+    int64_t tick = 0;
+    while ((tick = this->nextTick()) >= 0 && tick <= nowTick)
+    {
+        this->_currentTick = tick;
+        // tick是第level层的周期起点时，该层对应槽位中的定时器需要重新分配
+        for (int level = 1; level < _levels; level++)
+        {
+            if (tick & ((1LL << (_slotBits * level)) - 1))
+                break;
+            this->cascade(level, (tick >> (_slotBits * level)) & (_slots - 1));
+        }
+        this->run(tick & (_slots - 1), now);
+    }
+    this->_currentTick = std::max(this->_currentTick, nowTick);
+}
+
+mg::TimeStamp mg::TimingWheel::nextExpiration() const
+{
+    int64_t tick = this->nextTick();
+    return tick < 0 ? TimeStamp(0) : TimeStamp(tick * _tickMicroSeconds);
+}
+
+void mg::TimingWheel::place(Node *node, int64_t tick)
+{
+    int64_t delta = std::max<int64_t>(tick - this->_currentTick, 0);
+    int level = 0;
+    while (level < _levels - 1 && delta >= (1LL << (_slotBits * (level + 1))))
+        level++;
+    // 超出时间轮范围的定时器先放在最高层最远的槽位，cascade时再按照真实的tick重新分配
+    if (delta >= (1LL << (_slotBits * _levels)))
+        tick = this->_currentTick + (1LL << (_slotBits * _levels)) - 1;
+    this->link(node, level, (tick >> (_slotBits * level)) & (_slots - 1));
+}
+
+void mg::TimingWheel::link(Node *node, int level, int slot)
+{
+    Node *&head = this->_wheel[level][slot];
+    node->prev = nullptr;
+    node->next = head;
+    if (head)
+        head->prev = node;
+    head = node;
+    node->level = level;
+    node->slot = slot;
+    node->state = LINKED;
+    this->_bitmap[level] |= (1ULL << slot);
+    this->_size++;
+}
+
+void mg::TimingWheel::unlink(Node *node)
+{
+    Node *&head = this->_wheel[node->level][node->slot];
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        head = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    if (!head)
+        this->_bitmap[node->level] &= ~(1ULL << node->slot);
+    node->prev = node->next = nullptr;
+    this->_size--;
+}
+
+mg::TimingWheel::Node *mg::TimingWheel::detach(int level, int slot)
+{
+    Node *head = this->_wheel[level][slot];
+    this->_wheel[level][slot] = nullptr;
+    this->_bitmap[level] &= ~(1ULL << slot);
+    for (Node *node = head; node; node = node->next)
+    {
+        node->state = DETACHED;
+        this->_size--;
+    }
+    return head;
+}
+
+void mg::TimingWheel::cascade(int level, int slot)
+{
+    Node *node = this->detach(level, slot);
+    while (node)
+    {
+        Node *next = node->next;
+        this->place(node, node->tick);
+        node = next;
+    }
+}
+
+void mg::TimingWheel::run(int slot, TimeStamp now)
+{
+    // 正在执行的节点也留在_pending中，回调中调用clear时可以一并取消
+    this->_pending = this->detach(0, slot);
+    while (this->_pending)
+    {
+        Node *node = this->_pending;
+        Timer *timer = toTimer(node);
+        if (!node->canceled)
+            timer->run();
+        this->_pending = node->next;
+        node->next = nullptr;
+
+        // 回调中可能取消了自己
+        if (!node->canceled && timer->isRepeated())
+        {
+            timer->restart(now);
+            this->insert(timer);
+        }
+        else
+            this->release(node);
+    }
+}
+
+int64_t mg::TimingWheel::nextTick() const
+{
+    int64_t result = -1;
+    for (int level = 0; level < _levels; level++)
+    {
+        uint64_t bitmap = this->_bitmap[level];
+        if (!bitmap)
+            continue;
+        // 从下一个周期开始找第一个非空槽位
+        int64_t base = (this->_currentTick >> (_slotBits * level)) + 1;
+        int start = base & (_slots - 1);
+        uint64_t rotated = start ? ((bitmap >> start) | (bitmap << (_slots - start))) : bitmap;
+        int64_t tick = (base + __builtin_ctzll(rotated)) << (_slotBits * level);
+        if (result < 0 || tick < result)
+            result = tick;
+    }
+    return result;
+}
+
+mg::TimingWheel::Node *mg::TimingWheel::allocate()
+{
+    std::lock_guard<std::mutex> lock(this->_poolMutex);
+    if (!this->_freeList)
+    {
+        Node *chunk = new Node[_chunkSize];
+        for (int i = 0; i < _chunkSize; i++)
+        {
+            chunk[i].state = FREE;
+            chunk[i].sequence.store(0, std::memory_order_relaxed);
+            chunk[i].next = i + 1 < _chunkSize ? &chunk[i + 1] : nullptr;
+        }
+        this->_chunks.push_back(chunk);
+        this->_freeList = chunk;
+        LOG_DEBUG("TimingWheel allocate {} timer nodes", _chunkSize * this->_chunks.size());
+    }
+    Node *node = this->_freeList;
+    this->_freeList = node->next;
+    return node;
+}
+
+void mg::TimingWheel::release(Node *node)
+{
+    toTimer(node)->~Timer();
+    node->sequence.store(0, std::memory_order_release);
+    node->state = FREE;
+    std::lock_guard<std::mutex> lock(this->_poolMutex);
+    node->next = this->_freeList;
+    this->_freeList = node;
+}
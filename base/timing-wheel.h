@@ -0,0 +1,145 @@
+#ifndef __MG_TIMING_WHEEL_H__
+#define __MG_TIMING_WHEEL_H__
+
+#include "noncopyable.h"
+#include "time-stamp.h"
+#include "timer.h"
+#include "task.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace mg
+{
+    /**
+     * @brief 分层时间轮，插入和取消都是O(1)，定时器节点来自内部的内存池
+     *        共_levels层，每层_slots个槽位，第L层每个槽位覆盖_slots^L个tick，
+     *        高层槽位到期时把其中的定时器重新分配到低层(cascade)，第0层槽位到期时执行定时器
+     *        除create以外的函数都只能在所属eventloop线程中调用
+     */
+    class TimingWheel : noncopyable
+    {
+    public:
+        TimingWheel();
+
+        ~TimingWheel();
+
+        /**
+         * @brief 从内存池中创建定时器，可以在任意线程调用
+         * @param callback 超时后执行的回调
+         * @param time 超时时间
+         * @param interval 重复执行的间隔，0表示只执行一次
+         */
+        Timer *create(Task callback, TimeStamp time, double interval);
+
+        /**
+         * @brief 将create创建的定时器加入时间轮
+         */
+        void insert(Timer *timer);
+
+        /**
+         * @brief 取消定时器，sequence与定时器当前的id不一致时说明定时器已经失效
+         * @return 找到并取消了定时器返回true
+         */
+        bool cancel(Timer *timer, int64_t sequence);
+
+        /**
+         * @brief 取消所有定时器
+         */
+        void clear();
+
+        /**
+         * @brief 推进时间轮到now，并执行所有到期的定时器
+         */
+        void expire(TimeStamp now);
+
+        /**
+         * @brief 下一个需要处理的时刻，可能是定时器到期也可能是高层槽位需要cascade
+         * @return 时间轮为空时返回TimeStamp(0)
+         */
+        TimeStamp nextExpiration() const;
+
+        inline size_t size() const { return this->_size; }
+
+        static const int64_t _tickMicroSeconds = 1000; // 每个tick的微秒数
+        static const int _slotBits = 6;
+        static const int _slots = 1 << _slotBits; // 每层的槽位数
+        static const int _levels = 6;             // 层数，可以覆盖_slots^_levels个tick
+
+    private:
+        enum State
+        {
+            FREE = 0,     // 在内存池中
+            CREATED = 1,  // 已创建，还未加入时间轮
+            LINKED = 2,   // 在时间轮的槽位中
+            DETACHED = 3, // 已到期，等待执行或正在执行
+        };
+
+        // _timer必须是第一个成员，Timer *与Node *可以相互转换
+        struct Node
+        {
+            typename std::aligned_storage<sizeof(Timer), alignof(Timer)>::type _timer;
+            Node *prev;                    // 槽位链表中的前一个节点
+            Node *next;                    // 槽位链表或者空闲链表中的后一个节点
+            int64_t tick;                  // 到期的tick
+            std::atomic<int64_t> sequence; // 定时器id，归还内存池后清零，其他线程可能同时读取
+            int level;                     // 所在的层
+            int slot;                      // 所在的槽位
+            State state;                   // 节点状态
+            bool canceled;                 // 加入时间轮前或者到期后执行前被取消
+        };
+
+        static inline Timer *toTimer(Node *node) { return reinterpret_cast<Timer *>(&node->_timer); }
+        static inline Node *toNode(Timer *timer) { return reinterpret_cast<Node *>(timer); }
+        static inline int64_t toTick(TimeStamp time) { return (time.getMircoSecond() + _tickMicroSeconds - 1) / _tickMicroSeconds; }
+
+        /**
+         * @brief 按照到期tick放入对应的层和槽位
+         */
+        void place(Node *node, int64_t tick);
+
+        void link(Node *node, int level, int slot);
+
+        void unlink(Node *node);
+
+        /**
+         * @brief 取下level层slot槽位中所有节点
+         */
+        Node *detach(int level, int slot);
+
+        /**
+         * @brief 把高层槽位中的定时器重新分配到低层
+         */
+        void cascade(int level, int slot);
+
+        /**
+         * @brief 执行第0层slot槽位中的定时器
+         */
+        void run(int slot, TimeStamp now);
+
+        /**
+         * @brief 大于_currentTick的下一个需要处理的tick，没有时返回-1
+         */
+        int64_t nextTick() const;
+
+        Node *allocate();
+
+        void release(Node *node);
+
+        Node *_wheel[_levels][_slots]; // 各层槽位的链表头
+        uint64_t _bitmap[_levels];     // 各层非空槽位的位图
+        int64_t _currentTick;          // 已经处理到的tick
+        size_t _size;                  // 时间轮槽位中的定时器数量
+        Node *_pending;                // 已经到期等待执行的节点
+
+        std::mutex _poolMutex;             // 保护内存池，create可能在其他线程调用
+        Node *_freeList;                   // 内存池中的空闲节点
+        std::vector<Node *> _chunks;       // 内存池申请的内存块，析构时才释放，失效的TimerId仍然可以安全访问
+        static const int _chunkSize = 256; // 每个内存块的节点数
+    };
+};
+
+#endif //__MG_TIMING_WHEEL_H__
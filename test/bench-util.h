@@ -0,0 +1,183 @@
+#ifndef __MG_BENCH_UTIL_H__
+#define __MG_BENCH_UTIL_H__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * 各个bench共用的客户端函数，服务器和客户端在同一个进程中，都连接本机地址
+ */
+namespace bench
+{
+    /**
+     * @brief 绑定0端口由内核分配一个空闲端口，关闭之后交给服务器监听，多个bench同时运行时不会冲突
+     */
+    inline uint16_t freePort()
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return 0;
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = 0;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        socklen_t len = sizeof(address);
+        uint16_t port = 0;
+        if (::bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0 &&
+            ::getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &len) == 0)
+            port = ntohs(address.sin_port);
+        ::close(fd);
+        return port;
+    }
+
+    inline int connectServer(uint16_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    inline bool writeAll(int fd, const char *data, size_t len)
+    {
+        size_t written = 0;
+        while (written < len)
+        {
+            ssize_t n = ::write(fd, data + written, len - written);
+            if (n <= 0)
+                return false;
+            written += n;
+        }
+        return true;
+    }
+
+    inline bool writeAll(int fd, const std::string &data)
+    {
+        return writeAll(fd, data.data(), data.size());
+    }
+
+    /**
+     * @brief 读取应答头部，pending中保存头部之后多读到的数据
+     */
+    inline bool readHead(int fd, std::string &pending, std::string &head)
+    {
+        char buf[65536];
+        while (true)
+        {
+            size_t end = pending.find("\r\n\r\n");
+            if (end != std::string::npos)
+            {
+                head = pending.substr(0, end + 4);
+                pending.erase(0, end + 4);
+                return true;
+            }
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0)
+                return false;
+            pending.append(buf, n);
+        }
+    }
+
+    /**
+     * @brief 头部中Content-Length的值，没有时返回0
+     */
+    inline size_t contentLength(const std::string &head)
+    {
+        const char *header = ::strcasestr(head.c_str(), "\r\ncontent-length:");
+        return header ? ::strtoull(header + 17, nullptr, 10) : 0;
+    }
+
+    /**
+     * @brief 读取一个按照Content-Length结束的完整应答，pending中保存多读到的数据，head和body为空时不保存
+     */
+    inline bool readResponse(int fd, std::string &pending, std::string *head, std::string *body)
+    {
+        char buf[16384];
+        while (true)
+        {
+            size_t end = pending.find("\r\n\r\n");
+            if (end != std::string::npos)
+            {
+                size_t length = 0;
+                const char *header = ::strcasestr(pending.c_str(), "\r\ncontent-length:");
+                if (header && header < pending.c_str() + end)
+                    length = ::strtoul(header + 17, nullptr, 10);
+                if (pending.size() >= end + 4 + length)
+                {
+                    if (head)
+                        head->assign(pending, 0, end + 4);
+                    if (body)
+                        body->assign(pending, end + 4, length);
+                    pending.erase(0, end + 4 + length);
+                    return true;
+                }
+            }
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0)
+                return false;
+            pending.append(buf, n);
+        }
+    }
+
+    inline bool readResponse(int fd, std::string &pending, std::string &head, std::string &body)
+    {
+        return readResponse(fd, pending, &head, &body);
+    }
+
+    inline void check(const char *name, bool ok)
+    {
+        ::printf("check   %-56s %s\n", name, ok ? "ok" : "FAILED");
+    }
+
+    /**
+     * @brief 进程的最大常驻内存，单位KB
+     */
+    inline long maxRss()
+    {
+        struct rusage usage;
+        ::getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    /**
+     * @brief 进程当前的常驻内存，单位KB
+     */
+    inline long residentKB()
+    {
+        FILE *file = ::fopen("/proc/self/status", "r");
+        if (!file)
+            return 0;
+        char line[256];
+        long result = 0;
+        while (::fgets(line, sizeof(line), file))
+        {
+            if (::strncmp(line, "VmRSS:", 6) == 0)
+            {
+                result = ::atol(line + 6);
+                break;
+            }
+        }
+        ::fclose(file);
+        return result;
+    }
+}
+
+#endif //__MG_BENCH_UTIL_H__
@@ -0,0 +1,129 @@
+#include "tcp-server.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/**
+ * 连接风暴：客户端线程不停地建立连接，服务器在连接建立后立即关闭
+ * 每个连接都会经历一次channel的加入和删除，统计每秒完成的连接数以及每个eventloop平均的连接数
+ * 另外保持一批空闲连接，使channel表中始终有较多的fd
+ * 分别使用单个acceptor和每个sub-loop一个SO_REUSEPORT的acceptor运行，比较建立连接的速度
+ * 客户端和服务器在同一个进程中，另外统计服务器线程平均每个连接消耗的CPU时间，不受客户端线程的干扰
+ */
+
+static const uint16_t g_port = bench::freePort();
+
+static long cpuMicroSeconds(clockid_t clock)
+{
+    struct timespec now;
+    ::clock_gettime(clock, &now);
+    return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+static void runCase(bool reusePort, int loops, int clients, int total, int idles)
+{
+    mg::EventLoop loop("churn-bench");
+    mg::TcpServer server(&loop, mg::InternetAddress(g_port), "churn-bench");
+    server.setThreadNums(loops);
+    server.setReusePort(reusePort);
+    std::atomic<int> closed(0);
+    std::atomic<bool> storming(false);
+    server.setConnectionCallback([&](const mg::TcpConnectionPointer &connection)
+                                 {
+                                     if (connection->connected())
+                                     {
+                                         if (storming.load(std::memory_order_relaxed))
+                                             connection->forceClose();
+                                     }
+                                     else
+                                         closed.fetch_add(1, std::memory_order_relaxed); //
+                                 });
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          std::vector<int> idleFds;
+                          for (int i = 0; i < idles; i++)
+                          {
+                              int fd = bench::connectServer(g_port);
+                              if (fd >= 0)
+                                  idleFds.push_back(fd);
+                          }
+                          ::usleep(200 * 1000);
+                          storming = true;
+
+                          std::atomic<int> failed(0);
+                          std::atomic<long> clientCpu(0);
+                          std::vector<std::thread> threads;
+                          long processCpu = cpuMicroSeconds(CLOCK_PROCESS_CPUTIME_ID);
+                          long benchCpu = cpuMicroSeconds(CLOCK_THREAD_CPUTIME_ID);
+                          auto start = std::chrono::steady_clock::now();
+                          for (int i = 0; i < clients; i++)
+                          {
+                              threads.emplace_back([&]()
+                                                   {
+                                                       char buf[16];
+                                                       long cpu = cpuMicroSeconds(CLOCK_THREAD_CPUTIME_ID);
+                                                       for (int j = 0; j < total / clients; j++)
+                                                       {
+                                                           int fd = bench::connectServer(g_port);
+                                                           if (fd < 0)
+                                                           {
+                                                               failed++;
+                                                               continue;
+                                                           }
+                                                           // 等待服务器先关闭，客户端不进入TIME_WAIT
+                                                           while (::read(fd, buf, sizeof(buf)) > 0)
+                                                               ;
+                                                           ::close(fd);
+                                                       }
+                                                       clientCpu += cpuMicroSeconds(CLOCK_THREAD_CPUTIME_ID) - cpu; //
+                                                   });
+                          }
+                          for (auto &x : threads)
+                              x.join();
+                          int expected = total / clients * clients - failed;
+                          while (closed.load(std::memory_order_relaxed) < expected)
+                              std::this_thread::yield();
+                          auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+                          benchCpu = cpuMicroSeconds(CLOCK_THREAD_CPUTIME_ID) - benchCpu;
+                          long serverCpu = cpuMicroSeconds(CLOCK_PROCESS_CPUTIME_ID) - processCpu - benchCpu - clientCpu;
+
+                          ::printf("%s  loops %2d  clients %2d  idle %5zu  connections %7d  failed %5d  cost %9ld us  %10.0f conn/sec  %10.0f conn/sec/loop  server %6.2f us/conn\n",
+                                   reusePort ? "reuseport" : "acceptor ", loops, clients, idleFds.size(), expected, failed.load(), static_cast<long>(cost),
+                                   cost ? expected * 1e6 / cost : 0.0, cost ? expected * 1e6 / cost / (loops ? loops : 1) : 0.0,
+                                   expected ? static_cast<double>(serverCpu) / expected : 0.0);
+                          // 等待空闲连接也关闭后再退出
+                          for (int fd : idleFds)
+                              ::close(fd);
+                          while (closed.load(std::memory_order_relaxed) < expected + static_cast<int>(idleFds.size()))
+                              std::this_thread::yield();
+                          // 关闭回调之后连接还需要回到eventloop中销毁
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? ::atoi(argv[1]) : 1;
+    int clients = argc > 2 ? ::atoi(argv[2]) : 4;
+    int total = argc > 3 ? ::atoi(argv[3]) : 20000;
+    int idles = argc > 4 ? ::atoi(argv[4]) : 1000;
+
+    // 单个acceptor在mainloop中接受连接后转交给sub-loop，以及每个sub-loop使用自己的SO_REUSEPORT监听套接字
+    runCase(false, loops, clients, total, idles);
+    runCase(true, loops, clients, total, idles);
+    return 0;
+}
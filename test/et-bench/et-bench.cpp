@@ -0,0 +1,95 @@
+#include "tcp-server.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 大块数据传输：多个客户端连接不停地向服务器写数据，服务器只统计并丢弃
+ * 分别在水平触发和边沿触发模式下运行，比较吞吐量以及每次读回调平均处理的数据量
+ */
+
+static const uint16_t g_port = bench::freePort();
+
+static void runCase(bool edgeTriggered, int loops, int clients, long bytesPerClient)
+{
+    mg::EventLoop loop("et-bench");
+    mg::TcpServer server(&loop, mg::InternetAddress(g_port), "et-bench");
+    server.setThreadNums(loops);
+    server.setEdgeTriggered(edgeTriggered);
+    std::atomic<long> received(0), callbacks(0);
+    std::atomic<int> closed(0);
+    server.setConnectionCallback([&](const mg::TcpConnectionPointer &connection)
+                                 {
+                                     if (!connection->connected())
+                                         closed++; //
+                                 });
+    server.setMessageCallback([&](const mg::TcpConnectionPointer &connection, mg::Buffer *buffer, mg::TimeStamp)
+                              {
+                                  received.fetch_add(buffer->readableBytes(), std::memory_order_relaxed);
+                                  callbacks.fetch_add(1, std::memory_order_relaxed);
+                                  buffer->retrieveAllAsString(); //
+                              });
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          std::string chunk(256 * 1024, 'x');
+                          std::vector<std::thread> threads;
+                          auto start = std::chrono::steady_clock::now();
+                          for (int i = 0; i < clients; i++)
+                          {
+                              threads.emplace_back([&]()
+                                                   {
+                                                       int fd = bench::connectServer(g_port);
+                                                       if (fd < 0)
+                                                           return;
+                                                       long left = bytesPerClient;
+                                                       while (left > 0)
+                                                       {
+                                                           ssize_t len = ::write(fd, chunk.data(), std::min<long>(left, chunk.size()));
+                                                           if (len <= 0)
+                                                               break;
+                                                           left -= len;
+                                                       }
+                                                       ::close(fd); //
+                                                   });
+                          }
+                          for (auto &x : threads)
+                              x.join();
+                          while (closed.load() < clients)
+                              std::this_thread::yield();
+                          auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+                          long bytes = received.load();
+                          ::printf("%s  loops %2d  clients %3d  bytes %12ld  cost %9ld us  %9.1f MB/s  %8ld callbacks  %8.1f KB/callback\n",
+                                   edgeTriggered ? "ET" : "LT", loops, clients, bytes, static_cast<long>(cost),
+                                   cost ? bytes / 1048576.0 * 1e6 / cost : 0.0, callbacks.load(),
+                                   callbacks.load() ? bytes / 1024.0 / callbacks.load() : 0.0);
+                          // 关闭回调之后连接还需要回到eventloop中销毁
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? ::atoi(argv[1]) : 1;
+    int clients = argc > 2 ? ::atoi(argv[2]) : 4;
+    long megabytes = argc > 3 ? ::atol(argv[3]) : 256;
+
+    runCase(false, loops, clients, megabytes * 1048576 / clients);
+    runCase(true, loops, clients, megabytes * 1048576 / clients);
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "http-server.h"
+#include "http-parser.h"
+#include "event-loop.h"
+#include "buffer.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 第一部分只测试解析：缓冲区中放入大量典型的浏览器请求，逐个解析并取走，统计每个请求的耗时和内存分配次数
+ * 第二部分是类似wrk的压测：服务器和客户端在同一个进程中，每个客户端线程使用一个长连接，
+ * 发送请求后等待完整的应答再发送下一个，统计每秒完成的请求数
+ * bodySize大于0时应答使用该大小的共享数据体，模拟返回缓存的文件内容
+ */
+
+static std::atomic<long> g_allocations(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = ::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    ::free(p);
+}
+
+static const uint16_t g_port = bench::freePort();
+
+static const char g_request[] =
+    "GET /api/v1/users/10086/profile?fields=name%2Cavatar HTTP/1.1\r\n"
+    "Host: 127.0.0.1:19890\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+    "Content-Length: 0\r\n"
+    "\r\n";
+
+static void runParse(int requests)
+{
+    mg::Buffer buffer;
+    for (int i = 0; i < requests; i++)
+        buffer.append(g_request, sizeof(g_request) - 1);
+
+    mg::http::HttpRequest request;
+    size_t checksum = 0;
+    int parsed = 0;
+    long allocations = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        int ret = mg::http::parse(buffer, request);
+        if (ret < 0)
+            break;
+        checksum += request.getPath().size() + request.getHeader("user-agent").size();
+        buffer.retrieve(ret);
+        parsed++;
+    }
+    auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    allocations = g_allocations.load() - allocations;
+    ::printf("parse   requests %8d  %8.1f ns/request  %6.2f allocations/request  checksum %zu\n",
+             parsed, parsed ? static_cast<double>(cost) / parsed : 0.0,
+             parsed ? static_cast<double>(allocations) / parsed : 0.0, checksum);
+}
+
+static void runLoad(int loops, int clients, int seconds, int bodySize)
+{
+    mg::SharedBuffer shared = std::make_shared<const std::string>(bodySize, 'x');
+    mg::EventLoop loop("http-bench");
+    mg::HttpServer server(&loop, mg::InternetAddress(g_port), "http-bench");
+    server.setThreadNums(loops);
+    server.setMessageCallback([&](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                              {
+                                  mg::http::HttpResponse response;
+                                  response.setStatus(mg::http::HttpStatus::OK);
+                                  response.setHeader("Content-Type", "text/plain");
+                                  if (bodySize > 0)
+                                      response.setSharedBody(shared);
+                                  else
+                                      response.setBody(request->getPath() == "/api/v1/users/10086/profile?fields=name,avatar" ? "hello" : "wrong");
+                                  link->send(response); //
+                              });
+    server.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    server.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          std::atomic<long> completed(0);
+                          std::atomic<long> failed(0);
+                          std::atomic<bool> running(true);
+                          std::vector<std::thread> threads;
+                          long allocations = g_allocations.load();
+                          auto start = std::chrono::steady_clock::now();
+                          for (int i = 0; i < clients; i++)
+                          {
+                              threads.emplace_back([&]()
+                                                   {
+                                                       int fd = bench::connectServer(g_port);
+                                                       if (fd < 0)
+                                                       {
+                                                           failed++;
+                                                           return;
+                                                       }
+                                                       std::string pending;
+                                                       long done = 0;
+                                                       while (running.load(std::memory_order_relaxed))
+                                                       {
+                                                           if (::write(fd, g_request, sizeof(g_request) - 1) != sizeof(g_request) - 1 ||
+                                                               !bench::readResponse(fd, pending, nullptr, nullptr))
+                                                           {
+                                                               failed++;
+                                                               break;
+                                                           }
+                                                           done++;
+                                                       }
+                                                       completed += done;
+                                                       ::close(fd); //
+                                                   });
+                          }
+                          std::this_thread::sleep_for(std::chrono::seconds(seconds));
+                          running = false;
+                          for (auto &x : threads)
+                              x.join();
+                          auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+                          allocations = g_allocations.load() - allocations;
+                          long total = completed.load();
+                          ::printf("load    loops %2d  clients %3d  body %7d  requests %9ld  failed %3ld  %10.0f requests/sec  %6.2f allocations/request\n",
+                                   loops, clients, bodySize, total, failed.load(), cost ? total * 1e6 / cost : 0.0,
+                                   total ? static_cast<double>(allocations) / total : 0.0);
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+}
+
+int main(int argc, char *argv[])
+{
+    int requests = argc > 1 ? ::atoi(argv[1]) : 200000;
+    int loops = argc > 2 ? ::atoi(argv[2]) : 1;
+    int clients = argc > 3 ? ::atoi(argv[3]) : 8;
+    int seconds = argc > 4 ? ::atoi(argv[4]) : 5;
+    int bodySize = argc > 5 ? ::atoi(argv[5]) : 0;
+
+    runParse(requests);
+    runLoad(loops, clients, seconds, bodySize);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "http-server.h"
+#include "http-parser.h"
+#include "event-loop.h"
+#include "threadpool.h"
+#include "../bench-util.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 服务器收到请求后交给线程池处理，处理时间随机，应答通过请求序号乱序完成
+ * 每个客户端线程使用一个长连接，一次写出depth个请求，然后按顺序读取depth个应答，
+ * 检查每个应答的内容是否对应同一位置的请求，比较depth为1和depth为指定值时每秒完成的请求数
+ * 最后检查Connection: close和HTTP/1.0 keep-alive的处理，以及流水线请求超过上限并且缓冲区过大暂停读之后能够恢复
+ */
+
+static const uint16_t g_port = bench::freePort();
+static const size_t g_largeBody = 16 * 1024 * 1024;
+static const int g_stalledRequests = 80;           // 超过默认的流水线上限，合计也超过读缓冲区的上限
+static const size_t g_stalledBody = 200 * 1024;
+
+/**
+ * @brief 服务器是否已经关闭了连接，最多等待5秒
+ */
+static bool isClosed(int fd, std::string &pending)
+{
+    if (!pending.empty())
+        return false;
+    struct timeval timeout = {5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char buf[256];
+    return ::read(fd, buf, sizeof(buf)) == 0;
+}
+
+static std::string makeRequest(const std::string &path, const char *version = "HTTP/1.1", const char *connection = nullptr)
+{
+    std::string request = "GET " + path + " " + version + "\r\nHost: 127.0.0.1\r\n";
+    if (connection)
+        request += std::string("Connection: ") + connection + "\r\n";
+    return request + "\r\n";
+}
+
+static void runLoad(int clients, int depth, int seconds)
+{
+    std::atomic<long> completed(0);
+    std::atomic<long> failed(0);
+    std::atomic<long> misordered(0);
+    std::atomic<bool> running(true);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < clients; i++)
+    {
+        threads.emplace_back([&, i]()
+                             {
+                                 int fd = bench::connectServer(g_port);
+                                 if (fd < 0)
+                                 {
+                                     failed++;
+                                     return;
+                                 }
+                                 std::string pending, head, body, batch;
+                                 long done = 0, next = 0;
+                                 while (running.load(std::memory_order_relaxed))
+                                 {
+                                     batch.clear();
+                                     for (int j = 0; j < depth; j++)
+                                         batch += makeRequest("/item/" + std::to_string(i) + "/" + std::to_string(next + j));
+                                     if (!bench::writeAll(fd, batch))
+                                     {
+                                         failed++;
+                                         break;
+                                     }
+                                     bool ok = true;
+                                     for (int j = 0; j < depth; j++)
+                                     {
+                                         if (!bench::readResponse(fd, pending, head, body))
+                                         {
+                                             failed++;
+                                             ok = false;
+                                             break;
+                                         }
+                                         if (body != "/item/" + std::to_string(i) + "/" + std::to_string(next + j))
+                                             misordered++;
+                                         done++;
+                                     }
+                                     if (!ok)
+                                         break;
+                                     next += depth;
+                                 }
+                                 completed += done;
+                                 ::close(fd); //
+                             });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto &x : threads)
+        x.join();
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    long total = completed.load();
+    ::printf("load    clients %3d  depth %3d  requests %9ld  failed %3ld  misordered %3ld  %10.0f requests/sec\n",
+             clients, depth, total, failed.load(), misordered.load(), cost ? total * 1e6 / cost : 0.0);
+}
+
+static void runChecks()
+{
+    std::string pending, head, body;
+
+    // 第二个请求在close之后，不应该被处理
+    int fd = bench::connectServer(g_port);
+    bench::writeAll(fd, makeRequest("/close/1", "HTTP/1.1", "close") + makeRequest("/close/2"));
+    bool ok = bench::readResponse(fd, pending, head, body) && body == "/close/1" &&
+              head.find("Connection: close") != std::string::npos && isClosed(fd, pending);
+    bench::check("HTTP/1.1 Connection: close", ok);
+    ::close(fd);
+
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    bench::writeAll(fd, makeRequest("/v10", "HTTP/1.0"));
+    ok = bench::readResponse(fd, pending, head, body) && head.find("Connection: close") != std::string::npos && isClosed(fd, pending);
+    bench::check("HTTP/1.0 closes by default", ok);
+    ::close(fd);
+
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    bench::writeAll(fd, makeRequest("/v10/1", "HTTP/1.0", "Keep-Alive"));
+    ok = bench::readResponse(fd, pending, head, body) && head.find("Connection: keep-alive") != std::string::npos;
+    bench::writeAll(fd, makeRequest("/v10/2", "HTTP/1.0", "keep-alive"));
+    ok = ok && bench::readResponse(fd, pending, head, body) && body == "/v10/2";
+    bench::check("HTTP/1.0 Connection: keep-alive", ok);
+    ::close(fd);
+
+    // 应答远大于套接字发送缓冲区，写队列发送完之后才能关闭写端
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    bench::writeAll(fd, makeRequest("/large/1", "HTTP/1.1", "close"));
+    ok = bench::readResponse(fd, pending, head, body) && body.size() == g_largeBody && isClosed(fd, pending);
+    bench::check("large response with Connection: close", ok);
+    ::close(fd);
+
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    bench::writeAll(fd, makeRequest("/large/2", "HTTP/1.0"));
+    ok = bench::readResponse(fd, pending, head, body) && body.size() == g_largeBody && isClosed(fd, pending);
+    bench::check("large HTTP/1.0 response closes afterwards", ok);
+    ::close(fd);
+
+    // 应答较慢时请求堆积在读缓冲区中，服务器暂停读，前面的应答完成之后继续处理剩余的请求并恢复读
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    std::thread writer([fd]()
+                       {
+                           std::string content(g_stalledBody, 'x');
+                           for (int i = 0; i < g_stalledRequests; i++)
+                           {
+                               std::string request = "POST /slow/" + std::to_string(i) + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " +
+                                                     std::to_string(content.size()) + "\r\n\r\n" + content;
+                               if (!bench::writeAll(fd, request))
+                                   return;
+                           } //
+                       });
+    struct timeval timeout = {5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int answered = 0;
+    while (answered < g_stalledRequests && bench::readResponse(fd, pending, head, body) && body == "/slow/" + std::to_string(answered))
+        answered++;
+    // 服务器不再读取时写线程阻塞在write中，关闭连接让它返回
+    ::shutdown(fd, SHUT_RDWR);
+    writer.join();
+    bench::check("stalled pipeline resumes reading", answered == g_stalledRequests);
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? ::atoi(argv[1]) : 1;
+    int workers = argc > 2 ? ::atoi(argv[2]) : 4;
+    int clients = argc > 3 ? ::atoi(argv[3]) : 8;
+    int depth = argc > 4 ? ::atoi(argv[4]) : 16;
+    int seconds = argc > 5 ? ::atoi(argv[5]) : 5;
+    int limit = argc > 6 ? ::atoi(argv[6]) : depth; // 小于depth时服务器会暂停解析，等待前面的应答
+
+    // 检查中服务器可能先关闭连接
+    ::signal(SIGPIPE, SIG_IGN);
+
+    mg::ThreadPool pool("http-pipeline-bench");
+    pool.start(workers);
+
+    mg::EventLoop loop("http-pipeline-bench");
+    mg::HttpServer server(&loop, mg::InternetAddress(g_port), "http-pipeline-bench");
+    server.setThreadNums(loops);
+    server.setMaxPipelineRequests(limit);
+    server.setMessageCallback([&](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                              {
+                                  uint64_t sequence = request->getSequence();
+                                  std::string path = request->getPath().toString();
+                                  pool.append([link, sequence, path]()
+                                              {
+                                                  // 随机的处理时间让应答乱序完成
+                                                  if (path.compare(0, 6, "/slow/") == 0)
+                                                      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                                                  else if (::rand() % 4 == 0)
+                                                      std::this_thread::sleep_for(std::chrono::microseconds(::rand() % 200));
+                                                  mg::http::HttpResponse response;
+                                                  response.setStatus(mg::http::HttpStatus::OK);
+                                                  response.setHeader("Content-Type", "text/plain");
+                                                  if (path.compare(0, 7, "/large/") == 0)
+                                                      response.setBody(std::string(g_largeBody, 'x'));
+                                                  else
+                                                      response.setBody(path);
+                                                  link->send(sequence, std::move(response)); //
+                                              }); //
+                              });
+    server.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    server.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          runLoad(clients, 1, seconds);
+                          runLoad(clients, depth, seconds);
+                          runChecks();
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+    pool.stop();
+    return 0;
+}
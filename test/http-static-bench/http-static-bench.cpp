@@ -0,0 +1,264 @@
+#include "http-server.h"
+#include "http-parser.h"
+#include "http-static-files.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 在临时目录中生成一个小文件和一个大文件，/copy/沿用test/http/echo-server.cpp的做法，
+ * 启动时把文件读进std::string，每次应答拷贝一份数据体；/static/使用HttpStaticFiles，
+ * 小文件引用缓存的内容，大文件用sendfile从页缓存发送
+ * 多个客户端线程使用长连接逐个请求，比较两种方式的每秒请求数、吞吐量和进程的最大常驻内存
+ * 最后检查304、Range、HEAD、路径越界和文件修改之后的重新加载
+ */
+
+static const uint16_t g_port = bench::freePort();
+
+/**
+ * @brief 读取一个应答，HEAD请求的应答没有数据体；body为空时只统计数据体的长度
+ */
+static bool readResponse(int fd, std::string &pending, std::string &head, std::string *body, size_t &length, bool headOnly = false)
+{
+    if (!bench::readHead(fd, pending, head))
+        return false;
+    length = bench::contentLength(head);
+    if (headOnly)
+        return true;
+
+    char buf[65536];
+    size_t remain = length;
+    size_t take = std::min(remain, pending.size());
+    if (body)
+        body->assign(pending, 0, take);
+    pending.erase(0, take);
+    remain -= take;
+    while (remain)
+    {
+        ssize_t n = ::read(fd, buf, std::min(sizeof(buf), remain));
+        if (n <= 0)
+            return false;
+        if (body)
+            body->append(buf, n);
+        remain -= n;
+    }
+    return true;
+}
+
+static std::string request(const std::string &path, const std::string &headers = "", const char *method = "GET")
+{
+    return std::string(method) + " " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + headers + "\r\n";
+}
+
+static void runClients(const char *name, const std::string &path, size_t fileSize, int clients, double seconds)
+{
+    std::atomic<long> requests(0);
+    std::atomic<long> failures(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(static_cast<long>(seconds * 1000));
+    for (int i = 0; i < clients; i++)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 int fd = bench::connectServer(g_port);
+                                 std::string message = request(path), pending, head;
+                                 long done = 0;
+                                 while (std::chrono::steady_clock::now() < deadline)
+                                 {
+                                     size_t length = 0;
+                                     if (!bench::writeAll(fd, message) || !readResponse(fd, pending, head, nullptr, length) || length != fileSize)
+                                     {
+                                         failures++;
+                                         break;
+                                     }
+                                     done++;
+                                 }
+                                 requests += done;
+                                 ::close(fd); //
+                             });
+    }
+    for (auto &x : threads)
+        x.join();
+    double cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1e6;
+    ::printf("%-8s %-22s %8.0f req/s  %9.1f MB/s  failures %ld  max rss %ld KB\n", name, path.c_str(), requests / cost,
+             requests * static_cast<double>(fileSize) / 1048576.0 / cost, failures.load(), bench::maxRss());
+}
+
+static bool exchange(int fd, const std::string &message, std::string &head, std::string &body, bool headOnly = false)
+{
+    std::string pending;
+    size_t length = 0;
+    body.clear();
+    return bench::writeAll(fd, message) && readResponse(fd, pending, head, &body, length, headOnly) && pending.empty();
+}
+
+static std::string headerOf(const std::string &head, const char *name)
+{
+    std::string key = std::string("\r\n") + name + ": ";
+    const char *found = ::strcasestr(head.c_str(), key.c_str());
+    if (!found)
+        return std::string();
+    const char *value = found + key.size();
+    return std::string(value, ::strstr(value, "\r\n") - value);
+}
+
+static void runChecks(const std::string &dir, const std::string &small, const std::string &large)
+{
+    int fd = bench::connectServer(g_port);
+    std::string head, body;
+
+    bool ok = exchange(fd, request("/static/small.html"), head, body) && head.find(" 200 ") != std::string::npos &&
+              body == small && headerOf(head, "Content-Type") == "text/html; charset=utf-8";
+    bench::check("small file from the cache", ok);
+    std::string etag = headerOf(head, "ETag");
+    std::string lastModified = headerOf(head, "Last-Modified");
+
+    ok = exchange(fd, request("/static/small.html", "If-None-Match: " + etag + "\r\n"), head, body) &&
+         head.find(" 304 ") != std::string::npos && body.empty() && headerOf(head, "Content-Length").empty();
+    bench::check("If-None-Match answers 304 without a body", ok);
+
+    ok = exchange(fd, request("/static/small.html", "If-Modified-Since: " + lastModified + "\r\n"), head, body) &&
+         head.find(" 304 ") != std::string::npos;
+    bench::check("If-Modified-Since answers 304", ok);
+
+    ok = exchange(fd, request("/static/small.html", "If-None-Match: \"other\"\r\n"), head, body) &&
+         head.find(" 200 ") != std::string::npos && body == small;
+    bench::check("stale If-None-Match answers 200", ok);
+
+    ok = exchange(fd, request("/static/large.bin", "Range: bytes=1000-1999\r\n"), head, body) &&
+         head.find(" 206 ") != std::string::npos && body == large.substr(1000, 1000) &&
+         headerOf(head, "Content-Range") == "bytes 1000-1999/" + std::to_string(large.size());
+    bench::check("Range of a large file answers 206 via sendfile", ok);
+
+    ok = exchange(fd, request("/static/large.bin", "Range: bytes=-100\r\n"), head, body) &&
+         head.find(" 206 ") != std::string::npos && body == large.substr(large.size() - 100);
+    bench::check("suffix Range returns the last bytes", ok);
+
+    ok = exchange(fd, request("/static/small.html", "Range: bytes=10-\r\n"), head, body) &&
+         head.find(" 206 ") != std::string::npos && body == small.substr(10);
+    bench::check("open-ended Range of a cached file", ok);
+
+    ok = exchange(fd, request("/static/small.html", "Range: bytes=10-20\r\nIf-Range: \"other\"\r\n"), head, body) &&
+         head.find(" 200 ") != std::string::npos && body == small;
+    bench::check("mismatched If-Range returns the whole file", ok);
+
+    ok = exchange(fd, request("/static/small.html", "Range: bytes=999999-\r\n"), head, body) &&
+         head.find(" 416 ") != std::string::npos && headerOf(head, "Content-Range") == "bytes */" + std::to_string(small.size());
+    bench::check("unsatisfiable Range answers 416", ok);
+
+    ok = exchange(fd, request("/static/large.bin", "", "HEAD"), head, body, true) &&
+         headerOf(head, "Content-Length") == std::to_string(large.size()) &&
+         exchange(fd, request("/static/small.html"), head, body) && body == small;
+    bench::check("HEAD sends the length without a body", ok);
+
+    ok = exchange(fd, request("/static/../http-static-bench.cpp"), head, body) && head.find(" 404 ") != std::string::npos &&
+         exchange(fd, request("/static/missing.txt"), head, body) && head.find(" 404 ") != std::string::npos;
+    bench::check("path traversal and missing files answer 404", ok);
+
+    // 修改文件并等待超过重新检查的间隔
+    ::usleep(20 * 1000);
+    std::string changed = "changed " + small.substr(0, 100);
+    std::ofstream(dir + "/small.html", std::ios::trunc) << changed;
+    ::usleep(150 * 1000);
+    ok = exchange(fd, request("/static/small.html"), head, body) && body == changed && headerOf(head, "ETag") != etag;
+    bench::check("modified file is reloaded after revalidation", ok);
+
+    std::string pending;
+    size_t length = 0;
+    std::string first, second;
+    ok = bench::writeAll(fd, request("/static/large.bin") + request("/static/small.html")) &&
+         readResponse(fd, pending, head, &first, length) && readResponse(fd, pending, head, &second, length) &&
+         first == large && second == changed;
+    bench::check("pipelined sendfile and cached responses stay in order", ok);
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t smallSize = argc > 1 ? ::atoi(argv[1]) : 10 * 1024;
+    size_t largeSize = (argc > 2 ? ::atoi(argv[2]) : 16) * 1024 * 1024;
+    int clients = argc > 3 ? ::atoi(argv[3]) : 4;
+    double seconds = argc > 4 ? ::atof(argv[4]) : 3;
+
+    ::signal(SIGPIPE, SIG_IGN);
+    char dirTemplate[] = "/tmp/http-static-bench-XXXXXX";
+    std::string dir = ::mkdtemp(dirTemplate);
+    std::string small(smallSize, '\0'), large(largeSize, '\0');
+    for (size_t i = 0; i < small.size(); i++)
+        small[i] = 'a' + i % 26;
+    for (size_t i = 0; i < large.size(); i++)
+        large[i] = static_cast<char>(i * 2654435761u >> 13);
+    std::ofstream(dir + "/small.html") << small;
+    std::ofstream(dir + "/large.bin", std::ios::binary) << large;
+
+    // 与echo-server相同，文件内容读进std::string之后每次应答拷贝
+    std::string smallCopy, largeCopy;
+    {
+        std::ifstream file(dir + "/small.html");
+        smallCopy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::ifstream binary(dir + "/large.bin", std::ios::binary);
+        largeCopy.assign(std::istreambuf_iterator<char>(binary), std::istreambuf_iterator<char>());
+    }
+
+    mg::http::HttpStaticFiles files(dir, "/static/");
+    files.setRevalidateInterval(0.1);
+
+    mg::EventLoop loop("http-static-bench");
+    mg::HttpServer server(&loop, mg::InternetAddress(g_port), "http-static-bench");
+    server.setThreadNums(1);
+    server.setMessageCallback([&](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                              {
+                                  if (files.handle(link, request))
+                                      return;
+                                  mg::http::HttpResponse response;
+                                  if (request->getPath() == "/copy/small.html")
+                                  {
+                                      response.setHeader("Content-Type", "text/html");
+                                      response.setBody(smallCopy);
+                                  }
+                                  else if (request->getPath() == "/copy/large.bin")
+                                  {
+                                      response.setHeader("Content-Type", "application/octet-stream");
+                                      response.setBody(largeCopy);
+                                  }
+                                  else
+                                      response.setStatus(mg::http::HttpStatus::NOT_FOUND);
+                                  link->send(response); //
+                              });
+    server.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    server.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          ::printf("start    small %zu bytes, large %zu MB, %d clients, max rss %ld KB\n",
+                                   smallSize, largeSize >> 20, clients, bench::maxRss());
+                          runClients("copy", "/copy/small.html", smallSize, clients, seconds);
+                          runClients("static", "/static/small.html", smallSize, clients, seconds);
+                          runClients("copy", "/copy/large.bin", largeSize, clients, seconds);
+                          runClients("static", "/static/large.bin", largeSize, clients, seconds);
+                          runChecks(dir, small, large);
+                          ::printf("cached files %zu\n", files.cachedFiles());
+                          ::unlink((dir + "/small.html").c_str());
+                          ::unlink((dir + "/large.bin").c_str());
+                          ::rmdir(dir.c_str());
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+    return 0;
+}
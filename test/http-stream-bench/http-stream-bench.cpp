@@ -0,0 +1,250 @@
+#include "http-server.h"
+#include "http-parser.h"
+#include "http-response-writer.h"
+#include "picohttpparser.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * 服务器生成一个很大的CSV应答，/stream使用HttpResponseWriter分块写出，写队列超过流式应答的高水位（默认1MB）时暂停生产，
+ * /materialize先在内存中构造完整的数据体再发送，比较两种方式的速度和进程的最大常驻内存
+ * 最后检查HTTP/1.0的流式应答以关闭连接结束，/bulk一次写出远大于发送缓冲区的数据后立即结束，连接也要在发送完之后关闭，
+ * 以及流式应答之后流水线中的请求按顺序应答
+ */
+
+static const uint16_t g_port = bench::freePort();
+static const size_t g_rowSize = 64;
+
+/**
+ * @brief 第i行CSV，固定长度
+ */
+static void makeRow(size_t i, char *row)
+{
+    int n = ::snprintf(row, g_rowSize, "%zu,user-%zu,%zu", i, i * 7, i * 13);
+    ::memset(row + n, ' ', g_rowSize - 1 - n);
+    row[g_rowSize - 1] = '\n';
+}
+
+static size_t rowsOf(const mg::http::HttpRequest *request)
+{
+    mg::StringView path = request->getPath();
+    size_t pos = path.find('?');
+    return pos == std::string::npos ? 0 : ::strtoull(path.substr(pos + 1).toString().c_str(), nullptr, 10);
+}
+
+/**
+ * @brief 一次生产一批行，直到写队列超过高水位
+ */
+struct Export
+{
+    mg::http::HttpResponseWriterPointer writer;
+    size_t next;
+    size_t rows;
+
+    void produce()
+    {
+        while (this->next < this->rows && this->writer->writable())
+        {
+            size_t count = std::min<size_t>(1024, this->rows - this->next);
+            std::string batch(count * g_rowSize, '\0');
+            for (size_t i = 0; i < count; i++)
+                makeRow(this->next + i, &batch[i * g_rowSize]);
+            this->next += count;
+            this->writer->write(std::move(batch));
+        }
+        if (this->next == this->rows)
+            this->writer->end();
+    }
+};
+
+/**
+ * @brief 读取数据体，按照分块编码、Content-Length或者关闭连接判断结束，只统计长度和校验和
+ */
+static bool readBody(int fd, const std::string &head, std::string &pending, size_t &total, uint64_t &sum)
+{
+    bool chunked = ::strcasestr(head.c_str(), "transfer-encoding: chunked") != nullptr;
+    const char *header = ::strcasestr(head.c_str(), "\r\ncontent-length:");
+    size_t length = header ? ::strtoull(header + 17, nullptr, 10) : SIZE_MAX;
+    struct phr_chunked_decoder decoder = {};
+    decoder.consume_trailer = 1;
+    total = 0;
+    sum = 0;
+    std::string data;
+    data.swap(pending);
+    char buf[65536];
+    while (true)
+    {
+        if (chunked)
+        {
+            size_t size = data.size();
+            ssize_t ret = ::phr_decode_chunked(&decoder, &data[0], &size);
+            if (ret == -1)
+                return false;
+            for (size_t i = 0; i < size; i++)
+                sum = sum * 31 + static_cast<unsigned char>(data[i]);
+            total += size;
+            if (ret >= 0)
+            {
+                pending = data.substr(size, ret);
+                return true;
+            }
+            data.clear();
+        }
+        else
+        {
+            size_t size = std::min(data.size(), length - total);
+            for (size_t i = 0; i < size; i++)
+                sum = sum * 31 + static_cast<unsigned char>(data[i]);
+            total += size;
+            if (total == length)
+            {
+                pending = data.substr(size);
+                return true;
+            }
+            data.clear();
+        }
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0)
+            return false;
+        if (n == 0)
+            return length == SIZE_MAX && !chunked;
+        data.append(buf, n);
+    }
+}
+
+static uint64_t expectedSum(size_t rows)
+{
+    uint64_t sum = 0;
+    char row[g_rowSize];
+    for (size_t i = 0; i < rows; i++)
+    {
+        makeRow(i, row);
+        for (size_t j = 0; j < g_rowSize; j++)
+            sum = sum * 31 + static_cast<unsigned char>(row[j]);
+    }
+    return sum;
+}
+
+static void runDownload(const char *path, size_t rows)
+{
+    int fd = bench::connectServer(g_port);
+    auto start = std::chrono::steady_clock::now();
+    bench::writeAll(fd, std::string("GET ") + path + "?" + std::to_string(rows) + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    std::string pending, head;
+    size_t total = 0;
+    uint64_t sum = 0;
+    bool ok = bench::readHead(fd, pending, head) && readBody(fd, head, pending, total, sum);
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    ok = ok && total == rows * g_rowSize && sum == expectedSum(rows);
+    ::printf("%-12s %6zu MB  %8.1f MB/s  result %s  max rss %ld KB\n", path + 1, total >> 20,
+             cost ? (total / 1048576.0) * 1e6 / cost : 0.0, ok ? "ok" : "FAILED", bench::maxRss());
+    ::close(fd);
+}
+
+static void runChecks()
+{
+    size_t total = 0;
+    uint64_t sum = 0;
+    std::string pending, head;
+    int fd = bench::connectServer(g_port);
+    bench::writeAll(fd, "GET /stream?1000 HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n");
+    bool ok = bench::readHead(fd, pending, head) && head.find("chunked") == std::string::npos &&
+              readBody(fd, head, pending, total, sum) && total == 1000 * g_rowSize && sum == expectedSum(1000);
+    bench::check("HTTP/1.0 stream ends by closing the connection", ok);
+    ::close(fd);
+
+    // 远大于套接字发送缓冲区，写队列发送完之后才能关闭连接，最多等待5秒
+    size_t rows = (16 << 20) / g_rowSize;
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    struct timeval timeout = {5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    bench::writeAll(fd, "GET /bulk?" + std::to_string(rows) + " HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n");
+    ok = bench::readHead(fd, pending, head) && readBody(fd, head, pending, total, sum) && total == rows * g_rowSize &&
+         sum == expectedSum(rows);
+    bench::check("large HTTP/1.0 stream ends by closing the connection", ok);
+    ::close(fd);
+
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    bench::writeAll(fd, "GET /stream?20000 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                 "GET /materialize?10 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                 "GET /stream?0 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    ok = bench::readHead(fd, pending, head) && readBody(fd, head, pending, total, sum) && total == 20000 * g_rowSize &&
+         bench::readHead(fd, pending, head) && readBody(fd, head, pending, total, sum) && total == 10 * g_rowSize &&
+         bench::readHead(fd, pending, head) && readBody(fd, head, pending, total, sum) && total == 0;
+    bench::check("pipelined responses after a stream stay in order", ok);
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t streamMegabytes = argc > 1 ? ::atoi(argv[1]) : 1024;
+    size_t materializeMegabytes = argc > 2 ? ::atoi(argv[2]) : 256;
+
+    mg::EventLoop loop("http-stream-bench");
+    mg::HttpServer server(&loop, mg::InternetAddress(g_port), "http-stream-bench");
+    server.setThreadNums(1);
+    // 不设置时使用默认的1MB，流式应答的内存不依赖连接的高水位
+    if (argc > 3)
+        server.setStreamHighWaterMark(::atoi(argv[3]));
+    server.setMessageCallback([](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                              {
+                                  size_t rows = rowsOf(request);
+                                  mg::http::HttpResponse response;
+                                  response.setHeader("Content-Type", "text/csv");
+                                  if (request->getPath().substr(0, 8) == "/stream?")
+                                  {
+                                      std::shared_ptr<Export> state = std::make_shared<Export>();
+                                      state->writer = link->startResponse(request->getSequence(), response);
+                                      state->next = 0;
+                                      state->rows = rows;
+                                      // 回调持有state，应答结束或者连接断开时writer释放回调
+                                      state->writer->setWritableCallback([state]()
+                                                                         { state->produce(); });
+                                      return;
+                                  }
+                                  std::string body(rows * g_rowSize, '\0');
+                                  for (size_t i = 0; i < rows; i++)
+                                      makeRow(i, &body[i * g_rowSize]);
+                                  if (request->getPath().substr(0, 6) == "/bulk?")
+                                  {
+                                      // 一次写出全部数据之后立即结束，结束时写队列中还有大量数据
+                                      mg::http::HttpResponseWriterPointer writer = link->startResponse(request->getSequence(), response);
+                                      writer->write(std::move(body));
+                                      writer->end();
+                                      return;
+                                  }
+                                  response.setBody(std::move(body));
+                                  link->send(std::move(response)); //
+                              });
+    server.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    server.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          ::printf("start        max rss %ld KB\n", bench::maxRss());
+                          runDownload("/stream", (streamMegabytes << 20) / g_rowSize);
+                          runDownload("/materialize", (materializeMegabytes << 20) / g_rowSize);
+                          runChecks();
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include "http-server.h"
+#include "http-parser.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 客户端上传大请求体，分别使用Content-Length和Transfer-Encoding: chunked，
+ * 服务器通过HttpBodyCallback分段接收，计算长度和校验和后回应，统计上传速度和进程的最大常驻内存
+ * 路径为/slow时服务器每收到一段就暂停读取1ms，模拟处理速度跟不上上传速度
+ * 最后检查没有设置请求体回调时小的分块请求体、分块请求之后流水线中的请求，以及超过缓冲区上限的请求体，
+ * 还有排在较慢的请求之后的Expect: 100-continue请求在轮到它时收到100 Continue
+ */
+
+static const uint16_t g_port = bench::freePort();
+static const uint16_t g_bufferedPort = bench::freePort(); // 没有设置请求体回调的服务器
+
+static uint64_t checksum(const char *data, size_t len, uint64_t sum)
+{
+    for (size_t i = 0; i < len; i++)
+        sum = sum * 31 + static_cast<unsigned char>(data[i]);
+    return sum;
+}
+
+static void runUpload(size_t total, bool chunked, bool slow = false)
+{
+    std::string piece(64 * 1024, 0);
+    for (size_t i = 0; i < piece.size(); i++)
+        piece[i] = static_cast<char>('a' + i % 26);
+    uint64_t expected = 0;
+    for (size_t sent = 0; sent < total; sent += piece.size())
+        expected = checksum(piece.data(), std::min(piece.size(), total - sent), expected);
+
+    int fd = bench::connectServer(g_port);
+    if (fd < 0)
+    {
+        ::printf("connect failed\n");
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string head = slow ? "POST /slow HTTP/1.1\r\nHost: 127.0.0.1\r\n" : "POST /upload HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+    head += chunked ? "Transfer-Encoding: chunked\r\n\r\n" : "Content-Length: " + std::to_string(total) + "\r\n\r\n";
+    bool ok = bench::writeAll(fd, head);
+    char size[32];
+    for (size_t sent = 0; ok && sent < total; sent += piece.size())
+    {
+        size_t len = std::min(piece.size(), total - sent);
+        if (chunked)
+        {
+            int n = ::snprintf(size, sizeof(size), "%zx\r\n", len);
+            ok = bench::writeAll(fd, size, n) && bench::writeAll(fd, piece.data(), len) && bench::writeAll(fd, "\r\n", 2);
+        }
+        else
+            ok = bench::writeAll(fd, piece.data(), len);
+    }
+    if (ok && chunked)
+        ok = bench::writeAll(fd, "0\r\n\r\n", 5);
+
+    std::string pending, responseHead, body;
+    ok = ok && bench::readResponse(fd, pending, responseHead, body);
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::string want = std::to_string(total) + " " + std::to_string(expected);
+    ::printf("upload  %-19s %6zu MB  %8.1f MB/s  result %s  max rss %ld KB\n",
+             chunked ? "chunked" : (slow ? "content-length slow" : "content-length"), total >> 20, cost ? (total / 1048576.0) * 1e6 / cost : 0.0,
+             ok && body == want ? "ok" : "FAILED", bench::maxRss());
+    ::close(fd);
+}
+
+/**
+ * @brief 非法请求没有应答，连接直接被关闭
+ */
+static bool rejected(const std::string &message)
+{
+    int fd = bench::connectServer(g_bufferedPort);
+    bench::writeAll(fd, message);
+    char buf[64];
+    bool closed = ::read(fd, buf, sizeof(buf)) <= 0;
+    ::close(fd);
+    return closed;
+}
+
+/**
+ * @brief 没有设置请求体回调的服务器
+ */
+static void runChecks()
+{
+    std::string pending, head, body;
+    int fd = bench::connectServer(g_bufferedPort);
+    bench::writeAll(fd, "POST /small HTTP/1.1\r\nHost: 127.0.0.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "5\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n"
+                 "GET /next HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n");
+    bool ok = bench::readResponse(fd, pending, head, body) && body == "hello world";
+    bench::check("buffered chunked body", ok);
+    ok = bench::readResponse(fd, pending, head, body) && body == "/next";
+    bench::check("pipelined request after chunked body", ok);
+    ::close(fd);
+
+    fd = bench::connectServer(g_bufferedPort);
+    pending.clear();
+    bench::writeAll(fd, "POST /huge HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 104857600\r\n\r\n");
+    ok = bench::readResponse(fd, pending, head, body) && head.find(" 413 ") != std::string::npos;
+    bench::check("body over buffer limit is rejected with 413", ok);
+    ::close(fd);
+
+    bench::check("Content-Length with chunked is rejected",
+          rejected("POST /both HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n"));
+    // 2^64回绕成0时后面的数据会被当作第二个请求
+    bench::check("overflowing Content-Length is rejected",
+          rejected("POST /overflow HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 18446744073709551616\r\n\r\n"
+                   "GET /smuggled HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"));
+    bench::check("chunked before another coding is rejected",
+          rejected("POST /coding HTTP/1.1\r\nHost: 127.0.0.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n0\r\n\r\n"));
+    bench::check("coding other than bare chunked is rejected",
+          rejected("POST /coding HTTP/1.1\r\nHost: 127.0.0.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n0\r\n\r\n"));
+
+    // 前一个请求稍后才应答，解析到Expect请求时还不能发送100 Continue，要等前面的应答写出之后再发送
+    fd = bench::connectServer(g_port);
+    pending.clear();
+    struct timeval timeout = {2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string content(100000, 'x');
+    bench::writeAll(fd, "GET /delay HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+                 "POST /expect HTTP/1.1\r\nHost: 127.0.0.1\r\nExpect: 100-continue\r\nContent-Length: " +
+                     std::to_string(content.size()) + "\r\n\r\n");
+    ok = bench::readResponse(fd, pending, head, body) && body == "/delay" &&
+         bench::readResponse(fd, pending, head, body) && head.find(" 100 Continue") != std::string::npos &&
+         bench::writeAll(fd, content) && bench::readResponse(fd, pending, head, body) && body.compare(0, 7, "100000 ") == 0;
+    bench::check("100 Continue after the earlier response", ok);
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = argc > 1 ? ::atoi(argv[1]) : 100;
+
+    mg::EventLoop loop("http-upload-bench");
+    mg::HttpServer server(&loop, mg::InternetAddress(g_port), "http-upload-bench");
+    server.setThreadNums(1);
+    // 每个连接同一时间只有一个请求在接收请求体，统计值保存在loop线程中
+    size_t received = 0;
+    uint64_t sum = 0;
+    server.setMessageCallback([&](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                              {
+                                  if (request->hasPendingBody())
+                                  {
+                                      received = 0;
+                                      sum = 0;
+                                      return;
+                                  }
+                                  if (request->getPath() == "/delay")
+                                  {
+                                      uint64_t sequence = request->getSequence();
+                                      link->getLoop()->runAfter(0.05, [link, sequence]()
+                                                                {
+                                                                    mg::http::HttpResponse response;
+                                                                    response.setBody("/delay");
+                                                                    link->send(sequence, std::move(response)); //
+                                                                });
+                                      return;
+                                  }
+                                  mg::http::HttpResponse response;
+                                  response.setBody(request->getPath() == "/next" ? request->getPath().toString() : request->getBody().toString());
+                                  link->send(std::move(response)); //
+                              });
+    server.setBodyCallback([&](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::StringView data, bool last)
+                           {
+                               received += data.size();
+                               sum = checksum(data.data(), data.size(), sum);
+                               if (!last)
+                               {
+                                   if (request->getPath() == "/slow")
+                                   {
+                                       link->stopReadInLoop();
+                                       link->getLoop()->runAfter(0.001, [link]()
+                                                                 { link->startReadInLoop(); });
+                                   }
+                                   return;
+                               }
+                               mg::http::HttpResponse response;
+                               response.setBody(std::to_string(received) + " " + std::to_string(sum));
+                               link->send(request->getSequence(), std::move(response)); //
+                           });
+    server.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    server.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    server.start();
+
+    mg::HttpServer buffered(&loop, mg::InternetAddress(g_bufferedPort), "http-upload-buffered");
+    buffered.setMessageCallback([](const mg::HttpConnectionPointer &link, mg::http::HttpRequest *request, mg::TimeStamp time)
+                                {
+                                    mg::http::HttpResponse response;
+                                    response.setBody(request->getPath() == "/next" ? request->getPath().toString() : request->getBody().toString());
+                                    link->send(std::move(response)); //
+                                });
+    buffered.setConnectionCallback([](const mg::HttpConnectionPointer &link) {});
+    buffered.setWriteCompleteCallback([](const mg::HttpConnectionPointer &link) {});
+    buffered.start();
+
+    std::thread bench([&]()
+                      {
+                          ::printf("start   max rss %ld KB\n", bench::maxRss());
+                          runUpload(megabytes << 20, false);
+                          runUpload(megabytes << 20, true);
+                          runUpload(std::max<size_t>(megabytes / 10, 1) << 20, false, true);
+                          runChecks();
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "tcp-server.h"
+#include "event-loop.h"
+#include "../bench-util.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 建立大量连接，每个连接先发送一次burst字节的数据，之后保持空闲
+ * 统计所有数据处理完之后进程常驻内存的增长，得到每个空闲连接占用的内存
+ */
+
+static const uint16_t g_port = bench::freePort();
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? ::atoi(argv[1]) : 8000;
+    int burst = argc > 2 ? ::atoi(argv[2]) : 64 * 1024;
+    int loops = argc > 3 ? ::atoi(argv[3]) : 1;
+
+    mg::EventLoop loop("idle-memory-bench");
+    mg::TcpServer server(&loop, mg::InternetAddress(g_port), "idle-memory-bench");
+    server.setThreadNums(loops);
+    std::atomic<long> received(0);
+    std::atomic<int> established(0), closed(0);
+    server.setConnectionCallback([&](const mg::TcpConnectionPointer &connection)
+                                 {
+                                     if (connection->connected())
+                                         established++;
+                                     else
+                                         closed++; //
+                                 });
+    // 数据分多次到达，前面的数据先留在缓冲区中，收齐burst字节后一次取出
+    server.setMessageCallback([&](const mg::TcpConnectionPointer &connection, mg::Buffer *buffer, mg::TimeStamp)
+                              {
+                                  if (buffer->readableBytes() >= burst)
+                                  {
+                                      received.fetch_add(buffer->readableBytes(), std::memory_order_relaxed);
+                                      buffer->retrieveAllAsString();
+                                  } //
+                              });
+    server.start();
+
+    std::thread bench([&]()
+                      {
+                          ::usleep(100 * 1000);
+                          ::malloc_trim(0);
+                          long before = bench::residentKB();
+
+                          std::string data(burst, 'x');
+                          std::vector<int> fds;
+                          fds.reserve(connections);
+                          for (int i = 0; i < connections; i++)
+                          {
+                              int fd = bench::connectServer(g_port);
+                              if (fd < 0)
+                                  break;
+                              fds.push_back(fd);
+                              size_t left = data.size();
+                              while (left > 0)
+                              {
+                                  ssize_t len = ::write(fd, data.data() + data.size() - left, left);
+                                  if (len <= 0)
+                                      break;
+                                  left -= len;
+                              }
+                          }
+                          int count = static_cast<int>(fds.size());
+                          while (established.load() < count || received.load() < static_cast<long>(count) * burst)
+                              ::usleep(10 * 1000);
+                          ::usleep(100 * 1000);
+                          ::malloc_trim(0);
+                          long after = bench::residentKB();
+
+                          ::printf("connections %6d  burst %8d  rss before %8ld KB  after %8ld KB  %8.1f KB/connection\n",
+                                   count, burst, before, after, count ? static_cast<double>(after - before) / count : 0.0);
+
+                          for (int fd : fds)
+                              ::close(fd);
+                          while (closed.load() < count)
+                              ::usleep(10 * 1000);
+                          // 关闭回调之后连接还需要回到eventloop中销毁
+                          ::usleep(200 * 1000);
+                          loop.quit(); //
+                      });
+    loop.loop();
+    bench.join();
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "connection-cache.h"
+#include "../bench-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 多个线程反复从连接池取出连接、做少量工作后归还，统计每秒的取出次数
+ * locked为原来的实现：全局互斥锁加条件变量，每次取出都创建带自定义删除器的shared_ptr
+ * cache为ConnectionCache加PoolHandle：线程缓存槽位加无锁队列，句柄不分配内存
+ * 不需要真实的数据库，连接用一个计数器代替
+ * 最后检查一个线程轮流使用很多连接池之后仍然使用自己的缓存槽位
+ */
+
+struct FakeConnection
+{
+    long uses = 0;
+};
+
+class LockedPool
+{
+public:
+    explicit LockedPool(int size)
+    {
+        for (int i = 0; i < size; i++)
+            this->_queue.push_back(new FakeConnection());
+    }
+
+    ~LockedPool()
+    {
+        for (auto x : this->_queue)
+            delete x;
+    }
+
+    std::shared_ptr<FakeConnection> getHandle()
+    {
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        if (this->_queue.empty() && this->_condition.wait_for(lock, std::chrono::milliseconds(500)) == std::cv_status::timeout)
+            return nullptr;
+        if (this->_queue.empty())
+            return nullptr;
+        std::shared_ptr<FakeConnection> res(this->_queue.front(), [this](FakeConnection *connection)
+                                            {
+                                                std::lock_guard<std::mutex> guard(this->_mutex);
+                                                this->_queue.push_back(connection);
+                                                this->_condition.notify_one(); //
+                                            });
+        this->_queue.pop_front();
+        return res;
+    }
+
+private:
+    std::deque<FakeConnection *> _queue;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+};
+
+class CachePool
+{
+    friend class mg::PoolHandle<CachePool, FakeConnection>;
+
+public:
+    using Handle = mg::PoolHandle<CachePool, FakeConnection>;
+
+    explicit CachePool(int size) : _connections(size), _size(size)
+    {
+        for (int i = 0; i < size; i++)
+            this->_connections.push(new FakeConnection());
+    }
+
+    ~CachePool()
+    {
+        while (FakeConnection *connection = this->_connections.pop())
+            delete connection;
+    }
+
+    Handle getHandle()
+    {
+        FakeConnection *connection = this->_connections.acquire(std::chrono::milliseconds(500));
+        if (!connection)
+            return nullptr;
+        return Handle(this, connection);
+    }
+
+private:
+    void release(FakeConnection *connection)
+    {
+        if (!this->_connections.release(connection))
+            delete connection;
+    }
+
+    mg::ConnectionCache<FakeConnection> _connections;
+    int _size;
+};
+
+template <typename Pool>
+static void runCase(const char *name, int connections, int threads, long total)
+{
+    Pool pool(connections);
+    long checkouts = total / threads;
+    std::atomic<long> failed(0);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; i++)
+    {
+        workers.emplace_back([&]()
+                             {
+                                 for (long j = 0; j < checkouts; j++)
+                                 {
+                                     auto handle = pool.getHandle();
+                                     if (!handle)
+                                     {
+                                         failed++;
+                                         continue;
+                                     }
+                                     handle->uses++;
+                                 } //
+                             });
+    }
+    for (auto &x : workers)
+        x.join();
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    total = checkouts * threads;
+    ::printf("%-6s threads %3d  connections %3d  checkouts %9ld  cost %9ld us  %12.0f checkouts/sec  failed %ld\n",
+             name, threads, connections, total, static_cast<long>(cost),
+             cost ? total * 1e6 / cost : 0.0, failed.load());
+}
+
+/**
+ * @brief 线程轮流使用的连接池超过它记录的表项数时，表项不断被挤出，每个连接池中仍然只占用一个槽位
+ *        槽位可用时归还的第一个连接放入槽位，第二个放入共享队列，其他线程先从共享队列取到第二个
+ */
+static void runRotation()
+{
+    const int caches = 20;
+    const int rounds = 100;
+    std::vector<std::unique_ptr<mg::ConnectionCache<FakeConnection>>> pools;
+    for (int i = 0; i < caches; i++)
+        pools.emplace_back(new mg::ConnectionCache<FakeConnection>(4));
+    FakeConnection first, second;
+    std::thread rotating([&]()
+                         {
+                             for (int round = 0; round < rounds; round++)
+                             {
+                                 for (auto &pool : pools)
+                                 {
+                                     pool->release(&first);
+                                     pool->tryAcquire();
+                                 }
+                             }
+                             pools[0]->release(&first);
+                             pools[0]->release(&second); //
+                         });
+    rotating.join();
+    FakeConnection *taken = nullptr;
+    std::thread other([&]()
+                      { taken = pools[0]->tryAcquire(); });
+    other.join();
+    bench::check("thread rotating through many pools keeps its slot", taken == &second);
+}
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? ::atol(argv[1]) : 2000000;
+    int connections = argc > 2 ? ::atoi(argv[2]) : 16;
+    int maxThreads = argc > 3 ? ::atoi(argv[3]) : 64;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        runCase<LockedPool>("locked", connections, threads, total);
+        runCase<CachePool>("cache", connections, threads, total);
+    }
+    runRotation();
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "redis.h"
+#include "redis-async-client.h"
+#include "eventloop-thread.h"
+#include "event-loop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+
+/**
+ * 需要本地运行redis-server
+ * 同步的RedisConnection逐条执行INCR，每条命令一次往返
+ * 异步的RedisAsyncClient在eventloop中一次发出所有INCR，命令在一个连接上流水线执行
+ * 比较两者执行相同数量命令的耗时，并检查计数结果
+ */
+
+static long elapsed(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+static void runSync(const std::string &ip, uint16_t port, const std::string &password, int commands)
+{
+    // 与连接池一样值初始化，成员指针为空
+    std::unique_ptr<mg::RedisConnection> connection(new mg::RedisConnection());
+    if (!connection->connect(ip, port, password))
+    {
+        ::printf("sync connect failed\n");
+        return;
+    }
+    connection->SET("redis-async-bench", "0");
+    auto start = std::chrono::steady_clock::now();
+    mg::RedisResult result;
+    for (int i = 0; i < commands; i++)
+        connection->INCR("redis-async-bench", result);
+    long cost = elapsed(start);
+    ::printf("sync   commands %8d  cost %10ld us  %10.0f cmd/sec  counter %lld\n",
+             commands, cost, cost ? commands * 1e6 / cost : 0.0, result.value);
+}
+
+static void runAsync(const std::string &ip, uint16_t port, const std::string &password, int commands)
+{
+    mg::EventLoopThread thread("redis-async-bench");
+    mg::EventLoop *loop = thread.startLoop();
+    mg::RedisAsyncClient *client = nullptr;
+
+    std::promise<bool> connected;
+    loop->run([&]()
+              {
+                  client = new mg::RedisAsyncClient(loop, ip, port, password);
+                  client->disableRetry();
+                  client->setConnectionCallback([&](bool ok)
+                                                {
+                                                    static bool first = true;
+                                                    if (first)
+                                                        connected.set_value(ok);
+                                                    first = false; //
+                                                });
+                  client->connect(); //
+              });
+    if (!connected.get_future().get())
+    {
+        ::printf("async connect failed\n");
+        return;
+    }
+
+    std::promise<long long> done;
+    std::atomic<int> replies(0);
+    auto start = std::chrono::steady_clock::now();
+    loop->run([&]()
+              {
+                  client->command({"SET", "redis-async-bench", "0"});
+                  for (int i = 0; i < commands; i++)
+                  {
+                      client->command({"INCR", "redis-async-bench"}, [&](bool ok, mg::RedisResult &result)
+                                      {
+                                          if (++replies == commands)
+                                              done.set_value(ok ? result.value : -1); //
+                                      });
+                  } //
+              });
+    long long counter = done.get_future().get();
+    long cost = elapsed(start);
+    ::printf("async  commands %8d  cost %10ld us  %10.0f cmd/sec  counter %lld\n",
+             commands, cost, cost ? commands * 1e6 / cost : 0.0, counter);
+
+    std::promise<void> closed;
+    loop->run([&]()
+              {
+                  delete client;
+                  closed.set_value(); //
+              });
+    closed.get_future().wait();
+}
+
+int main(int argc, char *argv[])
+{
+    std::string ip = argc > 1 ? argv[1] : "127.0.0.1";
+    uint16_t port = argc > 2 ? static_cast<uint16_t>(::atoi(argv[2])) : 6379;
+    int commands = argc > 3 ? ::atoi(argv[3]) : 100000;
+    std::string password = argc > 4 ? argv[4] : "";
+
+    runSync(ip, port, password, commands);
+    runAsync(ip, port, password, commands);
+    return 0;
+}
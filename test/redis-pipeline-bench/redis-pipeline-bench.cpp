@@ -0,0 +1,116 @@
+#include "redis.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * 需要本地运行redis-server
+ * 模拟会话刷新，对每个会话执行一对HGET和EXPIRE
+ * 分别用逐条执行和RedisPipeline按不同批量执行，比较平均每对命令的耗时
+ * 最后用MULTI/EXEC在一个事务中执行一批命令并检查结果
+ */
+
+static long elapsed(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+static std::string sessionKey(int i)
+{
+    return "redis-pipeline-bench:session:" + std::to_string(i);
+}
+
+static void prepare(mg::RedisConnection &connection, int sessions)
+{
+    mg::RedisPipeline pipeline = connection.pipeline();
+    for (int i = 0; i < sessions; i++)
+        pipeline.append({"HSET", sessionKey(i), "uid", std::to_string(i)});
+    std::vector<mg::RedisResult> results;
+    if (!pipeline.execute(results))
+        ::printf("prepare failed\n");
+}
+
+static void runSequential(mg::RedisConnection &connection, int sessions)
+{
+    auto start = std::chrono::steady_clock::now();
+    mg::RedisResult result;
+    int hits = 0;
+    for (int i = 0; i < sessions; i++)
+    {
+        std::string key = sessionKey(i);
+        if (connection.HGET(key, "uid", result) && result.type == mg::REDIS_REPLY_TYPE_STRING)
+            hits++;
+        connection.execute("EXPIRE " + key + " 1800", result);
+    }
+    long cost = elapsed(start);
+    ::printf("sequential         pairs %8d  cost %10ld us  %8.2f us/pair  hits %d\n",
+             sessions, cost, static_cast<double>(cost) / sessions, hits);
+}
+
+static void runPipeline(mg::RedisConnection &connection, int sessions, int batch)
+{
+    auto start = std::chrono::steady_clock::now();
+    mg::RedisPipeline pipeline = connection.pipeline();
+    std::vector<mg::RedisResult> results;
+    int hits = 0;
+    for (int i = 0; i < sessions; i += batch)
+    {
+        for (int j = i; j < sessions && j < i + batch; j++)
+        {
+            std::string key = sessionKey(j);
+            pipeline.append({"HGET", key, "uid"}).append({"EXPIRE", key, "1800"});
+        }
+        pipeline.execute(results);
+        for (size_t j = 0; j < results.size(); j += 2)
+        {
+            if (results[j].type == mg::REDIS_REPLY_TYPE_STRING)
+                hits++;
+        }
+    }
+    long cost = elapsed(start);
+    ::printf("pipeline batch %4d pairs %8d  cost %10ld us  %8.2f us/pair  hits %d\n",
+             batch, sessions, cost, static_cast<double>(cost) / sessions, hits);
+}
+
+static void checkTransaction(mg::RedisConnection &connection)
+{
+    std::vector<mg::RedisResult> results;
+    bool ok = connection.pipeline()
+                  .append({"SET", "redis-pipeline-bench:counter", "0"})
+                  .multi()
+                  .append({"INCR", "redis-pipeline-bench:counter"})
+                  .append({"INCR", "redis-pipeline-bench:counter"})
+                  .append({"HGET", sessionKey(0), "uid"})
+                  .exec()
+                  .execute(results);
+    // 事务中命令的结果为实际执行的结果
+    bool right = ok && results.size() == 6 && results[2].value == 1 && results[3].value == 2 &&
+                 results[4].str == "0" && results[5].type == mg::REDIS_REPLY_TYPE_ARRAY;
+    ::printf("multi/exec  %s\n", right ? "ok" : "wrong");
+}
+
+int main(int argc, char *argv[])
+{
+    std::string ip = argc > 1 ? argv[1] : "127.0.0.1";
+    uint16_t port = argc > 2 ? static_cast<uint16_t>(::atoi(argv[2])) : 6379;
+    int sessions = argc > 3 ? ::atoi(argv[3]) : 10000;
+    std::string password = argc > 4 ? argv[4] : "";
+
+    // 与连接池一样值初始化，成员指针为空
+    std::unique_ptr<mg::RedisConnection> connection(new mg::RedisConnection());
+    if (!connection->connect(ip, port, password))
+    {
+        ::printf("connect failed\n");
+        return 1;
+    }
+    prepare(*connection, sessions);
+    runSequential(*connection, sessions);
+    for (int batch = 1; batch <= 1000; batch *= 10)
+        runPipeline(*connection, sessions, batch);
+    checkTransaction(*connection);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "tcp-connection.h"
+#include "eventloop-thread.h"
+#include "event-loop.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <new>
+
+/**
+ * 跨线程调用TcpConnection::send的开销测试
+ * 统计发送期间分配的不小于负载长度的内存，负载的每一次拷贝都对应一次这样的分配，
+ * 以此得到每次send拷贝的字节数
+ */
+
+static std::atomic_bool g_counting(false);
+static std::atomic<size_t> g_threshold(0);
+static std::atomic<size_t> g_copyBytes(0);
+
+void *operator new(size_t size)
+{
+    if (g_counting && size >= g_threshold)
+        g_copyBytes += size;
+    void *ptr = ::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    ::free(ptr);
+}
+
+enum class Mode
+{
+    STRING_COPY,
+    STRING_MOVE,
+    BUFFER_COPY,
+    BUFFER_MOVE
+};
+
+static const char *modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Mode::STRING_COPY:
+        return "send(const std::string &)";
+    case Mode::STRING_MOVE:
+        return "send(std::string &&)";
+    case Mode::BUFFER_COPY:
+        return "send(Buffer &)";
+    case Mode::BUFFER_MOVE:
+        return "send(Buffer &&)";
+    }
+    return "";
+}
+
+static void runCase(mg::EventLoop *loop, Mode mode, size_t payload, int count)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+        ::perror("socketpair");
+        ::exit(1);
+    }
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    mg::TcpConnectionPointer conn = std::make_shared<mg::TcpConnection>(loop, modeName(mode), fds[0],
+                                                                        mg::InternetAddress(), mg::InternetAddress());
+    std::promise<void> established;
+    loop->run([&]()
+              {
+                  conn->connectionEstablished();
+                  established.set_value(); //
+              });
+    established.get_future().wait();
+
+    // 负载在计数开始前准备好，计数只包含send内部产生的拷贝
+    std::vector<std::string> strings;
+    std::vector<mg::Buffer> buffers;
+    for (int i = 0; i < count; i++)
+    {
+        if (mode == Mode::STRING_COPY || mode == Mode::STRING_MOVE)
+            strings.emplace_back(payload, 'x');
+        else
+        {
+            buffers.emplace_back(0);
+            buffers.back().append(std::string(payload, 'x'));
+        }
+    }
+
+    size_t total = payload * count;
+    std::thread reader([&]()
+                       {
+                           std::vector<char> data(1 << 16);
+                           size_t received = 0;
+                           while (received < total)
+                           {
+                               ssize_t len = ::read(fds[1], data.data(), data.size());
+                               if (len <= 0)
+                                   break;
+                               received += len;
+                           } //
+                       });
+
+    g_threshold = payload;
+    g_copyBytes = 0;
+    g_counting = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        switch (mode)
+        {
+        case Mode::STRING_COPY:
+            conn->send(strings[i]);
+            break;
+        case Mode::STRING_MOVE:
+            conn->send(std::move(strings[i]));
+            break;
+        case Mode::BUFFER_COPY:
+            conn->send(buffers[i]);
+            break;
+        case Mode::BUFFER_MOVE:
+            conn->send(std::move(buffers[i]));
+            break;
+        }
+    }
+    reader.join();
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    g_counting = false;
+
+    ::printf("%-28s payload %8zu  copied/send %10.1f bytes (%.2fx)  %8.1f MB/s\n",
+             modeName(mode), payload, double(g_copyBytes) / count, double(g_copyBytes) / total,
+             cost ? total / double(cost) : 0.0);
+
+    std::promise<void> destroyed;
+    conn->forceClose();
+    loop->run([&]()
+              {
+                  conn->connectionDestoryed();
+                  destroyed.set_value(); //
+              });
+    destroyed.get_future().wait();
+    ::close(fds[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t payload = argc > 1 ? ::atol(argv[1]) : 1024 * 1024;
+    int count = argc > 2 ? ::atoi(argv[2]) : 64;
+
+    mg::EventLoopThread thread("send-bench");
+    mg::EventLoop *loop = thread.startLoop();
+
+    runCase(loop, Mode::STRING_COPY, payload, count);
+    runCase(loop, Mode::STRING_MOVE, payload, count);
+    runCase(loop, Mode::BUFFER_COPY, payload, count);
+    runCase(loop, Mode::BUFFER_MOVE, payload, count);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "eventloop-thread.h"
+#include "event-loop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+/**
+ * 多个生产者线程通过EventLoop::push向同一个eventloop投递回调
+ * 统计不同生产者数量下每秒执行的回调数，以及平均每个回调申请堆内存的次数
+ */
+
+static std::atomic<long> g_allocations(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = ::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    ::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    ::free(ptr);
+}
+
+static void runCase(mg::EventLoop *loop, int producers, int tasks)
+{
+    std::atomic<long> done(0);
+    long total = static_cast<long>(producers) * tasks;
+    // 典型的回调捕获一个shared_ptr和几个字
+    std::shared_ptr<int> owner = std::make_shared<int>(0);
+
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    long allocations = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < producers; i++)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 for (int j = 0; j < tasks; j++)
+                                 {
+                                     long a = j, b = producers, c = tasks;
+                                     loop->push([&done, owner, a, b, c]()
+                                                {
+                                                    if (owner && a + b + c >= 0)
+                                                        done.fetch_add(1, std::memory_order_relaxed);
+                                                });
+                                 } //
+                             });
+    }
+    for (auto &x : threads)
+        x.join();
+    while (done.load(std::memory_order_relaxed) < total)
+        std::this_thread::yield();
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    allocations = g_allocations.load() - allocations - producers; // 不计创建线程的分配
+
+    ::printf("producers %3d  tasks %10ld  cost %10ld us  %12.0f tasks/sec  %6.3f allocs/task\n",
+             producers, total, static_cast<long>(cost), cost ? total * 1e6 / cost : 0.0,
+             static_cast<double>(allocations) / total);
+}
+
+int main(int argc, char *argv[])
+{
+    int tasks = argc > 1 ? ::atoi(argv[1]) : 200000;
+    int maxProducers = argc > 2 ? ::atoi(argv[2]) : 16;
+
+    mg::EventLoopThread thread("task-queue-bench");
+    mg::EventLoop *loop = thread.startLoop();
+
+    for (int producers = 1; producers <= maxProducers; producers *= 2)
+        runCase(loop, producers, tasks);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "threadpool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+/**
+ * 1到64个生产者线程同时向线程池append任务，模拟多个eventloop把数据库操作交给同一个线程池
+ * 统计不同生产者数量下每秒执行的任务数，最后用submit检查返回值是否正确
+ */
+
+static void runCase(mg::ThreadPool &pool, int producers, long total, int work)
+{
+    std::atomic<long> done(0);
+    long tasks = total / producers;
+    total = tasks * producers;
+
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < producers; i++)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 for (long j = 0; j < tasks; j++)
+                                 {
+                                     pool.append([&done, work]()
+                                                 {
+                                                     // 模拟少量的计算
+                                                     volatile long sum = 0;
+                                                     for (int k = 0; k < work; k++)
+                                                         sum += k;
+                                                     done.fetch_add(1, std::memory_order_release);
+                                                 });
+                                 } //
+                             });
+    }
+    for (auto &x : threads)
+        x.join();
+    while (done.load(std::memory_order_acquire) < total)
+        std::this_thread::yield();
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    ::printf("producers %3d  tasks %10ld  cost %10ld us  %12.0f tasks/sec\n",
+             producers, total, static_cast<long>(cost), cost ? total * 1e6 / cost : 0.0);
+}
+
+static void checkSubmit(mg::ThreadPool &pool)
+{
+    std::vector<std::future<long>> results;
+    for (long i = 0; i < 1000; i++)
+        results.push_back(pool.submit([i]()
+                                      { return i * i; }));
+    long sum = 0;
+    for (auto &x : results)
+        sum += x.get();
+    ::printf("submit 1000 tasks  sum %ld  %s\n", sum, sum == 332833500 ? "ok" : "wrong");
+}
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? ::atol(argv[1]) : 1000000;
+    int workers = argc > 2 ? ::atoi(argv[2]) : 4;
+    int maxProducers = argc > 3 ? ::atoi(argv[3]) : 64;
+    int work = argc > 4 ? ::atoi(argv[4]) : 100;
+
+    mg::ThreadPool pool("threadpool-bench");
+    pool.start(workers);
+    for (int producers = 1; producers <= maxProducers; producers *= 2)
+        runCase(pool, producers, total, work);
+    checkSubmit(pool);
+    pool.stop();
+    return 0;
+}